@@ -0,0 +1,282 @@
+#! /usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (MIT) (see "license.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+"""
+Generate the benchmark corpus, or the benchmark report
+
+`gen-bench.py corpus --output <file>`
+	Writes a C file defining `bench_corpus` and `bench_corpus_length` (see
+	"src/lib/bench/public.h"): a scripted sequence of key events, by matrix
+	position (so the same corpus works with every layout), made of
+	- typing: letter keys, at a few speeds, with some rollover
+	- layers: a thumb, bottom row, or outer column key held while typing
+	  (these are the layer and modifier keys, in most layouts)
+	- chords: 2 or 3 keys pressed together (e.g. for combos)
+	- stacked layers: the numpad toggled on, a layer key held on top of it,
+	  and keys pressed that are transparent on both (so `main_exec_key()`
+	  looks more than one layer down the stack)
+	The same seed always gives the same corpus.
+
+`gen-bench.py report --output <file> <simavr output>...`
+	Reads the output of the bench firmware under simavr (one file per build,
+	named "bench--<name>.txt"; see "src/lib/bench/simavr.c"), and writes the
+	50th and 99th percentile and the max of each measurement, per build, as
+	JSON (and a summary to stdout).  If the name ends with "--dispatch<n>",
+	the `DISPATCH` setting is included too.  If there's a "bench--<name>--budget.txt"
+	next to a file (the output of `make budget`, for the same build), the
+	flash and SRAM used are included too.
+"""
+
+# -----------------------------------------------------------------------------
+
+import argparse
+import json
+import os
+import random
+import re
+import sys
+
+# -----------------------------------------------------------------------------
+
+# matrix positions (row, column) (see "src/keyboard/ergodox/matrix.h")
+LETTERS = [ (row, col) for row in (2, 3, 4)
+                       for col in (1, 2, 3, 4, 5, 8, 9, 10, 11, 12) ]
+HOLDS = [ (0, col) for col in range(1, 13) ] \
+      + [ (1, col) for col in (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13) ] \
+      + [ (row, col) for row in (2, 3, 4) for col in (0, 13) ]
+
+# for the stacked layers (the same in all the kinesis-mod layouts): the numpad
+# toggle (on, on layer 0; off, on the numpad layer), the layer 1 keys
+# (transparent on the numpad layer), and keys transparent on both layer 1 and
+# the numpad layer (the outer column, bottom row, and thumb keys)
+NUMPAD = (5, 7)
+LAYER_1 = [ (4, 6), (2, 6), (2, 7) ]
+TRANSPARENT = [ (row, 0) for row in (2, 3, 4) ] \
+            + [ (1, col) for col in (0, 2, 3, 4, 9, 10, 13) ] \
+            + [ (0, col) for col in (1, 2, 3, 4, 5, 6) ]
+
+# -----------------------------------------------------------------------------
+
+class Corpus():
+	"""
+	Key events (time in scans, row, column, is_pressed), with no key pressed
+	again before it's released (and some time has passed)
+	"""
+	def __init__(self, seed):
+		self.random = random.Random(seed)
+		self.events = []
+		self.free = {}  # (row, col) => the first scan it can be pressed
+		self.time = 0
+
+	def tap(self, key, start, hold):
+		start = max(start, self.free.get(key, 0))
+		self.events.append((start, key, True))
+		self.events.append((start + hold, key, False))
+		self.free[key] = start + hold + 20  # (slower than chatter)
+		return start
+
+	def typing(self, count, interval):
+		for i in range(count):
+			key = self.random.choice(LETTERS)
+			start = self.tap( key, self.time,
+			                  self.random.randint(4, 20) )
+			self.time = start + self.random.randint(*interval)
+
+	def layers(self, count):
+		for i in range(count):
+			key = self.random.choice(HOLDS)
+			start = max(self.time, self.free.get(key, 0))
+			self.time = start + self.random.randint(2, 6)
+			self.typing(self.random.randint(1, 5), (4, 12))
+			self.tap(key, start, self.time - start + 2)
+			self.time += self.random.randint(10, 30)
+
+	def chords(self, count):
+		for i in range(count):
+			keys = self.random.sample(LETTERS, self.random.randint(2, 3))
+			start = max([self.time] + [self.free.get(k, 0) for k in keys])
+			for key in keys:
+				self.tap(key, start + self.random.randint(0, 2),
+				         self.random.randint(4, 12))
+			self.time = start + self.random.randint(20, 40)
+
+	def stacked(self, count):
+		self.time = self.tap(NUMPAD, self.time, 8) + 30
+		for i in range(count):
+			key = self.random.choice(LAYER_1)
+			start = max(self.time, self.free.get(key, 0))
+			self.time = start + self.random.randint(2, 6)
+			for j in range(self.random.randint(1, 5)):
+				self.time = self.tap( self.random.choice(TRANSPARENT),
+				                      self.time, self.random.randint(4, 12) ) \
+				          + self.random.randint(4, 12)
+			self.tap(key, start, self.time - start + 2)
+			self.time += self.random.randint(10, 30)
+		self.time = self.tap(NUMPAD, self.time, 8) + 30
+
+	def entries(self):
+		"""
+		Returns a list of (wait, row, column, is_pressed), in order
+		"""
+		out, last = [], 0
+		for time, (row, col), is_pressed in sorted(self.events):
+			while time - last > 255:
+				# (a release of a key that isn't pressed does nothing)
+				last += 255
+				out.append((255, 0, 0, False))
+			out.append((time - last, row, col, is_pressed))
+			last = time
+		return out
+
+def corpus(args):
+	c = Corpus(args.seed)
+	c.typing(400, (6, 14))  # ~100 wpm
+	c.typing(200, (3, 8))   # bursts, with rollover
+	c.layers(120)
+	c.chords(80)
+	c.stacked(60)
+	c.typing(200, (8, 40))  # slower
+
+	entries = c.entries()
+
+	out = []
+	out.append('/* ' + '-'*76)
+	out.append(' * benchmark corpus : generated by "build-scripts/'
+	           + os.path.basename(sys.argv[0]) + '"')
+	out.append(' * (seed ' + str(args.seed) + '); do not edit')
+	out.append(' * ' + '-'*73 + ' */')
+	out.append('')
+	out.append('')
+	out.append('#include <stdint.h>')
+	out.append('#include <avr/pgmspace.h>')
+	out.append('#include "./public.h"')
+	out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	out.append('const uint8_t PROGMEM bench_corpus[][2] = {')
+	for wait, row, col, is_pressed in entries:
+		out.append('\tBENCH_EVENT( ' + str(wait).rjust(3) + ', '
+		           + str(row) + ', ' + str(col).rjust(2) + ', '
+		           + str(int(is_pressed)) + ' ),')
+	out.append('};')
+	out.append('')
+	out.append('const uint16_t bench_corpus_length = '
+	           + str(len(entries)) + ';')
+	out.append('')
+
+	open(args.output, 'w').write('\n'.join(out))
+
+# -----------------------------------------------------------------------------
+
+def percentiles(values):
+	values = sorted(values)
+	if not values:
+		return { 'count': 0 }
+	def at(p):
+		return values[min(len(values) - 1, int(len(values) * p / 100))]
+	return {
+		'count': len(values),
+		'p50': at(50),
+		'p99': at(99),
+		'max': values[-1],
+	}
+
+def report(args):
+	results = {}
+	for path in args.inputs:
+		name = re.sub(r'^bench--|\.txt$', '', os.path.basename(path))
+		samples = { 's': [], 'e': [], 'l': [], 'n': [] }
+		ended = False
+		for line in open(path, errors='replace'):
+			for kind, value in re.findall(r'bench (\w+)(?: (\d+))?', line):
+				if kind == 'end':
+					ended = True
+				elif kind in samples:
+					samples[kind].append(int(value or 0))
+		if not ended:
+			sys.exit(path + ': the simulation didn\'t finish')
+		results[name] = {
+			'scan-cycles': percentiles(samples['s']),
+			'key-event-cycles': percentiles(samples['e']),
+			'report-latency-scans': percentiles(samples['l']),
+			'key-events-without-report': len(samples['n']),
+		}
+
+		dispatch = re.search(r'--dispatch(\d+)$', name)
+		if dispatch:
+			results[name]['dispatch'] = int(dispatch.group(1))
+
+		budget = re.sub(r'\.txt$', '--budget.txt', path)
+		if os.path.exists(budget):
+			text = open(budget, errors='replace').read()
+			flash = re.search(r'^flash\s+(\d+)', text, re.MULTILINE)
+			sram = re.search(r'^sram\s+(\d+).*?(\d+) stack', text,
+			                 re.MULTILINE)
+			if flash:
+				results[name]['flash-bytes'] = int(flash.group(1))
+			if sram:
+				results[name]['sram-bytes'] = int(sram.group(1))
+				results[name]['stack-bytes'] = int(sram.group(2))
+
+	open(args.output, 'w').write(
+			json.dumps(results, sort_keys=True, indent=4) + '\n' )
+
+	columns = ('scan-cycles', 'key-event-cycles', 'report-latency-scans')
+	width = max([len(name) for name in results] + [5]) + 2
+	print( 'build'.ljust(width) + 'dispatch'.rjust(10)
+	     + ''.join(c.rjust(24) for c in columns)
+	     + 'flash'.rjust(8) + 'sram'.rjust(8) )
+	print( ''.ljust(width + 10)
+	     + '     p50     p99     max' * len(columns) )
+	for name, result in sorted(results.items()):
+		print( name.ljust(width)
+		     + str(result.get('dispatch', '-')).rjust(10)
+		     + ''.join( ''.join( str(result[c].get(p, '-')).rjust(8)
+		                         for p in ('p50', 'p99', 'max') )
+		                for c in columns )
+		     + str(result.get('flash-bytes', '-')).rjust(8)
+		     + str(result.get('sram-bytes', '-')).rjust(8) )
+
+# -----------------------------------------------------------------------------
+
+def main():
+	arg_parser = argparse.ArgumentParser(
+			description = 'Generate the benchmark corpus, or report' )
+	subparsers = arg_parser.add_subparsers(dest = 'command')
+
+	corpus_parser = subparsers.add_parser('corpus')
+	corpus_parser.add_argument(
+			'--output',
+			required = True )
+	corpus_parser.add_argument(
+			'--seed',
+			type = int,
+			default = 1 )
+
+	report_parser = subparsers.add_parser('report')
+	report_parser.add_argument(
+			'--output',
+			required = True )
+	report_parser.add_argument(
+			'inputs',
+			nargs = '+' )
+
+	args = arg_parser.parse_args(sys.argv[1:])
+
+	if args.command == 'corpus':
+		corpus(args)
+	elif args.command == 'report':
+		report(args)
+	else:
+		arg_parser.print_usage()
+		sys.exit(1)
+
+# -----------------------------------------------------------------------------
+
+if __name__ == '__main__':
+	main()
+
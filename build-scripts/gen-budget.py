@@ -0,0 +1,327 @@
+#! /usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (MIT) (see "license.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+"""
+Generate a report of how much flash, SRAM, and stack the firmware uses, and
+check it against a budget
+
+Depends on:
+- the firmware ".elf" (read with `avr-size`, `avr-nm`, and `avr-objdump`)
+- the ".su" files from compiling with `-fstack-usage`
+
+Flash and SRAM use is totaled from the ELF's sections, and broken down by
+symbol (into layout data, USB descriptors, key functions, and everything
+else), and, if several layouts are compiled in, by layout.
+
+The worst case stack depth is worked out from the call graph (from the
+disassembly: every `call`, `rcall`, `jmp`, or `rjmp` to the start of another
+function) and the frame size of each function (from the ".su" files), plus 2
+bytes of return address per call.  Since the stack is shared with interrupt
+handlers, the deepest handler is added to the deepest path from `main`.  Some
+things can't be known this way, and are assumed:
+- an indirect call (`icall`, `eicall`) may call any function matching
+  `--indirect` (by default, any key function)
+- functions without a ".su" entry (from libc, libgcc, or assembly) are
+  assumed to use no stack beyond their return address
+- recursion (e.g. `main_exec_key()` and `kbfun_transparent()`) is counted
+  once, and reported (the real depth depends on the number of layers
+  involved)
+
+Exits with a non-zero status if the flash used is more than `--max-flash`, or
+if the static SRAM plus the worst case stack is more than `--max-sram`.
+"""
+
+# -----------------------------------------------------------------------------
+
+import argparse
+import collections
+import glob
+import os
+import re
+import subprocess
+import sys
+
+# -----------------------------------------------------------------------------
+
+CATEGORIES = (  # (name, pattern); the first match wins
+	('layout',          r'^_kb_'),
+	('usb descriptors', r'descriptor|_desc|^string\d'),
+	('key functions',   r'^kbfun_'),
+	('other',           r''),
+)
+
+RETURN_ADDRESS = 2  # bytes pushed per call (on the ATmega32U4)
+
+# -----------------------------------------------------------------------------
+
+def run(command):
+	try:
+		return subprocess.check_output(command, universal_newlines=True)
+	except (OSError, subprocess.CalledProcessError) as error:
+		sys.exit('error running "' + ' '.join(command) + '": ' + str(error))
+
+def read_sections(size, elf):
+	"""
+	Returns a dict of section name => size (from `avr-size -A`)
+	"""
+	sections = {}
+	for line in run([size, '-A', elf]).splitlines():
+		match = re.match(r'^(\.\S+)\s+(\d+)\s+\d+', line)
+		if match:
+			sections[match.group(1)] = int(match.group(2))
+	return sections
+
+def read_symbols(nm, elf):
+	"""
+	Returns a list of (name, size, memory) for every symbol with a size,
+	where memory is 'flash', 'sram', or 'both' (for initialized data)
+	"""
+	symbols = []
+	for line in run([nm, '--size-sort', '-S', '-t', 'd', elf]).splitlines():
+		match = re.match(r'^\d+\s+(\d+)\s+(\w)\s+(\S+)$', line)
+		if not match:
+			continue
+		size, kind, name = int(match.group(1)), match.group(2), match.group(3)
+		if kind in 'tTwW':
+			memory = 'flash'
+		elif kind in 'dD':
+			memory = 'both'
+		elif kind in 'bBvV':
+			memory = 'sram'
+		else:
+			continue
+		symbols.append((name, size, memory))
+	return symbols
+
+def read_frames(paths):
+	"""
+	Returns a dict of function name => stack frame size (from the ".su"
+	files, e.g. "main.c:48:5:main	16	static"); functions with the same name
+	(e.g. `static` ones in different files) get the largest
+	"""
+	frames = {}
+	for path in paths:
+		for line in open(path):
+			fields = line.rstrip('\n').split('\t')
+			if len(fields) < 2:
+				continue
+			name = re.sub(r'\.(?:lto_priv|constprop|isra|part)\.\d+$', '',
+			              fields[0].split(':')[-1])
+			frames[name] = max(frames.get(name, 0), int(fields[1]))
+	return frames
+
+def read_call_graph(objdump, elf):
+	"""
+	Returns
+	- a dict of function name => set of functions it calls
+	- the set of functions that make indirect calls
+	"""
+	calls = {}
+	indirect = set()
+	function = None
+	for line in run([objdump, '-d', elf]).splitlines():
+		match = re.match(r'^[0-9a-fA-F]+ <([^>]+)>:$', line)
+		if match:
+			function = match.group(1)
+			calls.setdefault(function, set())
+			continue
+		if function is None:
+			continue
+		match = re.match(r'^\s*[0-9a-fA-F]+:\s+(?:[0-9a-fA-F]{2} )+\s*(\w+)',
+		                 line)
+		if not match:
+			continue
+		instruction = match.group(1)
+		if instruction in ('icall', 'eicall', 'ijmp', 'eijmp'):
+			if instruction.endswith('call'):
+				indirect.add(function)
+			continue
+		if instruction not in ('call', 'rcall', 'jmp', 'rjmp'):
+			continue
+		target = re.search(r'<([^>+]+)>\s*$', line)  # (not "<name+0x4>")
+		if target and target.group(1) != function:
+			calls[function].add(target.group(1))
+	return calls, indirect
+
+# -----------------------------------------------------------------------------
+
+def stack_depth(calls, indirect, targets, frames):
+	"""
+	Returns a function that returns (depth, path, recursive functions) for
+	the deepest call chain starting at a function
+	"""
+	memo = {}
+	recursive = set()
+
+	def callees(function):
+		return calls.get(function, set()) \
+		     | (targets if function in indirect else set())
+
+	def depth(function, stack):
+		if function in memo:
+			return memo[function]
+		stack.append(function)
+		deepest, path = 0, []
+		for callee in callees(function):
+			if callee in stack:
+				recursive.update(stack[stack.index(callee):])
+				continue
+			d, p = depth(callee, stack)
+			if d + RETURN_ADDRESS > deepest:
+				deepest, path = d + RETURN_ADDRESS, p
+		stack.pop()
+		memo[function] = (frames.get(function, 0) + deepest, [function] + path)
+		return memo[function]
+
+	return lambda function: depth(function, []) + (recursive,)
+
+# -----------------------------------------------------------------------------
+
+def main():
+	arg_parser = argparse.ArgumentParser(
+			description = 'Report the firmware\'s memory use, and check it '
+			            + 'against a budget' )
+
+	arg_parser.add_argument(
+			'--elf',
+			required = True )
+	arg_parser.add_argument(
+			'--su-files',
+			nargs = '*',
+			default = [],
+			help = 'the ".su" files from compiling with `-fstack-usage` '
+			       '(default: all of them under the ".elf"\'s directory)' )
+	arg_parser.add_argument(
+			'--max-flash',
+			type = int,
+			help = 'in bytes; 0 (or none given) for no limit' )
+	arg_parser.add_argument(
+			'--max-sram',
+			type = int,
+			help = 'in bytes, including the worst case stack; 0 (or none '
+			       'given) for no limit' )
+	arg_parser.add_argument(
+			'--top',
+			type = int,
+			default = 8,
+			help = 'the number of symbols to list per category' )
+	arg_parser.add_argument(
+			'--indirect',
+			default = r'^kbfun_',
+			help = 'a regex for the functions that indirect calls may call' )
+	arg_parser.add_argument('--size',    default = 'avr-size')
+	arg_parser.add_argument('--nm',      default = 'avr-nm')
+	arg_parser.add_argument('--objdump', default = 'avr-objdump')
+
+	args = arg_parser.parse_args(sys.argv[1:])
+
+	if not args.su_files:
+		args.su_files = glob.glob(
+				os.path.join(os.path.dirname(os.path.abspath(args.elf)),
+				             '**', '*.su'),
+				recursive = True )
+
+	sections = read_sections(args.size, args.elf)
+	symbols  = read_symbols(args.nm, args.elf)
+	frames   = read_frames(args.su_files)
+	calls, indirect = read_call_graph(args.objdump, args.elf)
+
+	flash = sections.get('.text', 0) + sections.get('.data', 0)
+	sram  = sections.get('.data', 0) + sections.get('.bss', 0) \
+	      + sections.get('.noinit', 0)
+
+	targets = set(f for f in calls if re.search(args.indirect, f))
+	depth = stack_depth(calls, indirect, targets, frames)
+
+	main_depth, main_path, recursive = depth('main')
+	isr_depth, isr_path = 0, []
+	for function in calls:
+		if function.startswith('__vector_'):
+			d, p, r = depth(function)
+			if d > isr_depth:
+				isr_depth, isr_path = d, p
+	stack = main_depth + (isr_depth + RETURN_ADDRESS if isr_path else 0)
+
+	# --- report
+
+	out = []
+	out.append('flash  ' + str(flash).rjust(6) + ' bytes'
+	           + (' (of ' + str(args.max_flash) + ')' if args.max_flash else ''))
+	out.append('sram   ' + str(sram).rjust(6) + ' bytes static'
+	           + ' + ' + str(stack) + ' stack = ' + str(sram + stack)
+	           + (' (of ' + str(args.max_sram) + ')' if args.max_sram else ''))
+
+	for memory, kinds in ( ('flash', ('flash', 'both')),
+	                       ('sram',  ('sram', 'both')) ):
+		out.append('')
+		out.append('--- ' + memory + ', by symbol')
+		groups = collections.OrderedDict((c, []) for c, p in CATEGORIES)
+		for name, size, kind in symbols:
+			if kind in kinds:
+				for category, pattern in CATEGORIES:
+					if re.search(pattern, name):
+						groups[category].append((size, name))
+						break
+		for category, group in groups.items():
+			if not group:
+				continue
+			group.sort(reverse=True)
+			out.append(category.ljust(16) + str(sum(s for s, n in group))
+			           .rjust(7) + '  (' + str(len(group)) + ' symbols)')
+			for size, name in group[:args.top]:
+				out.append('    ' + str(size).rjust(6) + '  ' + name)
+
+	layouts = collections.OrderedDict()
+	for name, size, kind in symbols:
+		match = re.match(r'^_kb_\w*?(?:__(\d+))?$', name)
+		if match and kind in ('flash', 'both'):
+			number = int(match.group(1) or 0)
+			layouts[number] = layouts.get(number, 0) + size
+	if len(layouts) > 1:
+		out.append('')
+		out.append('--- flash, by layout (see `EXTRA_LAYOUTS`)')
+		for number, size in sorted(layouts.items()):
+			out.append(('layout ' + str(number)).ljust(16)
+			           + str(size).rjust(7))
+
+	out.append('')
+	out.append('--- stack, worst case')
+	out.append('main   ' + str(main_depth).rjust(6) + '  '
+	           + ' > '.join(main_path))
+	if isr_path:
+		out.append('isr    ' + str(isr_depth + RETURN_ADDRESS).rjust(6) + '  '
+		           + ' > '.join(isr_path))
+	if recursive:
+		out.append('note: recursive functions (counted once): '
+		           + ', '.join(sorted(recursive)))
+	if not frames:
+		out.append('note: no ".su" files found; frame sizes counted as 0')
+	unknown = sorted(f for f in main_path + isr_path if f not in frames)
+	if frames and unknown:
+		out.append('note: no frame size for ' + ', '.join(unknown))
+
+	print('\n'.join(out))
+
+	# --- check
+
+	failed = False
+	if args.max_flash and flash > args.max_flash:
+		print('error: flash over budget by ' + str(flash - args.max_flash)
+		      + ' bytes', file=sys.stderr)
+		failed = True
+	if args.max_sram and sram + stack > args.max_sram:
+		print('error: sram (with stack) over budget by '
+		      + str(sram + stack - args.max_sram) + ' bytes', file=sys.stderr)
+		failed = True
+	if failed:
+		sys.exit(1)
+
+# -----------------------------------------------------------------------------
+
+if __name__ == '__main__':
+	main()
+
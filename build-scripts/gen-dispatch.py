@@ -0,0 +1,221 @@
+#! /usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (MIT) (see "license.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+"""
+Generate a layout's key function dispatcher (in C)
+
+Input: the layout's ".c", already run through the C preprocessor (with the
+same flags it's compiled with), so that every key function in
+`_kb_layout_press` and `_kb_layout_release` is written out as `&name` or
+`((void *)0)`.  The matrices are found the same way "gen-ui-info.py" finds
+them.
+
+Output: a C file defining
+- `_kb_dispatch_press` and `_kb_dispatch_release`: the matrices, with each
+  function replaced by a 1 byte action number (0 for `NULL`, 1 for
+  `kbfun_transparent`, and the rest numbered from the most used function
+  down)
+- `kb_dispatch_exec()`: a `switch` on the action number, calling the most
+  used functions directly; the rest are called through a (much smaller)
+  table of function pointers
+
+(see "src/keyboard/ergodox/layout/default--matrix-control.h")
+"""
+
+# -----------------------------------------------------------------------------
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+# -----------------------------------------------------------------------------
+
+NONE = 0
+TRANSPARENT = 1
+
+# -----------------------------------------------------------------------------
+
+def parse(text):
+	"""
+	Returns a dict of matrix name ('_kb_layout_press', '_kb_layout_release')
+	=> (dimensions, list of layers, each a list of rows, each a list of
+	function names (or `None`))
+	"""
+	text = re.sub(  # remove line markers (e.g. '# 163 "file.c"')
+			r'^\s*#.*$', '', text, flags=re.MULTILINE )
+	text = re.sub(  # replace '((void *) 0)' with 'NULL'
+			r'\(\s*\(\s*void\s*\*\s*\)\s*0\s*\)', 'NULL', text )
+
+	matrices = {}
+	for match in re.finditer(  # find each '_kb_layout_press/release' definition
+			r'(_kb_layout_(?:press|release))\s*'
+			r'\[\s*(\d+)\s*\]\s*\[\s*(\d+)\s*\]\s*\[\s*(\d+)\s*\]\s*=\s*\{',
+			text ):
+		name = match.group(1)
+		dimensions = [int(match.group(i)) for i in (2, 3, 4)]
+		layers = [ [[] for row in range(dimensions[1])]
+		           for layer in range(dimensions[0]) ]
+
+		depth, layer, row = 1, -1, -1
+		for token in re.finditer(
+				r'\[\s*(\d+)\s*\]\s*=|[{}]|&\s*\w+|NULL|\w+',
+				text[match.end():] ):
+			token = token.group(0)
+			if token[0] == '[':  # designated initializer (for a layer)
+				layer = int(re.search(r'\d+', token).group(0)) - 1
+			elif token == '{':
+				depth += 1
+				if depth == 2:
+					layer, row = layer+1, -1
+				elif depth == 3:
+					row += 1
+			elif token == '}':
+				depth -= 1
+				if depth == 0:
+					break
+			elif depth == 3:
+				if token != 'NULL' and token[0] != '&':
+					sys.exit(name + ': expected a function pointer, not "'
+					         + token + '"')
+				layers[layer][row].append(
+						None if token == 'NULL'
+						else re.sub(r'&\s*', '', token) )
+			else:
+				sys.exit(name + ': expected each layer to be written as '
+				         + 'rows of keys (e.g. with `KB_MATRIX_LAYER()`)')
+
+		matrices[name] = (dimensions, layers)
+
+	for name in ('_kb_layout_press', '_kb_layout_release'):
+		if name not in matrices:
+			sys.exit(name + ' not found (layouts using `KB_LAYOUT_COMPACT` '
+			         + 'can\'t use the generated dispatcher)')
+	return matrices
+
+def number(matrices):
+	"""
+	Returns the list of functions, by action number (the first two being
+	`None` and 'kbfun_transparent')
+	"""
+	counts = collections.Counter(
+			function
+			for dimensions, layers in matrices.values()
+			for layer in layers
+			for row in layer
+			for function in row
+			if function not in (None, 'kbfun_transparent') )
+
+	actions = [None, 'kbfun_transparent'] \
+	        + [function for function, count in counts.most_common()]
+	if len(actions) > 256:
+		sys.exit('too many different key functions: ' + str(len(actions))
+		         + ' (the most is 256)')
+	return actions
+
+# -----------------------------------------------------------------------------
+
+def main():
+	arg_parser = argparse.ArgumentParser(
+			description = 'Generate the key function dispatcher' )
+
+	arg_parser.add_argument(
+			'--input',
+			required = True )
+	arg_parser.add_argument(
+			'--output',
+			required = True )
+	arg_parser.add_argument(
+			'--inline',
+			type = int,
+			default = 8,
+			help = 'the number of functions (the most used ones) to call '
+			       'directly; the rest are called through a table' )
+
+	args = arg_parser.parse_args(sys.argv[1:])
+
+	matrices = parse(open(args.input).read())
+	actions = number(matrices)
+	direct = actions[2:2+args.inline]
+	table = actions[2+args.inline:]
+
+	out = []
+	out.append('/* ' + '-'*76)
+	out.append(' * key function dispatcher : generated by "build-scripts/'
+	           + os.path.basename(sys.argv[0]) + '"')
+	out.append(' * from "' + os.path.basename(args.input)
+	           + '" (the preprocessed layout); do not edit')
+	out.append(' * ' + '-'*73 + ' */')
+	out.append('')
+	out.append('')
+	out.append('#include <stdint.h>')
+	out.append('#include <avr/pgmspace.h>')
+	out.append('#include "../../../main.h"')
+	out.append('#include "../../../keyboard/layout.h"')
+	out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	for function in actions[2:]:
+		out.append('void ' + function + '(struct key_event * event);')
+	out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	out.append('/*')
+	out.append(' * actions')
+	out.append(' *')
+	for index, function in enumerate(actions):
+		out.append(' * ' + str(index).rjust(3) + ': '
+		           + (function or 'NULL'))
+	out.append(' */')
+	for name in ('_kb_layout_press', '_kb_layout_release'):
+		dimensions, layers = matrices[name]
+		out.append('')
+		out.append('const uint8_t PROGMEM '
+		           + name.replace('_kb_layout', '_kb_dispatch')
+		           + '[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {')
+		for index, layer in enumerate(layers):
+			if not any(layer):
+				continue
+			out.append('\t[' + str(index) + '] = {')
+			for row in layer:
+				out.append('\t\t{ ' + ', '.join(
+						str(actions.index(function)).rjust(3)
+						for function in row ) + ' },')
+			out.append('\t},')
+		out.append('};')
+	out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	if table:
+		out.append('static const kbfun_funptr_t PROGMEM others[] = {')
+		for function in table:
+			out.append('\t&' + function + ',')
+		out.append('};')
+		out.append('')
+	out.append('void kb_dispatch_exec(uint8_t action, struct key_event * event) {')
+	out.append('\tswitch (action) {')
+	for index, function in enumerate(direct, 2):
+		out.append('\t\tcase ' + str(index).rjust(3) + ': '
+		           + function + '(event);  break;')
+	if table:
+		out.append('\t\tcase ' + str(NONE).rjust(3) + ':')
+		out.append('\t\tcase ' + str(TRANSPARENT).rjust(3) + ':  break;')
+		out.append('\t\tdefault:')
+		out.append('\t\t\t( (kbfun_funptr_t) pgm_read_word( &others[action-'
+		           + str(2+len(direct)) + '] ) )(event);')
+	out.append('\t}')
+	out.append('}')
+	out.append('')
+
+	open(args.output, 'w').write('\n'.join(out))
+
+# -----------------------------------------------------------------------------
+
+if __name__ == '__main__':
+	main()
+
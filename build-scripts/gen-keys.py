@@ -0,0 +1,472 @@
+#! /usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (MIT) (see "license.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+"""
+Generate a layout's matrices (in C) from a list of its keys, written once per
+key instead of once per matrix
+
+Input: a text file ("<layout>--keys.txt"), with the keys of each layer in the
+order of the arguments of `KB_MATRIX_LAYER()` (in the keyboard's "matrix.h";
+without the first one, for unused positions), separated by whitespace or
+commas, e.g.
+
+	# comments start with '#'
+	function kbfun_my_function  # a key function defined in the layout
+
+	layer 0 : default
+	_equal, _1, _2, _3, _4, _5, _esc
+	...
+
+	layer 1 : symbols
+	...
+
+where each key is one of
+- `-`: nothing (keycode 0, no functions)
+- `^`: transparent (keycode 0, `kbfun_transparent`)
+- `<keycode>`: a key pressed and released (`kbfun_press_release`)
+- `<keycode>:<function>`: a key using another function on press, and on
+  release whatever that function goes with (e.g. `kbfun_layer_pop_1` for
+  `kbfun_layer_push_1`, nothing for `kbfun_jump_to_bootloader`, and the same
+  function for most others)
+- `<keycode>:<press>/<release>`: a key using the given functions (either of
+  which may be `-`, for none)
+and where
+- keycodes are numbers, or names defined in `--headers` (e.g. `_A`, or
+  `KEY_a_A`); they may be left out before a ':' (for 0)
+- functions are the full names of the key functions declared in `--headers`,
+  or the short names that layouts usually `#define` (e.g. `kprrel`, or
+  `lpush1`), or names given in a `function` line before the keys that use
+  them (for functions defined in the layout's ".c")
+
+Layers are numbered from 0, in order, and nothing in layer 0 may be
+transparent.  Every reference to a layer (by a numbered layer function, or by
+the keycode of an unnumbered one) is checked, and so is every keycode.  Layers
+that nothing pushes (directly or through other layers) are left out, and the
+layers after them renumbered, unless they are marked `keep` (e.g. `layer 4
+keep : name`; for layers pushed by custom functions).
+
+Output: a C file defining `_kb_layout`, and either `_kb_layout_press` and
+`_kb_layout_release`, or (if the layout's ".h" `#define`s `KB_LAYOUT_COMPACT`)
+`_kb_layout_functions` and `_kb_functions` (see
+"src/keyboard/*/layout/default--matrix-control.h")
+"""
+
+# -----------------------------------------------------------------------------
+
+import argparse
+import os
+import re
+import sys
+
+# -----------------------------------------------------------------------------
+
+# the short names layouts usually `#define` for key functions
+ALIASES = {
+	'kprrel':  'kbfun_press_release',
+	'kprpst':  'kbfun_press_release_preserve_sticky',
+	'ktog':    'kbfun_toggle',
+	'ktrans':  'kbfun_transparent',
+	'lpush':   'kbfun_layer_push',
+	'lsticky': 'kbfun_layer_sticky',
+	'lpop':    'kbfun_layer_pop_all',
+	'ltog':    'kbfun_layer_toggle',
+	'dbtldr':  'kbfun_jump_to_bootloader',
+	'sshprre': 'kbfun_shift_press_release',
+	'sinvert': 'kbfun_shift_inverted_press_release',
+	's2kcap':  'kbfun_2_keys_capslock_press_release',
+	'slpunum': 'kbfun_layer_push_numpad',
+	'slponum': 'kbfun_layer_pop_numpad',
+	'mprrel':  'kbfun_mediakey_press_release',
+	'lnext':   'kbfun_layout_next',
+	'lset':    'kbfun_layout_set',
+}
+for n in range(1, 11):
+	ALIASES['lpush'   + str(n)] = 'kbfun_layer_push_'   + str(n)
+	ALIASES['lsticky' + str(n)] = 'kbfun_layer_sticky_' + str(n)
+	ALIASES['lpop'    + str(n)] = 'kbfun_layer_pop_'    + str(n)
+	ALIASES['ltog'    + str(n)] = 'kbfun_layer_toggle_' + str(n)
+
+# the release function that goes with a press function (the first match
+# wins; `None` for nothing; functions that match nothing are used for both)
+RELEASE = (
+	(r'^kbfun_layer_push(_\d+)?$',        r'kbfun_layer_pop\1'),
+	(r'^kbfun_layer_(pop|toggle)(_\w+)?$', None),
+	(r'^kbfun_layer_(push|pop)_numpad$',  None),
+	(r'^kbfun_jump_to_bootloader$',       None),
+	(r'^kbfun_layout_(next|set)$',        None),
+	(r'^kbfun_leader$',                   None),
+	(r'^kbfun_unicode_(press|mode)$',     None),
+)
+
+# functions that take a layer from their name ('_<n>'), or from the keycode
+NUMBERED_LAYER = r'^kbfun_layer_(push|sticky|pop|toggle)_(\d+)$'
+KEYCODE_LAYER = r'^kbfun_layer_(push|sticky|pop|toggle)$' \
+              + r'|^kbfun_layer_push_numpad$'
+
+# -----------------------------------------------------------------------------
+
+class Key():
+	def __init__(self, keycode, press, release, where):
+		self.keycode = keycode  # as written (or a number)
+		self.press = press      # function name, or None
+		self.release = release  # function name, or None
+		self.where = where      # for error messages
+
+class Layer():
+	def __init__(self, number, name, keep, where):
+		self.number = number
+		self.name = name
+		self.keep = keep
+		self.where = where
+		self.keys = []
+
+def error(where, message):
+	sys.exit(where + ': ' + message)
+
+# -----------------------------------------------------------------------------
+
+def read_matrix(path):
+	"""
+	Returns a list of lines, each a list of the position names (e.g. 'k26')
+	on that line of the arguments of `KB_MATRIX_LAYER()`
+	"""
+	match = re.search(r'#define\s+KB_MATRIX_LAYER\s*\(([^)]+)\)',
+	                  open(path).read())
+	if not match:
+		sys.exit(path + ': no `KB_MATRIX_LAYER()`')
+	lines = []
+	for line in re.sub(r'/\*.*?\*/', '', match.group(1)).splitlines():
+		positions = re.findall(r'\bk[0-9A-Fa-f]{2}\b', line)
+		if positions:
+			lines.append(positions)
+	return lines
+
+def read_headers(paths):
+	"""
+	Returns
+	- a dict of macro name => value (as written)
+	- the set of key functions declared
+	"""
+	defines = {}
+	functions = set()
+	for path in paths:
+		text = re.sub(r'/\*.*?\*/', '', open(path).read(), flags=re.DOTALL)
+		for name, value in re.findall(
+				r'^\s*#define\s+(\w+)[ \t]+([^\n]*?)\s*(?://[^\n]*)?$',
+				text, re.MULTILINE ):
+			defines[name] = value
+		functions.update(re.findall(
+				r'\bvoid\s+(kbfun_\w+)\s*\(\s*struct\s+key_event\s*\*',
+				text ))
+	return defines, functions
+
+def keycode_value(keycode, defines):
+	"""
+	Returns the value of a keycode (following macros), or None if it isn't
+	a number or a name defined in the headers
+	"""
+	for i in range(16):
+		if re.match(r'^(0[xX][0-9a-fA-F]+|\d+)$', keycode):
+			return int(keycode, 0)
+		if keycode not in defines:
+			return None
+		keycode = re.sub(r'^\((.*)\)$', r'\1', defines[keycode].strip())
+	return None
+
+# -----------------------------------------------------------------------------
+
+def parse(path, aliases, functions):
+	"""
+	Returns the list of layers, and the list of functions declared in the
+	file
+	"""
+	layers = []
+	declared = []
+
+	def function(name, where):
+		name = aliases.get(name, name)
+		if name not in functions and name not in declared:
+			error(where, 'unknown key function "' + name + '"')
+		return name
+
+	for number, line in enumerate(open(path), 1):
+		where = path + ':' + str(number)
+		line = line.split('#', 1)[0].strip()
+		if not line:
+			continue
+
+		match = re.match(r'^function\s+(\w+)$', line)
+		if match:
+			declared.append(match.group(1))
+			continue
+
+		match = re.match(r'^layer\s+(\d+)\s*(keep)?\s*(?::\s*(.*))?$', line)
+		if match:
+			if int(match.group(1)) != len(layers):
+				error(where, 'expected layer ' + str(len(layers)))
+			layers.append(Layer( int(match.group(1)), match.group(3) or '',
+			                     bool(match.group(2)), where ))
+			continue
+
+		if not layers:
+			error(where, 'expected "layer 0"')
+
+		for token in re.split(r'[\s,]+', line.strip(' \t,')):
+			if token == '-':
+				key = Key('0', None, None, where)
+			elif token == '^':
+				key = Key('0', 'kbfun_transparent', 'kbfun_transparent',
+				          where)
+			elif ':' not in token:
+				key = Key(token, 'kbfun_press_release', 'kbfun_press_release',
+				          where)
+			else:
+				keycode, functions_ = token.split(':', 1)
+				press, slash, release = functions_.partition('/')
+				if not press or (slash and not release):
+					error(where, 'expected "<keycode>:<press>[/<release>]", '
+					             'got "' + token + '"')
+				press = None if press == '-' else function(press, where)
+				if slash:
+					release = None if release == '-' \
+					          else function(release, where)
+				else:
+					release = press
+					for pattern, replacement in RELEASE:
+						if press and re.match(pattern, press):
+							release = replacement and \
+							          re.sub(pattern, replacement, press)
+							break
+				key = Key(keycode or '0', press, release, where)
+			layers[-1].keys.append(key)
+
+	if not layers:
+		sys.exit(path + ': no layers')
+	return layers, declared
+
+def layer_references(key, defines):
+	"""
+	Returns the list of (layer, is_push) referred to by a key's functions
+	"""
+	references = []
+	for function in (key.press, key.release):
+		if not function:
+			continue
+		match = re.match(NUMBERED_LAYER, function)
+		if match:
+			references.append((int(match.group(2)), match.group(1) != 'pop'))
+		elif re.match(KEYCODE_LAYER, function):
+			layer = keycode_value(key.keycode, defines)
+			if layer is None:
+				error(key.where, '"' + key.keycode + '" isn\'t a layer '
+				                 'number (for ' + function + ')')
+			references.append((layer, not function.endswith('_pop')))
+	return references
+
+def check(layers, positions, defines):
+	"""
+	Checks every layer's key count, keycodes, and layer references, and that
+	nothing in layer 0 is transparent
+	"""
+	for key in layers[0].keys:
+		if 'kbfun_transparent' in (key.press, key.release):
+			error(key.where, 'layer 0 can\'t have transparent keys')
+	for layer in layers:
+		if len(layer.keys) != len(positions):
+			error(layer.where, 'layer ' + str(layer.number) + ' has '
+			                   + str(len(layer.keys)) + ' keys (expected '
+			                   + str(len(positions)) + ')')
+		for key, position in zip(layer.keys, positions):
+			value = keycode_value(key.keycode, defines)
+			if value is None:
+				error(key.where, 'unknown keycode "' + key.keycode + '" (at '
+				                 + position + ', in layer '
+				                 + str(layer.number) + ')')
+			if not 0 <= value <= 0xFF:
+				error(key.where, 'keycode "' + key.keycode + '" is '
+				                 + hex(value) + ', which doesn\'t fit in a '
+				                 'byte (at ' + position + ')')
+			for reference, is_push in layer_references(key, defines):
+				if reference >= len(layers) or (is_push and reference == 0):
+					error(key.where, 'no layer ' + str(reference) + ' to '
+					                 + ('push' if is_push else 'pop')
+					                 + ' (at ' + position + ', in layer '
+					                 + str(layer.number) + ')')
+
+def remove_dead_layers(layers, defines):
+	"""
+	Returns the layers that can be reached from layer 0 (or are marked
+	`keep`), renumbered, with the references to them updated
+	"""
+	reached = set([0] + [l.number for l in layers if l.keep])
+	queue = list(reached)
+	while queue:
+		for key in layers[queue.pop()].keys:
+			for reference, is_push in layer_references(key, defines):
+				if is_push and reference not in reached:
+					reached.add(reference)
+					queue.append(reference)
+
+	numbers = {}
+	for layer in layers:
+		if layer.number in reached:
+			numbers[layer.number] = len(numbers)
+		else:
+			print('note: layer ' + str(layer.number) + ' ("' + layer.name
+			      + '") is never pushed; leaving it out', file=sys.stderr)
+	if len(numbers) == len(layers):
+		return layers
+
+	kept = [layer for layer in layers if layer.number in numbers]
+	for layer in kept:
+		for key in layer.keys:
+			for attribute in ('press', 'release'):
+				function = getattr(key, attribute)
+				match = function and re.match(NUMBERED_LAYER, function)
+				if not match:
+					continue
+				if int(match.group(2)) in numbers:
+					setattr(key, attribute, 'kbfun_layer_' + match.group(1)
+					        + '_' + str(numbers[int(match.group(2))]))
+				else:
+					setattr(key, attribute, None)  # (pops a removed layer)
+			if any(re.match(KEYCODE_LAYER, f)
+			       for f in (key.press, key.release) if f):
+				layer_ = keycode_value(key.keycode, defines)
+				key.keycode = str(numbers.get(layer_, 0))
+	for layer in kept:
+		layer.number = numbers[layer.number]
+	return kept
+
+# -----------------------------------------------------------------------------
+
+def main():
+	arg_parser = argparse.ArgumentParser(
+			description = 'Generate the layout matrices from a list of keys' )
+
+	arg_parser.add_argument(
+			'--input',
+			required = True )
+	arg_parser.add_argument(
+			'--output',
+			required = True )
+	arg_parser.add_argument(
+			'--matrix',
+			required = True,
+			help = 'the keyboard\'s "matrix.h" (with `KB_MATRIX_LAYER()`)' )
+	arg_parser.add_argument(
+			'--headers',
+			nargs = '+',
+			required = True,
+			help = 'the headers defining the keycodes, and declaring the key '
+			       'functions' )
+
+	args = arg_parser.parse_args(sys.argv[1:])
+
+	lines = read_matrix(args.matrix)
+	positions = [p for line in lines for p in line]
+	defines, functions = read_headers(args.headers)
+
+	layers, declared = parse(args.input, ALIASES, functions)
+	check(layers, positions, defines)
+	layers = remove_dead_layers(layers, defines)
+
+	def pointer(function):
+		return '&' + function if function else 'NULL'
+
+	pairs = [(None, None)]
+	for layer in layers:
+		for key in layer.keys:
+			if (key.press, key.release) not in pairs:
+				pairs.append((key.press, key.release))
+	if len(pairs) > 256:
+		sys.exit(args.input + ': too many (press, release) pairs for the '
+		         + 'compact encoding (' + str(len(pairs)) + '; the most is '
+		         + '256)')
+
+	def matrix(out, name, type_, value):
+		out.append('const ' + type_ + ' PROGMEM ' + name
+		           + '[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {')
+		for layer in layers:
+			out.append('')
+			out.append('\tKB_MATRIX_LAYER(  // layer ' + str(layer.number)
+			           + (': ' + layer.name if layer.name else ''))
+			values = [value(key) for key in layer.keys]
+			width = max(len(v) for v in values)
+			out.append('\t\t' + value(None) + ',')
+			i = 0
+			for line in lines:
+				row = values[i:i+len(line)]
+				i += len(line)
+				out.append('\t\t' + ', '.join(v.rjust(width) for v in row)
+				           + (',' if i < len(values) else ' ),'))
+		out.append('')
+		out.append('};')
+		out.append('')
+
+	out = []
+	out.append('/* ' + '-'*76)
+	out.append(' * layout matrices : generated by "build-scripts/'
+	           + os.path.basename(sys.argv[0]) + '"')
+	out.append(' * from "' + os.path.basename(args.input) + '"; do not edit')
+	out.append(' * ' + '-'*73 + ' */')
+	out.append('')
+	out.append('')
+	out.append('#include <stdint.h>')
+	out.append('#include <stddef.h>')
+	out.append('#include <avr/pgmspace.h>')
+	out.append('#include "../../../lib/data-types/misc.h"')
+	out.append('#include "../../../lib/usb/usage-page/keyboard--short-names.h"')
+	out.append('#include "../../../lib/key-functions/public.h"')
+	out.append('#include "../matrix.h"')
+	out.append('#include "../layout.h"')
+	out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	out.append('#if KB_LAYERS < ' + str(len(layers)))
+	out.append('\t#error "`KB_LAYERS` must be at least '
+	           + str(len(layers)) + ' (the layers in '
+	           + os.path.basename(args.input) + ')"')
+	out.append('#endif')
+	out.append('')
+	for function in declared:
+		out.append('void ' + function + '(struct key_event * event);')
+	if declared:
+		out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	matrix(out, '_kb_layout', 'uint8_t',
+	       lambda key: key.keycode if key else '0')
+	out.append('// ' + '-'*76)
+	out.append('')
+	out.append('#ifdef KB_LAYOUT_COMPACT')
+	out.append('')
+	matrix(out, '_kb_layout_functions', 'uint8_t',
+	       lambda key: str(pairs.index((key.press, key.release)))
+	                   if key else '0')
+	out.append('const kbfun_funptr_t PROGMEM _kb_functions[][2] = {')
+	for i, (press, release) in enumerate(pairs):
+		out.append('\t{ ' + pointer(press) + ', ' + pointer(release) + ' },'
+		           + '  // ' + str(i))
+	out.append('};')
+	out.append('')
+	out.append('#else')
+	out.append('')
+	matrix(out, '_kb_layout_press', 'kbfun_funptr_t',
+	       lambda key: pointer(key.press) if key else 'NULL')
+	matrix(out, '_kb_layout_release', 'kbfun_funptr_t',
+	       lambda key: pointer(key.release) if key else 'NULL')
+	out.append('#endif')
+	out.append('')
+
+	open(args.output, 'w').write('\n'.join(out))
+
+# -----------------------------------------------------------------------------
+
+if __name__ == '__main__':
+	main()
+
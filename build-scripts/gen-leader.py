@@ -0,0 +1,153 @@
+#! /usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (MIT) (see "license.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+"""
+Generate the leader key trie (in C) from a layout's list of leader sequences
+
+Input: a text file, with one sequence per line, e.g.
+
+	# comments start with '#'
+	_G _S     : leader_git_status
+	_G _C _A  : leader_git_commit_amend
+
+where the keys are keycodes (as they'd be written in the layout), and the name
+after the ':' is a `void (void)` function (defined in the layout) to call when
+the sequence is typed.
+
+Output: a C file defining `_kb_leader_trie` and `_kb_leader_actions` (see
+"src/lib/key-functions/leader.h" for the format)
+"""
+
+# -----------------------------------------------------------------------------
+
+import argparse
+import os
+import sys
+
+# -----------------------------------------------------------------------------
+
+class Node():
+	def __init__(self):
+		self.children = {}  # keycode name => Node
+		self.action = 0     # 1 + index into the action list, or 0
+		self.index = None   # of the node's first entry, in the trie
+
+# -----------------------------------------------------------------------------
+
+def parse(path):
+	"""
+	Returns a list of (keys, action) tuples
+	"""
+	sequences = []
+	for number, line in enumerate(open(path), 1):
+		line = line.split('#', 1)[0].strip()
+		if not line:
+			continue
+		if line.count(':') != 1:
+			sys.exit(path + ':' + str(number) + ': expected "keys : action"')
+		keys, action = [part.strip() for part in line.split(':')]
+		keys = keys.split()
+		if not keys or not action:
+			sys.exit(path + ':' + str(number) + ': expected "keys : action"')
+		sequences.append((keys, action))
+	return sequences
+
+def build(sequences):
+	"""
+	Returns the root of the trie, and the list of actions
+	"""
+	root = Node()
+	actions = []
+	for keys, action in sequences:
+		node = root
+		for key in keys:
+			node = node.children.setdefault(key, Node())
+		if node.action:
+			sys.exit('duplicate sequence: ' + ' '.join(keys))
+		if action not in actions:
+			actions.append(action)
+		node.action = actions.index(action) + 1
+	return root, actions
+
+def flatten(root):
+	"""
+	Returns the list of nodes, in the order they're laid out in the trie (each
+	one taking `len(children) + 1` entries), with `index` set
+	"""
+	nodes = []
+	queue = [root]
+	index = 0
+	while queue:
+		node = queue.pop(0)
+		node.index = index
+		index += len(node.children) + 1
+		nodes.append(node)
+		queue.extend(node.children.values())
+	if index > 256:
+		sys.exit('too many leader sequences: the trie has '
+		         + str(index) + ' entries (the most is 256)')
+	return nodes
+
+# -----------------------------------------------------------------------------
+
+def main():
+	arg_parser = argparse.ArgumentParser(
+			description = 'Generate the leader key trie' )
+
+	arg_parser.add_argument(
+			'--input',
+			required = True )
+	arg_parser.add_argument(
+			'--output',
+			required = True )
+
+	args = arg_parser.parse_args(sys.argv[1:])
+
+	root, actions = build(parse(args.input))
+	nodes = flatten(root)
+
+	out = []
+	out.append('/* ' + '-'*76)
+	out.append(' * leader key trie : generated by "build-scripts/'
+	           + os.path.basename(sys.argv[0]) + '"')
+	out.append(' * from "' + os.path.basename(args.input) + '"; do not edit')
+	out.append(' * ' + '-'*73 + ' */')
+	out.append('')
+	out.append('')
+	out.append('#include <stdint.h>')
+	out.append('#include <avr/pgmspace.h>')
+	out.append('#include "../../../lib/data-types/misc.h"')
+	out.append('#include "../../../lib/usb/usage-page/keyboard--short-names.h"')
+	out.append('#include "../../../lib/key-functions/leader.h"')
+	out.append('')
+	out.append('// ' + '-'*76)
+	out.append('')
+	for action in actions:
+		out.append('void ' + action + '(void);')
+	out.append('')
+	out.append('const uint16_t PROGMEM _kb_leader_trie[] = {')
+	for node in nodes:
+		for key, child in node.children.items():
+			out.append('\tKB_LEADER_EDGE( ' + key + ', '
+			           + str(child.index) + ' ),')
+		out.append('\tKB_LEADER_END( ' + str(node.action) + ' ),'
+		           + '  // (node ' + str(node.index) + ')')
+	out.append('};')
+	out.append('')
+	out.append('const void_funptr_t PROGMEM _kb_leader_actions[] = {')
+	for action in actions:
+		out.append('\t&' + action + ',')
+	out.append('};')
+	out.append('')
+
+	open(args.output, 'w').write('\n'.join(out))
+
+# -----------------------------------------------------------------------------
+
+if __name__ == '__main__':
+	main()
+
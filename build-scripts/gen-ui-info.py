@@ -290,7 +290,7 @@ def find_keyboard_functions(source_code_path):
 	def parse_keyboard_function(f, line, comments):
 		"""Parse keyboard-functions in the source code"""
 
-		search = re.search(r'void\s+(kbfun_\S+)\s*\(void\)', line)
+		search = re.search(r'void\s+(kbfun_\S+)\s*\(struct\s+key_event\s*\*\s*event\)', line)
 		name = search.group(1)
 
 		return {
@@ -326,7 +326,9 @@ def find_keyboard_functions(source_code_path):
 			for line in f:
 				if line.strip() == r'/*':
 					comments = read_comments(f, line)
-				elif re.search(r'void\s+kbfun_\S+\s*\(void\)', line):
+				elif re.search(
+						r'void\s+kbfun_\S+\s*\(struct\s+key_event\s*\*\s*event\)',
+						line ):
 					dict_merge(
 							output,
 							parse_keyboard_function(f, line, comments) )
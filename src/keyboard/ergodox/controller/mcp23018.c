@@ -9,8 +9,9 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <avr/io.h>
 #include <util/twi.h>
-#include "../../../lib/twi.h"  // `TWI_FREQ` defined in "teensy-2-0.c"
+#include "../../../lib/twi.h"  // `TWI_FREQ` defined in "makefile-options"
 #include "../options.h"
 #include "../matrix.h"
 #include "./mcp23018--functions.h"
@@ -28,6 +29,9 @@
 // register addresses (see "mcp23018.md")
 #define IODIRA 0x00  // i/o direction register
 #define IODIRB 0x01
+#define GPINTENA 0x04  // interrupt-on-change enable register
+#define GPINTENB 0x05
+#define IOCON  0x0A  // configuration register (also at 0x0B)
 #define GPPUA  0x0C  // GPIO pull-up resistor register
 #define GPPUB  0x0D
 #define GPIOA  0x12  // general purpose i/o port register (write modifies OLAT)
@@ -35,10 +39,185 @@
 #define OLATA  0x14  // output latch register
 #define OLATB  0x15
 
+// driving and sensing port aliases (for the idle functions)
+#if MCP23018__DRIVE_ROWS
+	#define DRIVE_GPIO     GPIOB
+	#define DRIVE_ALL_LOW  0b11000000
+	#define SENSE_GPIO     GPIOA
+	#define SENSE_MASK     0b01111111
+	#define SENSE_GPINTENA SENSE_MASK  // GPINTENA
+	#define SENSE_GPINTENB 0           // GPINTENB
+#elif MCP23018__DRIVE_COLUMNS
+	#define DRIVE_GPIO     GPIOA
+	#define DRIVE_ALL_LOW  0b10000000
+	#define SENSE_GPIO     GPIOB
+	#define SENSE_MASK     0b00111111
+	#define SENSE_GPINTENA 0           // GPINTENA
+	#define SENSE_GPINTENB SENSE_MASK  // GPINTENB
+#endif
+
 // TWI aliases
 #define TWI_ADDR_WRITE ( (MCP23018_TWI_ADDRESS<<1) | TW_WRITE )
 #define TWI_ADDR_READ  ( (MCP23018_TWI_ADDRESS<<1) | TW_READ  )
 
+// INT pin helper (see `MCP23018__INT_PIN` in "../options.h")
+#define  _int_pin_read(pin_letter, pin_number)	\
+	((PIN##pin_letter) & (1<<(pin_number)))
+#define  int_pin_read(pin)	\
+	_int_pin_read(pin)
+
+// ----------------------------------------------------------------------------
+
+#if MCP23018__IDLE_INTERRUPT
+// - `idle`: all the driving pins are low, and we're waiting for one of the
+//   sensing pins to change
+// - `idle_scans`: how many scans we've skipped; when it rolls over we do a full
+//   scan anyway, in case the i/o expander was unplugged and plugged back in
+//   (which we wouldn't otherwise notice if we're only watching the INT pin)
+static bool    idle;
+static uint8_t idle_scans;
+
+#if MCP23018__INT_PIN_WIRED
+// - `int_armed`: whether the interrupt-on-change registers were all written
+//   successfully, the last time we went idle (if not, we poll instead)
+static bool    int_armed;
+#endif
+#endif
+
+// - `skip_scans`: how many more scans to leave the left hand out of, after the
+//   bus locked up (see `MCP23018__RETRY_SCANS` in "../options.h")
+static uint8_t skip_scans;
+
+// ----------------------------------------------------------------------------
+
+static void clear_matrix(bool matrix[KB_ROWS][KB_COLUMNS]) {
+	for (uint8_t row=0; row<=5; row++)
+		for (uint8_t col=0; col<=6; col++)
+			matrix[row][col] = 0;
+}
+
+/* returns:
+ * - success: 0
+ * - failure: twi status code
+ *
+ * notes:
+ * - every step is checked, so that if the bus locks up partway through, we
+ *   wait for it (`TWI_TIMEOUT`) once, instead of once per step
+ */
+static uint8_t write_registers(uint8_t address, uint8_t a, uint8_t b) {
+	uint8_t ret;
+
+	if ( !(ret = twi_start())              &&
+	     !(ret = twi_send(TWI_ADDR_WRITE)) &&  // make sure we got an ACK
+	     !(ret = twi_send(address))        &&
+	     !(ret = twi_send(a)) )
+		ret = twi_send(b);
+
+	twi_stop();
+	return ret;
+}
+
+static uint8_t write_register(uint8_t address, uint8_t data) {
+	uint8_t ret;
+
+	if ( !(ret = twi_start())              &&
+	     !(ret = twi_send(TWI_ADDR_WRITE)) &&  // make sure we got an ACK
+	     !(ret = twi_send(address)) )
+		ret = twi_send(data);
+
+	twi_stop();
+	return ret;
+}
+
+static uint8_t read_register(uint8_t address, uint8_t * data) {
+	uint8_t ret;
+
+	if ( !(ret = twi_start())              &&
+	     !(ret = twi_send(TWI_ADDR_WRITE)) &&  // make sure we got an ACK
+	     !(ret = twi_send(address))        &&
+	     !(ret = twi_start())              &&
+	     !(ret = twi_send(TWI_ADDR_READ)) )
+		ret = twi_read(data);
+
+	twi_stop();
+	return ret;
+}
+
+#if MCP23018__IDLE_INTERRUPT
+
+/*
+ * Start waiting for activity
+ *
+ * Notes:
+ * - Must be called with all the driving pins already set low
+ * - Reading the sensing pins gives us the baseline to compare against, and
+ *   clears any pending interrupt
+ */
+static void idle_enter(void) {
+	uint8_t data;
+
+	#if MCP23018__INT_PIN_WIRED
+		// set interrupt-on-change for the sensing pins
+		// - GPINTEN : on for the sensing pins
+		// - DEFVAL  : (doesn't matter)
+		// - INTCON  : compare against the previous value : 0
+		// - IOCON   : INT pins mirrored, and open-drain (the teensy pin has
+		//             its internal pull-up enabled)
+		// - if any of this fails, INT can't be trusted, so we poll instead
+		uint8_t ret;
+		if ( !(ret = twi_start())              &&
+		     !(ret = twi_send(TWI_ADDR_WRITE)) &&  // make sure we got an ACK
+		     !(ret = twi_send(GPINTENA))       &&
+		     !(ret = twi_send(SENSE_GPINTENA)) &&  // GPINTENA
+		     !(ret = twi_send(SENSE_GPINTENB)) &&  // GPINTENB
+		     !(ret = twi_send(0))              &&  // DEFVALA
+		     !(ret = twi_send(0))              &&  // DEFVALB
+		     !(ret = twi_send(0))              &&  // INTCONA
+		     !(ret = twi_send(0)) )                // INTCONB
+			ret = twi_send(0b01000100);            // IOCON
+		twi_stop();
+		int_armed = !ret;
+	#endif
+
+	if (read_register(SENSE_GPIO, &data))
+		return;
+
+	idle = ( (data & SENSE_MASK) == SENSE_MASK );
+	idle_scans = 0;
+}
+
+/*
+ * Check whether anything has happened while we were idle, and stop being idle
+ * if so (or if there was an error, or if it's time to resynchronize)
+ *
+ * returns:
+ * - success: 0
+ * - failure: twi status code
+ */
+static uint8_t idle_update(void) {
+	if (!++idle_scans) {
+		idle = false;
+		return 0;  // success
+	}
+
+	#if MCP23018__INT_PIN_WIRED
+		// INT is active low
+		if (int_armed) {
+			if (!int_pin_read(MCP23018__INT_PIN))
+				idle = false;
+			return 0;  // success
+		}
+	#endif
+
+	// polled (if INT isn't wired, or couldn't be set up)
+	uint8_t data;
+	uint8_t ret = read_register(SENSE_GPIO, &data);
+	if (ret || (data & SENSE_MASK) != SENSE_MASK)
+		idle = false;
+	return ret;
+}
+#endif
+
 // ----------------------------------------------------------------------------
 
 /* returns:
@@ -47,7 +226,8 @@
  *
  * notes:
  * - `twi_stop()` must be called *exactly once* for each twi block, the way
- *   things are currently set up.  this may change in the future.
+ *   things are currently set up (`write_registers()`, etc. take care of
+ *   this).  this may change in the future.
  */
 uint8_t mcp23018_init(void) {
 	uint8_t ret;
@@ -56,50 +236,29 @@ uint8_t mcp23018_init(void) {
 	// - unused  : input  : 1
 	// - input   : input  : 1
 	// - driving : output : 0
-	twi_start();
-	ret = twi_send(TWI_ADDR_WRITE);
-	if (ret) goto out;  // make sure we got an ACK
-	twi_send(IODIRA);
 	#if MCP23018__DRIVE_ROWS
-		twi_send(0b11111111);  // IODIRA
-		twi_send(0b11000000);  // IODIRB
+		ret = write_registers(IODIRA, 0b11111111, 0b11000000);
 	#elif MCP23018__DRIVE_COLUMNS
-		twi_send(0b10000000);  // IODIRA
-		twi_send(0b11111111);  // IODIRB
+		ret = write_registers(IODIRA, 0b10000000, 0b11111111);
 	#endif
-	twi_stop();
+	if (ret) return ret;
 
 	// set pull-up
 	// - unused  : on  : 1
 	// - input   : on  : 1
 	// - driving : off : 0
-	twi_start();
-	ret = twi_send(TWI_ADDR_WRITE);
-	if (ret) goto out;  // make sure we got an ACK
-	twi_send(GPPUA);
 	#if MCP23018__DRIVE_ROWS
-		twi_send(0b11111111);  // GPPUA
-		twi_send(0b11000000);  // GPPUB
+		ret = write_registers(GPPUA, 0b11111111, 0b11000000);
 	#elif MCP23018__DRIVE_COLUMNS
-		twi_send(0b10000000);  // GPPUA
-		twi_send(0b11111111);  // GPPUB
+		ret = write_registers(GPPUA, 0b10000000, 0b11111111);
 	#endif
-	twi_stop();
+	if (ret) return ret;
 
 	// set logical value (doesn't matter on inputs)
 	// - unused  : hi-Z : 1
 	// - input   : hi-Z : 1
 	// - driving : hi-Z : 1
-	twi_start();
-	ret = twi_send(TWI_ADDR_WRITE);
-	if (ret) goto out;  // make sure we got an ACK
-	twi_send(OLATA);
-	twi_send(0b11111111);  //OLATA
-	twi_send(0b11111111);  //OLATB
-
-out:
-	twi_stop();
-	return ret;
+	return write_registers(OLATA, 0b11111111, 0b11111111);
 }
 
 /* returns:
@@ -111,22 +270,37 @@ out:
 #endif
 uint8_t mcp23018_update_matrix(bool matrix[KB_ROWS][KB_COLUMNS]) {
 	uint8_t ret, data;
+	uint8_t sensed = 0xFF;  // the AND of all the sense pin readings
+
+	// if the bus locked up recently, leave the left hand out for a while
+	// (the right hand is still scanned as usual)
+	if (skip_scans) {
+		skip_scans--;
+		clear_matrix(matrix);
+		return TWI_STATUS_TIMEOUT;  // (still an error)
+	}
+
+	#if MCP23018__IDLE_INTERRUPT
+		// if nothing was pressed last time, and nothing has changed since,
+		// there's no need to scan
+		// - our part of the matrix still has to be cleared, since `main()`
+		//   alternates between two of them
+		if (idle) {
+			ret = idle_update();
+			if (ret) goto out;
+			if (idle) {
+				clear_matrix(matrix);
+				return 0;  // success
+			}
+		}
+	#endif
 
 	// initialize things, just to make sure
 	// - it's not appreciably faster to skip this, and it takes care of the
 	//   case when the i/o expander isn't plugged in during the first
 	//   init()
 	ret = mcp23018_init();
-
-	// if there was an error
-	if (ret) {
-		// clear our part of the matrix
-		for (uint8_t row=0; row<=5; row++)
-			for (uint8_t col=0; col<=6; col++)
-				matrix[row][col] = 0;
-
-		return ret;
-	}
+	if (ret) goto out;
 
 
 	// --------------------------------------------------------------------
@@ -136,71 +310,84 @@ uint8_t mcp23018_update_matrix(bool matrix[KB_ROWS][KB_COLUMNS]) {
 		for (uint8_t row=0; row<=5; row++) {
 			// set active row low  : 0
 			// set other rows hi-Z : 1
-			twi_start();
-			twi_send(TWI_ADDR_WRITE);
-			twi_send(GPIOB);
-			twi_send( 0xFF & ~(1<<(5-row)) );
-			twi_stop();
+			ret = write_register( GPIOB, 0xFF & ~(1<<(5-row)) );
+			if (ret) goto out;
 
 			// read column data
-			twi_start();
-			twi_send(TWI_ADDR_WRITE);
-			twi_send(GPIOA);
-			twi_start();
-			twi_send(TWI_ADDR_READ);
-			twi_read(&data);
-			twi_stop();
+			ret = read_register(GPIOA, &data);
+			if (ret) goto out;
 
 			// update matrix
 			for (uint8_t col=0; col<=6; col++) {
 				matrix[row][col] = !( data & (1<<col) );
 			}
+			sensed &= data;
 		}
 
 		// set all rows hi-Z : 1
-		twi_start();
-		twi_send(TWI_ADDR_WRITE);
-		twi_send(GPIOB);
-		twi_send(0xFF);
-		twi_stop();
+		// - unless nothing is pressed, and we're going idle (then set
+		//   them all low : 0)
+		#if MCP23018__IDLE_INTERRUPT
+			ret = write_register( GPIOB,
+			                      ((sensed & SENSE_MASK) == SENSE_MASK)
+			                      ? DRIVE_ALL_LOW : 0xFF );
+		#else
+			ret = write_register(GPIOB, 0xFF);
+		#endif
+		if (ret) goto out;
 
 	#elif MCP23018__DRIVE_COLUMNS
 		for (uint8_t col=0; col<=6; col++) {
 			// set active column low  : 0
 			// set other columns hi-Z : 1
-			twi_start();
-			twi_send(TWI_ADDR_WRITE);
-			twi_send(GPIOA);
-			twi_send( 0xFF & ~(1<<col) );
-			twi_stop();
+			ret = write_register( GPIOA, 0xFF & ~(1<<col) );
+			if (ret) goto out;
 
 			// read row data
-			twi_start();
-			twi_send(TWI_ADDR_WRITE);
-			twi_send(GPIOB);
-			twi_start();
-			twi_send(TWI_ADDR_READ);
-			twi_read(&data);
-			twi_stop();
+			ret = read_register(GPIOB, &data);
+			if (ret) goto out;
 
 			// update matrix
 			for (uint8_t row=0; row<=5; row++) {
 				matrix[row][col] = !( data & (1<<(5-row)) );
 			}
+			sensed &= data;
 		}
 
 		// set all columns hi-Z : 1
-		twi_start();
-		twi_send(TWI_ADDR_WRITE);
-		twi_send(GPIOA);
-		twi_send(0xFF);
-		twi_stop();
+		// - unless nothing is pressed, and we're going idle (then set
+		//   them all low : 0)
+		#if MCP23018__IDLE_INTERRUPT
+			ret = write_register( GPIOA,
+			                      ((sensed & SENSE_MASK) == SENSE_MASK)
+			                      ? DRIVE_ALL_LOW : 0xFF );
+		#else
+			ret = write_register(GPIOA, 0xFF);
+		#endif
+		if (ret) goto out;
 
 	#endif
 
 	// /update our part of the matrix
 	// --------------------------------------------------------------------
 
-	return ret;  // success
+	#if MCP23018__IDLE_INTERRUPT
+		if ((sensed & SENSE_MASK) == SENSE_MASK)
+			idle_enter();
+	#endif
+
+out:
+	// if there was an error
+	// - clear our part of the matrix (a partial scan can't be trusted)
+	// - if the bus locked up, stop trying for a while: each try costs up to
+	//   `TWI_TIMEOUT` (plus the time to recover the bus) on top of the
+	//   usual scan
+	if (ret) {
+		clear_matrix(matrix);
+		if (ret == TWI_STATUS_TIMEOUT)
+			skip_scans = MCP23018__RETRY_SCANS;
+	}
+
+	return ret;
 }
 
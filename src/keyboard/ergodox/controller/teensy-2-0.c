@@ -7,14 +7,12 @@
  * ------------------------------------------------------------------------- */
 
 
-// for "lib/twi.h"
-#define TWI_FREQ 400000
-
 #include <stdbool.h>
 #include <stdint.h>
 #include <avr/io.h>
 #include <util/delay.h>
 #include "../../../lib/twi.h"
+#include "../../../lib/timer.h"
 #include "../options.h"
 #include "../matrix.h"
 #include "./teensy-2-0--functions.h"
@@ -123,6 +121,34 @@
 		teensypin_write(register, operation, COLUMN_D); }	\
 	while(0)
 
+#define  teensypin_read_all_row()			\
+	(  teensypin_read(ROW_0) && teensypin_read(ROW_1)	\
+	&& teensypin_read(ROW_2) && teensypin_read(ROW_3)	\
+	&& teensypin_read(ROW_4) && teensypin_read(ROW_5) )
+
+#define  teensypin_read_all_column()				\
+	(  teensypin_read(COLUMN_7) && teensypin_read(COLUMN_8)	\
+	&& teensypin_read(COLUMN_9) && teensypin_read(COLUMN_A)	\
+	&& teensypin_read(COLUMN_B) && teensypin_read(COLUMN_C)	\
+	&& teensypin_read(COLUMN_D) )
+
+
+/*
+ * idle macros
+ * - `drive_all()`: set all the driving pins (DDR, SET) low, or (DDR, CLEAR)
+ *   hi-Z
+ * - `sense_all_high()`: whether none of the sensing pins are being pulled low
+ */
+#if TEENSY__DRIVE_ROWS
+	#define  drive_all(register, operation)			\
+		teensypin_write_all_row(register, operation)
+	#define  sense_all_high()  teensypin_read_all_column()
+#elif TEENSY__DRIVE_COLUMNS
+	#define  drive_all(register, operation)			\
+		teensypin_write_all_column(register, operation)
+	#define  sense_all_high()  teensypin_read_all_row()
+#endif
+
 
 /*
  * update macros
@@ -160,6 +186,14 @@
 
 // ----------------------------------------------------------------------------
 
+#if TEENSY__IDLE_DETECT
+// all the driving pins are low, and we're waiting for one of the sensing pins
+// to go low too
+static bool idle;
+#endif
+
+// ----------------------------------------------------------------------------
+
 /* returns
  * - success: 0
  */
@@ -187,6 +221,9 @@ uint8_t teensy_init(void) {
 	// I2C (TWI)
 	twi_init();  // on pins D(1,0)
 
+	// millisecond timer
+	timer_init();  // on Timer/Counter0
+
 	// unused pins
 	teensypin_write_all_unused(DDR, CLEAR); // set as input
 	teensypin_write_all_unused(PORT, SET);  // set internal pull-up enabled
@@ -213,6 +250,23 @@ uint8_t teensy_init(void) {
 #endif
 
 uint8_t teensy_update_matrix(bool matrix[KB_ROWS][KB_COLUMNS]) {
+	#if TEENSY__IDLE_DETECT
+		// if nothing was pressed last time, and nothing is pressed now,
+		// there's no need to strobe
+		// - our part of the matrix still has to be cleared, since `main()`
+		//   alternates between two of them
+		if (idle) {
+			if (sense_all_high()) {
+				for (uint8_t row=0; row<=5; row++)
+					for (uint8_t col=7; col<=0xD; col++)
+						matrix[row][col] = 0;
+				return 0;  // success
+			}
+			drive_all(DDR, CLEAR);  // set hi-Z (set as input)
+			idle = false;
+		}
+	#endif
+
 	#if TEENSY__DRIVE_ROWS
 		update_columns_for_row(matrix, 0);
 		update_columns_for_row(matrix, 1);
@@ -230,5 +284,16 @@ uint8_t teensy_update_matrix(bool matrix[KB_ROWS][KB_COLUMNS]) {
 		update_rows_for_column(matrix, D);
 	#endif
 
+	#if TEENSY__IDLE_DETECT
+		// if nothing is pressed, set all the driving pins low, and go idle
+		idle = true;
+		for (uint8_t row=0; row<=5; row++)
+			for (uint8_t col=7; col<=0xD; col++)
+				if (matrix[row][col])
+					idle = false;
+		if (idle)
+			drive_all(DDR, SET);  // set low (set as output)
+	#endif
+
 	return 0;  // success
 }
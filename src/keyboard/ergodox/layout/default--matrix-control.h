@@ -18,10 +18,68 @@
 
 	// --------------------------------------------------------------------
 
+	/*
+	 * KB_LAYERS
+	 * - The number of layers in the layout (up to 32); may be defined in
+	 *   the layout's ".h"
+	 * - Every layer takes the same amount of flash, whether or not it's
+	 *   used, so it's best to set this to the number a layout actually has
+	 */
 	#ifndef KB_LAYERS
 		#define KB_LAYERS 10
 	#endif
 
+	#if KB_LAYERS > 32
+		#error "`KB_LAYERS` must be 32 or less"
+	#endif
+
+	/*
+	 * several layouts
+	 *
+	 * If `MAKEFILE_LAYOUTS` is more than 1 (see `EXTRA_LAYOUTS` in
+	 * "makefile-options"), the other layouts are compiled into the
+	 * firmware too, and can be switched between while it's running (with
+	 * `kbfun_layout_next()` or `kbfun_layout_set()`).  Each of them is
+	 * compiled with its own ".h", and with `MAKEFILE_LAYOUT_NUMBER` set
+	 * (1, 2, ...), which renames its matrices here (`_kb_layout__1`,
+	 * etc.).  The 'get' macros then read the matrices of the active
+	 * layout, through pointers kept in SRAM (see "../layouts.c"), and the
+	 * choice is kept in the EEPROM.
+	 *
+	 * - There may be up to 4 layouts
+	 * - They must all use the same encoding (compact or not) as the main
+	 *   one (layouts generated from a "--keys.txt" follow their ".h"), or
+	 *   the link fails
+	 * - Everything else (LEDs, combos, leader sequences, etc.) comes from
+	 *   the main layout: the other layouts' ".c"s should only define
+	 *   their matrices
+	 * - Layouts using `MAKEFILE_DISPATCH` can't use it
+	 */
+
+	#if MAKEFILE_LAYOUTS > 4
+		#error "there may be up to 4 layouts"
+	#endif
+	#if MAKEFILE_LAYOUTS > 1 && MAKEFILE_DISPATCH
+		#error "several layouts can't be used with `DISPATCH`"
+	#endif
+
+	#if MAKEFILE_LAYOUT_NUMBER
+		#define _KB_LAYOUTS_PASTE(name, number)  name ## __ ## number
+		#define _KB_LAYOUTS_NAME(name, number)  \
+			_KB_LAYOUTS_PASTE(name, number)
+
+		#define _kb_layout  \
+			_KB_LAYOUTS_NAME(_kb_layout, MAKEFILE_LAYOUT_NUMBER)
+		#define _kb_layout_press  \
+			_KB_LAYOUTS_NAME(_kb_layout_press, MAKEFILE_LAYOUT_NUMBER)
+		#define _kb_layout_release  \
+			_KB_LAYOUTS_NAME(_kb_layout_release, MAKEFILE_LAYOUT_NUMBER)
+		#define _kb_layout_functions  \
+			_KB_LAYOUTS_NAME(_kb_layout_functions, MAKEFILE_LAYOUT_NUMBER)
+		#define _kb_functions  \
+			_KB_LAYOUTS_NAME(_kb_functions, MAKEFILE_LAYOUT_NUMBER)
+	#endif
+
 	// --------------------------------------------------------------------
 
 	/*
@@ -46,6 +104,143 @@
 	 *   function prototypes, in the layout specific '.h'
 	 */
 
+	/*
+	 * compact encoding
+	 *
+	 * If the layout `#define`s `KB_LAYOUT_COMPACT` (in its ".h"), each key
+	 * is stored as its keycode, plus an index into a table of (press,
+	 * release) function pairs, instead of as a keycode and two function
+	 * pointers: 2 bytes per key instead of 5 (168 bytes per layer, instead
+	 * of 420).  The layout defines
+	 *
+	 * - `_kb_layout[KB_LAYERS][KB_ROWS][KB_COLUMNS]`, as usual
+	 * - `_kb_layout_functions[KB_LAYERS][KB_ROWS][KB_COLUMNS]`: the index
+	 *   of each key's pair (e.g. names from an `enum`, in a
+	 *   `KB_MATRIX_LAYER()`)
+	 * - `_kb_functions[][2]`: the pairs, as `{ press, release }` (up to
+	 *   256 of them; unused keys, which are 0 in `_kb_layout_functions`,
+	 *   should use a pair of `NULL`s)
+	 */
+
+	#if MAKEFILE_LAYOUTS > 1 && !defined(kb_layout_get)
+		// the active layout's matrices
+		struct kb_layouts_tables {
+			const uint8_t (*layout)[KB_ROWS][KB_COLUMNS];
+		#ifdef KB_LAYOUT_COMPACT
+			const uint8_t (*functions)[KB_ROWS][KB_COLUMNS];
+			const kbfun_funptr_t (*pairs)[2];
+		#else
+			const kbfun_funptr_t (*press)[KB_ROWS][KB_COLUMNS];
+			const kbfun_funptr_t (*release)[KB_ROWS][KB_COLUMNS];
+		#endif
+		};
+
+		extern struct kb_layouts_tables kb_layouts_current;
+
+		#define kb_layout_get(layer,row,column) \
+			( (uint8_t) \
+			  pgm_read_byte(&( \
+				kb_layouts_current.layout[layer][row][column] )) )
+
+		#ifdef KB_LAYOUT_COMPACT
+			#define _kb_layouts_functions_get(layer,row,column,i) \
+				( (kbfun_funptr_t) \
+				  pgm_read_word(&( \
+					kb_layouts_current.pairs[ \
+						pgm_read_byte(&( \
+						kb_layouts_current.functions \
+							[layer][row][column] )) \
+					][i] )) )
+
+			#define kb_layout_press_get(layer,row,column) \
+				_kb_layouts_functions_get(layer,row,column,0)
+			#define kb_layout_release_get(layer,row,column) \
+				_kb_layouts_functions_get(layer,row,column,1)
+		#else
+			#define kb_layout_press_get(layer,row,column) \
+				( (kbfun_funptr_t) \
+				  pgm_read_word(&( \
+					kb_layouts_current.press[layer][row][column] )) )
+			#define kb_layout_release_get(layer,row,column) \
+				( (kbfun_funptr_t) \
+				  pgm_read_word(&( \
+					kb_layouts_current.release[layer][row][column] )) )
+		#endif
+
+		#define  KB_LAYOUTS  MAKEFILE_LAYOUTS
+
+		void    kb_layouts_init (void);
+		uint8_t kb_layouts_get  (void);
+		void    kb_layouts_set  (uint8_t layout);
+	#else
+		#define  KB_LAYOUTS  1
+
+		#define  kb_layouts_init()
+		#define  kb_layouts_get()        0
+		#define  kb_layouts_set(layout)
+	#endif
+
+	#if defined(KB_LAYOUT_COMPACT) && !defined(kb_layout_press_get)
+		extern const uint8_t PROGMEM \
+			_kb_layout_functions[KB_LAYERS][KB_ROWS][KB_COLUMNS];
+		extern const kbfun_funptr_t PROGMEM \
+			_kb_functions[][2];
+
+		#define _kb_layout_functions_get(layer,row,column,i) \
+			( (kbfun_funptr_t) \
+			  pgm_read_word(&( \
+				_kb_functions[ \
+					pgm_read_byte(&( \
+					_kb_layout_functions[layer][row][column] )) \
+				][i] )) )
+
+		#define kb_layout_press_get(layer,row,column) \
+			_kb_layout_functions_get(layer,row,column,0)
+		#define kb_layout_release_get(layer,row,column) \
+			_kb_layout_functions_get(layer,row,column,1)
+	#endif
+
+	/*
+	 * generated dispatcher
+	 *
+	 * If `MAKEFILE_DISPATCH` is set, the makefile generates
+	 * "<layout>--dispatch.c" from `_kb_layout_press` and
+	 * `_kb_layout_release` (see "build-scripts/gen-dispatch.py"), and
+	 * `main_exec_key()` uses that instead of the function pointers: each
+	 * key is 1 byte (an action number) per matrix instead of 2, and the
+	 * most used functions are called directly, from a `switch` in
+	 * `kb_dispatch_exec()`, instead of through a pointer read from flash.
+	 * The layout's own function matrices are then unused (and discarded
+	 * by the linker).
+	 *
+	 * - Key functions defined in the layout must not be `static`
+	 * - Layouts using `KB_LAYOUT_COMPACT` can't use it
+	 */
+
+	#if MAKEFILE_DISPATCH
+		#define  KB_DISPATCH_NONE         0
+		#define  KB_DISPATCH_TRANSPARENT  1
+
+		extern const uint8_t PROGMEM \
+			_kb_dispatch_press[KB_LAYERS][KB_ROWS][KB_COLUMNS];
+		extern const uint8_t PROGMEM \
+			_kb_dispatch_release[KB_LAYERS][KB_ROWS][KB_COLUMNS];
+
+		#define kb_dispatch_press_get(layer,row,column) \
+			( (uint8_t) \
+			  pgm_read_byte(&( \
+				_kb_dispatch_press[layer][row][column] )) )
+		#define kb_dispatch_release_get(layer,row,column) \
+			( (uint8_t) \
+			  pgm_read_byte(&( \
+				_kb_dispatch_release[layer][row][column] )) )
+
+		struct key_event;
+		void kb_dispatch_exec(uint8_t action, struct key_event * event);
+	#endif
+
+	// --------------------------------------------------------------------
+
 	#ifndef kb_layout_get
 		extern const uint8_t PROGMEM \
 			       _kb_layout[KB_LAYERS][KB_ROWS][KB_COLUMNS];
@@ -57,21 +252,21 @@
 	#endif
 
 	#ifndef kb_layout_press_get
-		extern const void_funptr_t PROGMEM \
+		extern const kbfun_funptr_t PROGMEM \
 			_kb_layout_press[KB_LAYERS][KB_ROWS][KB_COLUMNS];
 
 		#define kb_layout_press_get(layer,row,column) \
-			( (void_funptr_t) \
+			( (kbfun_funptr_t) \
 			  pgm_read_word(&( \
 				_kb_layout_press[layer][row][column] )) )
 	#endif
 
 	#ifndef kb_layout_release_get
-		extern const void_funptr_t PROGMEM \
+		extern const kbfun_funptr_t PROGMEM \
 			_kb_layout_release[KB_LAYERS][KB_ROWS][KB_COLUMNS];
 
 		#define kb_layout_release_get(layer,row,column) \
-			( (void_funptr_t) \
+			( (kbfun_funptr_t) \
 			  pgm_read_word(&( \
 				_kb_layout_release[layer][row][column] )) )
 
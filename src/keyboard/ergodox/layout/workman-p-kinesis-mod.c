@@ -6,136 +6,23 @@
 * Project located at <https://github.com/benblazak/ergodox-firmware>
 * -------------------------------------------------------------------------- */
 
-// TODO: there is a bug where if you hit an inverted key and a normal key, at
-// the same time, when the 6 key buffer and modifier states are sent the
-// inverted key's shift state can be used for the non-inverted key.
-// Example: hit 1 and q at the same time in workman-p, you may end up with "!Q"
-// instead of "!q".  Not sure how to fix this at present, but it may require
-// sending two frames of updates to properly denote an order (shifted in one
-// update, unshifted added in another, as though shift was released).
-
 #include <stdint.h>
 #include <stddef.h>
 #include <avr/pgmspace.h>
 #include "../../../lib/data-types/misc.h"
 #include "../../../lib/usb/usage-page/keyboard--short-names.h"
+#include "../../../lib/key-functions/public.h"
 #include "../matrix.h"
 #include "../layout.h"
 
-// PRIVATE FUNCTIONS ----------------------------------------------------------
-#include "../../../lib/key-functions/private.h"
-static uint8_t inverted_keys_pressed;
-static bool physical_lshift_pressed;
-static bool physical_rshift_pressed;
-
-void _kbfun_invert_shift_state(void) {
-  // make lshift's state the inverted shift state
-  _kbfun_press_release(!(physical_lshift_pressed|physical_rshift_pressed), KEY_LeftShift);
-  // release rshift
-  _kbfun_press_release(false, KEY_RightShift);
-}
-void _kbfun_restore_shift_state(void) {
-  // restore the state of left and right shift
-  _kbfun_press_release(physical_lshift_pressed, KEY_LeftShift);
-  _kbfun_press_release(physical_rshift_pressed, KEY_RightShift);
-}
-
-
-// PUBLIC FUNCTIONS -----------------------------------------------------------
-#include "../../../lib/key-functions/public.h"
-#include "../../../main.h"
-#define  IS_PRESSED    main_arg_is_pressed
-#define  LAYER         main_arg_layer
-#define  ROW           main_arg_row
-#define  COL           main_arg_col
-
-// TODO: This replaces kbfun_shift_press_release as far as I'm concerned,
-//     though it's technically different.
-/*
- * [name]
- *   Invert shift + press|release
- *
- * [description]
- *   Generate a 'shift' press or release before the normal keypress or
- *   key release if shift is not pressed.  Generate a normal keypress or
- *   key release if shift is pressed.
- */
-void kbfun_shift_inverted_press_release(void) {
-  if (IS_PRESSED) {
-    ++inverted_keys_pressed;
-    _kbfun_invert_shift_state();
-  }
-
-  kbfun_press_release();
-
-  if (!IS_PRESSED) {
-    // if this is the last key we're releasing
-    if (inverted_keys_pressed == 1) {
-      _kbfun_restore_shift_state();
-    }
-    // avoid underflow
-    if (inverted_keys_pressed) {
-      --inverted_keys_pressed;
-    }
-  }
-}
-// TODO: This replaces the default kbfun_press_release,
-//     adding support for shift inversion
-/*
- * [name]
- *   Shift state fix + press|release
- *
- * [description]
- *   If no inverted keys are pressed, simply perform a press and release.
- *   If inverted keys are pressed, fix the shift state back to that of the
- *   physical keys before pressing the key.
- */
-void kbfun_press_release_supporting_shift_inversion(void) {
-  uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
-  bool was_double = (physical_lshift_pressed && physical_rshift_pressed);
-  switch (keycode) {
-    // shift state toggles
-    case KEY_LeftShift:
-      physical_lshift_pressed = IS_PRESSED;
-      break;
-    case KEY_RightShift:
-      physical_rshift_pressed = IS_PRESSED;
-      break;
-    // Keys which don't break it
-    case KEY_CapsLock:
-    case KEYPAD_NumLock_Clear:
-      kbfun_press_release();
-      return;
-    default:
-      // If we're not just changing the modifier, we need our true shift state.
-      if (inverted_keys_pressed) {
-        inverted_keys_pressed = 0;
-        _kbfun_restore_shift_state();
-      }
-      kbfun_press_release();
-      return;
-  }
-  // We only get here if we pressed left or right shift
-  // Handle double-shift caps lock as the state changed
-  if (was_double != (physical_lshift_pressed && physical_rshift_pressed)) {
-    // IS_PRESSED gives current double state if you think about it.
-    _kbfun_press_release(IS_PRESSED, KEY_CapsLock);
-	// Don't stop normal handling; fall through
-  }
-  if (inverted_keys_pressed) {
-    _kbfun_invert_shift_state();
-  } else {
-    kbfun_press_release();
-  }
-}
-
 // DEFINITIONS ----------------------------------------------------------------
 // --- key functions
-#define  kprrel   &kbfun_press_release_supporting_shift_inversion // overridden
+#define  kprrel   &kbfun_press_release
 #define  mprrel   &kbfun_mediakey_press_release
 #define  ktog     &kbfun_toggle
 #define  ktrans   &kbfun_transparent
 #define  sinvert  &kbfun_shift_inverted_press_release
+#define  s2kcap   &kbfun_2_keys_capslock_press_release
 // --- layer push/pop functions
 #define  lpush1   &kbfun_layer_push_1
 #define  lpush2   &kbfun_layer_push_2
@@ -312,7 +199,7 @@ KB_MATRIX_LAYER(
 // ----------------------------------------------------------------------------
 
 // PRESS ----------------------------------------------------------------------
-const void_funptr_t PROGMEM _kb_layout_press[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
+const kbfun_funptr_t PROGMEM _kb_layout_press[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
 // LAYER 0 - Base layout
 KB_MATRIX_LAYER(
   NULL /*no key*/,
@@ -320,7 +207,7 @@ KB_MATRIX_LAYER(
   kprrel, sinvert, sinvert, sinvert, sinvert, sinvert,   kprrel,
   kprrel, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    lpush1,
   kprrel, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    /*no key*/
-  kprrel, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    kprrel,
+  s2kcap, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    kprrel,
   kprrel, kprrel,  kprrel,  kprrel,  kprrel,  /*no key*/ /*no key*/
   // left thumb
   /*no key*/       kprrel,          kprrel,
@@ -331,7 +218,7 @@ KB_MATRIX_LAYER(
   ltog2,     sinvert,   sinvert, sinvert, sinvert, sinvert, kprrel,
   lpush1,    kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
   /*no key*/ kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
-  kprrel,    kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
+  kprrel,    kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  s2kcap,
   /*no key*/ /*no key*/ kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
   // right thumb
   kprrel, kprrel,          /*no key*/
@@ -467,7 +354,7 @@ KB_MATRIX_LAYER(
 // ----------------------------------------------------------------------------
 
 // RELEASE --------------------------------------------------------------------
-const void_funptr_t PROGMEM _kb_layout_release[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
+const kbfun_funptr_t PROGMEM _kb_layout_release[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
 // LAYER 0 - Base layout
 KB_MATRIX_LAYER(
   NULL /*no key*/,
@@ -475,7 +362,7 @@ KB_MATRIX_LAYER(
   kprrel, sinvert, sinvert, sinvert, sinvert, sinvert,   kprrel,
   kprrel, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    lpop1,
   kprrel, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    /*no key*/
-  kprrel, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    kprrel,
+  s2kcap, kprrel,  kprrel,  kprrel,  kprrel,  kprrel,    kprrel,
   kprrel, kprrel,  kprrel,  kprrel,  kprrel,  /*no key*/ /*no key*/
   // left thumb
   /*no key*/       kprrel,          kprrel,
@@ -486,7 +373,7 @@ KB_MATRIX_LAYER(
   NULL,      sinvert,   sinvert, sinvert, sinvert, sinvert, kprrel,
   lpop1,     kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
   /*no key*/ kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
-  kprrel,    kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
+  kprrel,    kprrel,    kprrel,  kprrel,  kprrel,  kprrel,  s2kcap,
   /*no key*/ /*no key*/ kprrel,  kprrel,  kprrel,  kprrel,  kprrel,
   // right thumb
   kprrel, kprrel,          /*no key*/
@@ -0,0 +1,124 @@
+/* ----------------------------------------------------------------------------
+ * ergoDOX : several layouts : code
+ *
+ * Keeps track of which of the layouts compiled into the firmware is active
+ * (see "layout/default--matrix-control.h"): its number is kept in the EEPROM,
+ * and pointers to its matrices in SRAM (so looking up a key takes the same
+ * one read from flash as with a single layout).
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include "../../main.h"
+#include "./matrix.h"
+#include "./layout.h"
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_LAYOUTS > 1
+// ----------------------------------------------------------------------------
+
+// each layout's matrices (`suffix` is empty for the main layout, and `__1`,
+// `__2`, ... for the others; see "layout/default--matrix-control.h")
+#ifdef KB_LAYOUT_COMPACT
+	#define  DECLARE(suffix)					\
+		extern const uint8_t PROGMEM				\
+			_kb_layout ## suffix[][KB_ROWS][KB_COLUMNS];	\
+		extern const uint8_t PROGMEM				\
+			_kb_layout_functions ## suffix			\
+				[][KB_ROWS][KB_COLUMNS];		\
+		extern const kbfun_funptr_t PROGMEM			\
+			_kb_functions ## suffix[][2]
+
+	#define  TABLES(suffix)						\
+		{ _kb_layout ## suffix,					\
+		  _kb_layout_functions ## suffix,			\
+		  _kb_functions ## suffix }
+#else
+	#define  DECLARE(suffix)					\
+		extern const uint8_t PROGMEM				\
+			_kb_layout ## suffix[][KB_ROWS][KB_COLUMNS];	\
+		extern const kbfun_funptr_t PROGMEM			\
+			_kb_layout_press ## suffix[][KB_ROWS][KB_COLUMNS]; \
+		extern const kbfun_funptr_t PROGMEM			\
+			_kb_layout_release ## suffix[][KB_ROWS][KB_COLUMNS]
+
+	#define  TABLES(suffix)						\
+		{ _kb_layout ## suffix,					\
+		  _kb_layout_press ## suffix,				\
+		  _kb_layout_release ## suffix }
+#endif
+
+DECLARE();
+DECLARE(__1);
+#if MAKEFILE_LAYOUTS > 2
+DECLARE(__2);
+#endif
+#if MAKEFILE_LAYOUTS > 3
+DECLARE(__3);
+#endif
+
+static const struct kb_layouts_tables PROGMEM layouts[] = {
+	TABLES(),
+	TABLES(__1),
+#if MAKEFILE_LAYOUTS > 2
+	TABLES(__2),
+#endif
+#if MAKEFILE_LAYOUTS > 3
+	TABLES(__3),
+#endif
+};
+
+// ----------------------------------------------------------------------------
+
+// (the main layout, until `kb_layouts_init()`)
+struct kb_layouts_tables kb_layouts_current = TABLES();
+
+static uint8_t current;
+static uint8_t EEMEM saved;
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Make the layout saved in the EEPROM active (or the main one, if the number
+ * saved isn't a layout's)
+ */
+void kb_layouts_init(void) {
+	uint8_t layout = eeprom_read_byte(&saved);
+	kb_layouts_set( (layout < MAKEFILE_LAYOUTS) ? layout : 0 );
+}
+
+uint8_t kb_layouts_get(void) {
+	return current;
+}
+
+/*
+ * Make a layout active, and save its number in the EEPROM (if it changed)
+ *
+ * Notes
+ * - Keys that are held keep the layer they were pressed on, but are released
+ *   with the new layout's functions: callers should release them first (see
+ *   `kbfun_layout_set()`)
+ */
+void kb_layouts_set(uint8_t layout) {
+	if (layout >= MAKEFILE_LAYOUTS)
+		return;
+
+	current = layout;
+	memcpy_P( &kb_layouts_current, &layouts[layout],
+	          sizeof(kb_layouts_current) );
+	eeprom_update_byte(&saved, layout);
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
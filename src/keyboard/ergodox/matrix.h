@@ -15,6 +15,11 @@
 	#define KB_ROWS      6  // must match real life
 	#define KB_COLUMNS  14  // must match real life
 
+	// the number of columns in each independently scanned block of the
+	// matrix (each hand is its own 6x7 matrix, with its own diodes, so
+	// ghosting can only happen within a hand)
+	#define KB_BLOCK_COLUMNS  7
+
 	// --------------------------------------------------------------------
 
 	/* mapping from spatial position to matrix position
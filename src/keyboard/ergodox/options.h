@@ -37,4 +37,48 @@
 	#define  MCP23018__DRIVE_ROWS     0
 	#define  MCP23018__DRIVE_COLUMNS  1
 
+	/*
+	 * TEENSY__IDLE_DETECT
+	 * - The same idea as `MCP23018__IDLE_INTERRUPT` (below), for the right
+	 *   hand: when nothing is pressed, drive all the driving pins low at
+	 *   once, and only strobe them one at a time again after one of the
+	 *   sensing pins goes low
+	 * - The sensing pins are polled (once per scan) rather than interrupt
+	 *   driven: with the default pin assignments the rows are on port F,
+	 *   which has no pin change interrupts on the ATmega32U4
+	 */
+	#define  TEENSY__IDLE_DETECT  1
+
+	/*
+	 * MCP23018__IDLE_INTERRUPT
+	 * - When no keys on the left hand are pressed, drive all the driving
+	 *   pins low at once and skip the full (row by row, or column by
+	 *   column) scan until one of the input pins changes
+	 *
+	 * MCP23018__INT_PIN_WIRED and MCP23018__INT_PIN
+	 * - If the MCP23018's INTB pin (or INTA, if driving rows) is wired to
+	 *   a spare Teensy pin, set `MCP23018__INT_PIN_WIRED` to 1, and
+	 *   `MCP23018__INT_PIN` to that pin (it should be one of the `UNUSED`
+	 *   pins in "controller/teensy-2-0.c", since those are already set as
+	 *   inputs with pull-ups)
+	 * - If it isn't wired (the standard TRRS cable only has 4 conductors),
+	 *   leave `MCP23018__INT_PIN_WIRED` at 0; the idle check will then be
+	 *   a single register read per scan, instead of the full set of
+	 *   transactions
+	 */
+	#define  MCP23018__IDLE_INTERRUPT  1
+	#define  MCP23018__INT_PIN_WIRED   0
+	#define  MCP23018__INT_PIN         D, 7  // `UNUSED_1`
+
+	/*
+	 * MCP23018__RETRY_SCANS
+	 * - After the I2C bus locks up (a wait times out; see `TWI_TIMEOUT` in
+	 *   "src/lib/twi/teensy-2-0.h"), how many scans to leave the left hand
+	 *   out of before trying it again (20 scans is about 100ms, with the
+	 *   default `DEBOUNCE_TIME`).  The right hand keeps working; and a scan
+	 *   that fails takes at most `TWI_TIMEOUT`, plus about 110μs to recover
+	 *   the bus, longer than a full scan.
+	 */
+	#define  MCP23018__RETRY_SCANS  20
+
 #endif
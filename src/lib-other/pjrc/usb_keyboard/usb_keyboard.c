@@ -56,6 +56,7 @@
 /* report id */
 #define REPORT_ID_SYSTEM    2
 #define REPORT_ID_CONSUMER  3
+#define REPORT_ID_HOST      4
 
 /**************************************************************************
  *
@@ -71,14 +72,43 @@
 
 #define EXTRA_INTERFACE		1
 #define EXTRA_ENDPOINT		2
-#define EXTRA_SIZE		8
+#define EXTRA_SIZE		16
 #define EXTRA_BUFFER		EP_DOUBLE_BUFFER
 
+#define MOUSE_INTERFACE		2
+#define MOUSE_ENDPOINT		3
+#define MOUSE_SIZE		8
+#define MOUSE_BUFFER		EP_DOUBLE_BUFFER
+
+#if MAKEFILE_MOUSE_KEYS
+#define STENO_INTERFACE		3
+#else
+#define STENO_INTERFACE		2
+#endif
+#define STENO_ENDPOINT		4
+#define STENO_SIZE		8
+#define STENO_BUFFER		EP_DOUBLE_BUFFER
+
+
+// the largest report on the extra interface (the consumer report) has to fit
+// in one packet
+#if 1 + 2*CONSUMER_KEYS > EXTRA_SIZE
+#error "CONSUMER_KEYS is too large for EXTRA_SIZE"
+#endif
 
 static const uint8_t PROGMEM endpoint_config_table[] = {
 	1, EP_TYPE_INTERRUPT_IN,  EP_SIZE(KEYBOARD_SIZE) | KEYBOARD_BUFFER,
 	1, EP_TYPE_INTERRUPT_IN,  EP_SIZE(EXTRA_SIZE)    | EXTRA_BUFFER,    // 4
-	0
+#if MAKEFILE_MOUSE_KEYS
+	1, EP_TYPE_INTERRUPT_IN,  EP_SIZE(MOUSE_SIZE)    | MOUSE_BUFFER,
+#else
+	0,
+#endif
+#if MAKEFILE_STENO
+	1, EP_TYPE_INTERRUPT_IN,  EP_SIZE(STENO_SIZE)    | STENO_BUFFER,
+#else
+	0,
+#endif
 };
 
 
@@ -151,6 +181,19 @@ static const uint8_t PROGMEM keyboard_hid_report_desc[] = {
 // audio controls & system controls
 // http://www.microsoft.com/whdc/archive/w2kbd.mspx
 static const uint8_t PROGMEM extra_hid_report_desc[] = {
+    /* system control */
+    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x80,                    // USAGE (System Control)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x85, REPORT_ID_SYSTEM,        //   REPORT_ID (2)
+    0x15, 0x01,                    //   LOGICAL_MINIMUM (0x1)
+    0x26, 0xb7, 0x00,              //   LOGICAL_MAXIMUM (0xb7)
+    0x19, 0x01,                    //   USAGE_MINIMUM (0x1)
+    0x29, 0xb7,                    //   USAGE_MAXIMUM (0xb7)
+    0x75, 0x10,                    //   REPORT_SIZE (16)
+    0x95, 0x01,                    //   REPORT_COUNT (1)
+    0x81, 0x00,                    //   INPUT (Data,Array,Abs)
+    0xc0,                          // END_COLLECTION
     /* consumer */
     0x05, 0x0c,                    // USAGE_PAGE (Consumer Devices)
     0x09, 0x01,                    // USAGE (Consumer Control)
@@ -161,18 +204,100 @@ static const uint8_t PROGMEM extra_hid_report_desc[] = {
     0x19, 0x01,                    //   USAGE_MINIMUM (0x1)
     0x2a, 0x9c, 0x02,              //   USAGE_MAXIMUM (0x29c)
     0x75, 0x10,                    //   REPORT_SIZE (16)
-    0x95, 0x01,                    //   REPORT_COUNT (1)
+    0x95, CONSUMER_KEYS,           //   REPORT_COUNT (4)
     0x81, 0x00,                    //   INPUT (Data,Array,Abs)
     0xc0,                          // END_COLLECTION
+#if MAKEFILE_DIAGNOSTICS
+    /* host channel (vendor defined) */
+    0x06, 0x00, 0xff,              // USAGE_PAGE (Vendor Defined 0xFF00)
+    0x09, 0x01,                    // USAGE (Vendor Usage 1)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x85, REPORT_ID_HOST,          //   REPORT_ID (4)
+    0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x95, USB_HOST_REPORT_SIZE,    //   REPORT_COUNT (30)
+    0x09, 0x01,                    //   USAGE (Vendor Usage 1)
+    0xb1, 0x02,                    //   FEATURE (Data,Var,Abs)
+    0xc0,                          // END_COLLECTION
+#endif
 };
 
+#if MAKEFILE_MOUSE_KEYS
+// Mouse Protocol 1, HID 1.11 spec, Appendix B, page 59-60, with buttons 4 and 5,
+// a wheel, and horizontal scrolling (AC Pan) added
+static const uint8_t PROGMEM mouse_hid_report_desc[] = {
+    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x02,                    // USAGE (Mouse)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x09, 0x01,                    //   USAGE (Pointer)
+    0xa1, 0x00,                    //   COLLECTION (Physical)
+    0x05, 0x09,                    //     USAGE_PAGE (Button)
+    0x19, 0x01,                    //     USAGE_MINIMUM (Button 1)
+    0x29, 0x05,                    //     USAGE_MAXIMUM (Button 5)
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //     LOGICAL_MAXIMUM (1)
+    0x95, 0x05,                    //     REPORT_COUNT (5)
+    0x75, 0x01,                    //     REPORT_SIZE (1)
+    0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x75, 0x03,                    //     REPORT_SIZE (3)
+    0x81, 0x03,                    //     INPUT (Cnst,Var,Abs)
+    0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,                    //     USAGE (X)
+    0x09, 0x31,                    //     USAGE (Y)
+    0x09, 0x38,                    //     USAGE (Wheel)
+    0x15, 0x81,                    //     LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,                    //     LOGICAL_MAXIMUM (127)
+    0x75, 0x08,                    //     REPORT_SIZE (8)
+    0x95, 0x03,                    //     REPORT_COUNT (3)
+    0x81, 0x06,                    //     INPUT (Data,Var,Rel)
+    0x05, 0x0c,                    //     USAGE_PAGE (Consumer Devices)
+    0x0a, 0x38, 0x02,              //     USAGE (AC Pan)
+    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x81, 0x06,                    //     INPUT (Data,Var,Rel)
+    0xc0,                          //   END_COLLECTION
+    0xc0,                          // END_COLLECTION
+};
+#endif
+
+#if MAKEFILE_STENO
+// Vendor defined: one GeminiPR packet (6 bytes) per stroke
+static const uint8_t PROGMEM steno_hid_report_desc[] = {
+    0x06, 0x00, 0xff,              // USAGE_PAGE (Vendor Defined Page 1)
+    0x09, 0x02,                    // USAGE (Vendor Usage 2)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x09, 0x02,                    //   USAGE (Vendor Usage 2)
+    0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x95, USB_STENO_PACKET_SIZE,   //   REPORT_COUNT (6)
+    0x81, 0x02,                    //   INPUT (Data,Var,Abs)
+    0xc0                           // END_COLLECTION
+};
+#endif
+
 #define KEYBOARD_HID_DESC_NUM                0
 #define KEYBOARD_HID_DESC_OFFSET             (9+(9+9+7)*KEYBOARD_HID_DESC_NUM+9)
 
 #   define EXTRA_HID_DESC_NUM           (KEYBOARD_HID_DESC_NUM + 1)
 #   define EXTRA_HID_DESC_OFFSET        (9+(9+9+7)*EXTRA_HID_DESC_NUM+9)
 
-#define NUM_INTERFACES                  (EXTRA_HID_DESC_NUM + 1)
+#if MAKEFILE_MOUSE_KEYS
+#   define MOUSE_HID_DESC_NUM           (EXTRA_HID_DESC_NUM + 1)
+#   define MOUSE_HID_DESC_OFFSET        (9+(9+9+7)*MOUSE_HID_DESC_NUM+9)
+#   define LAST_HID_DESC_NUM            MOUSE_HID_DESC_NUM
+#else
+#   define LAST_HID_DESC_NUM            EXTRA_HID_DESC_NUM
+#endif
+
+#if MAKEFILE_STENO
+#   define STENO_HID_DESC_NUM           (LAST_HID_DESC_NUM + 1)
+#   define STENO_HID_DESC_OFFSET        (9+(9+9+7)*STENO_HID_DESC_NUM+9)
+#   define NUM_INTERFACES               (STENO_HID_DESC_NUM + 1)
+#else
+#   define NUM_INTERFACES               (LAST_HID_DESC_NUM + 1)
+#endif
 #define CONFIG1_DESC_SIZE               (9+(9+9+7)*NUM_INTERFACES)
 //#define KEYBOARD_HID_DESC_OFFSET (9+9)
 static const uint8_t PROGMEM config1_descriptor[CONFIG1_DESC_SIZE] = {
@@ -240,6 +365,64 @@ static const uint8_t PROGMEM config1_descriptor[CONFIG1_DESC_SIZE] = {
 	0x03,					// bmAttributes (0x03=intr)
 	EXTRA_SIZE, 0,				// wMaxPacketSize
 	10,					// bInterval
+#if MAKEFILE_MOUSE_KEYS
+
+	// interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+	9,					// bLength
+	4,					// bDescriptorType
+	MOUSE_INTERFACE,			// bInterfaceNumber
+	0,					// bAlternateSetting
+	1,					// bNumEndpoints
+	0x03,					// bInterfaceClass (0x03 = HID)
+	0x00,					// bInterfaceSubClass
+	0x00,					// bInterfaceProtocol
+	0,					// iInterface
+	// HID descriptor, HID 1.11 spec, section 6.2.1
+	9,					// bLength
+	0x21,					// bDescriptorType
+	0x11, 0x01,				// bcdHID
+	0,					// bCountryCode
+	1,					// bNumDescriptors
+	0x22,					// bDescriptorType
+	sizeof(mouse_hid_report_desc),		// wDescriptorLength
+	0,
+	// endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+	7,					// bLength
+	5,					// bDescriptorType
+	MOUSE_ENDPOINT | 0x80,			// bEndpointAddress
+	0x03,					// bmAttributes (0x03=intr)
+	MOUSE_SIZE, 0,				// wMaxPacketSize
+	1,					// bInterval (every frame)
+#endif
+#if MAKEFILE_STENO
+
+	// interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+	9,					// bLength
+	4,					// bDescriptorType
+	STENO_INTERFACE,			// bInterfaceNumber
+	0,					// bAlternateSetting
+	1,					// bNumEndpoints
+	0x03,					// bInterfaceClass (0x03 = HID)
+	0x00,					// bInterfaceSubClass
+	0x00,					// bInterfaceProtocol
+	0,					// iInterface
+	// HID descriptor, HID 1.11 spec, section 6.2.1
+	9,					// bLength
+	0x21,					// bDescriptorType
+	0x11, 0x01,				// bcdHID
+	0,					// bCountryCode
+	1,					// bNumDescriptors
+	0x22,					// bDescriptorType
+	sizeof(steno_hid_report_desc),		// wDescriptorLength
+	0,
+	// endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+	7,					// bLength
+	5,					// bDescriptorType
+	STENO_ENDPOINT | 0x80,			// bEndpointAddress
+	0x03,					// bmAttributes (0x03=intr)
+	STENO_SIZE, 0,				// wMaxPacketSize
+	1,					// bInterval
+#endif
 };
 
 // If you're desperate for a little extra code memory, these strings
@@ -284,6 +467,16 @@ static struct descriptor_list_struct {
 	    // Extra HID Descriptor
 	{0x2100, EXTRA_INTERFACE, config1_descriptor+EXTRA_HID_DESC_OFFSET, 9},
 	{0x2200, EXTRA_INTERFACE, extra_hid_report_desc, sizeof(extra_hid_report_desc)},
+#if MAKEFILE_MOUSE_KEYS
+	    // Mouse HID Descriptor
+	{0x2100, MOUSE_INTERFACE, config1_descriptor+MOUSE_HID_DESC_OFFSET, 9},
+	{0x2200, MOUSE_INTERFACE, mouse_hid_report_desc, sizeof(mouse_hid_report_desc)},
+#endif
+#if MAKEFILE_STENO
+	    // Steno HID Descriptor
+	{0x2100, STENO_INTERFACE, config1_descriptor+STENO_HID_DESC_OFFSET, 9},
+	{0x2200, STENO_INTERFACE, steno_hid_report_desc, sizeof(steno_hid_report_desc)},
+#endif
         // STRING descriptors
 	{0x0300, 0x0000, (const uint8_t *)&string0, 4},
 	{0x0301, 0x0409, (const uint8_t *)&string1, sizeof(STR_MANUFACTURER)},
@@ -324,9 +517,17 @@ static uint8_t keyboard_idle_count=0;
 // 1=num lock, 2=caps lock, 4=scroll lock, 8=compose, 16=kana
 volatile uint8_t keyboard_leds=0;
 
-// which consumer key is currently pressed
-uint16_t consumer_key;
-uint16_t last_consumer_key;
+// which consumer keys are currently pressed, up to CONSUMER_KEYS may be down
+// at once
+uint16_t consumer_keys[CONSUMER_KEYS];
+
+// which system control key is currently pressed
+uint16_t system_key;
+
+// the last report successfully sent for each report ID on the extra
+// interface, so that only changes are sent
+static uint16_t last_consumer_keys[CONSUMER_KEYS];
+static uint16_t last_system_key;
 
 
 /**************************************************************************
@@ -406,6 +607,32 @@ int8_t usb_keyboard_send(void)
 	return 0;
 }
 
+// send a report with the given modifiers and keys (instead of the contents of
+// keyboard_modifier_keys and keyboard_keys), only if the endpoint is ready right
+// now: returns -1 without waiting if it isn't
+int8_t usb_keyboard_send_report(uint8_t modifiers, const uint8_t *keys)
+{
+	uint8_t i, intr_state;
+
+	if (!usb_configuration) return -1;
+	intr_state = SREG;
+	cli();
+	UENUM = KEYBOARD_ENDPOINT;
+	if (!(UEINTX & (1<<RWAL))) {
+		SREG = intr_state;
+		return -1;
+	}
+	UEDATX = modifiers;
+	UEDATX = 0;
+	for (i=0; i<6; i++) {
+		UEDATX = keys[i];
+	}
+	UEINTX = 0x3A;
+	keyboard_idle_count = 0;
+	SREG = intr_state;
+	return 0;
+}
+
 /**************************************************************************
  *
  *  Private Functions - not intended for general user consumption....
@@ -449,6 +676,21 @@ ISR(USB_GEN_vect)
 				}
 			}
 		}
+		#if MAKEFILE_MOUSE_KEYS
+		// mouse movement is computed (and sent) at the frame rate, not
+		// the scan rate
+		usb_mouse_frame();
+		UENUM = MOUSE_ENDPOINT;
+		if (UEINTX & (1<<RWAL)) {
+			uint8_t report[USB_MOUSE_REPORT_SIZE];
+			if (usb_mouse_report(report)) {
+				for (i=0; i<USB_MOUSE_REPORT_SIZE; i++) {
+					UEDATX = report[i];
+				}
+				UEINTX = 0x3A;
+			}
+		}
+		#endif
 	}
 }
 
@@ -555,6 +797,11 @@ ISR(USB_COM_vect)
 		}
 		if (bRequest == SET_CONFIGURATION && bmRequestType == 0) {
 			usb_configuration = wValue;
+			// the host starts from nothing pressed
+			last_system_key = 0;
+			for (i=0; i<CONSUMER_KEYS; i++) {
+				last_consumer_keys[i] = 0;
+			}
 			usb_send_in();
 			cfg = endpoint_config_table;
 			for (i=1; i<5; i++) {
@@ -656,13 +903,45 @@ ISR(USB_COM_vect)
 				}
 			}
 		}
+		#if MAKEFILE_DIAGNOSTICS
+		// host channel (feature report, so the report type is 3)
+		if (wIndex == EXTRA_INTERFACE && wValue == ((3<<8)|REPORT_ID_HOST)) {
+			uint8_t report[USB_HOST_REPORT_SIZE];
+			if (bmRequestType == 0xA1 && bRequest == HID_GET_REPORT) {
+				usb_host_report_get(report);
+				// (report ID + report fits in one packet)
+				len = (wLength < 1+USB_HOST_REPORT_SIZE)
+				    ? wLength : 1+USB_HOST_REPORT_SIZE;
+				usb_wait_in_ready();
+				if (len) UEDATX = REPORT_ID_HOST;
+				for (i=1; i<len; i++) {
+					UEDATX = report[i-1];
+				}
+				usb_send_in();
+				return;
+			}
+			if (bmRequestType == 0x21 && bRequest == HID_SET_REPORT) {
+				usb_wait_receive_out();
+				n = UEBCLX;
+				if (n) { n--; i = UEDATX; }  // skip the report ID
+				for (i=0; i<USB_HOST_REPORT_SIZE; i++) {
+					report[i] = (i < n) ? UEDATX : 0;
+				}
+				usb_ack_out();
+				usb_host_report_set(report);
+				usb_send_in();
+				return;
+			}
+		}
+		#endif
 	}
 	UECONX = (1<<STALLRQ) | (1<<EPEN);	// stall
 }
 
-int8_t usb_extra_send(uint8_t report_id, uint16_t data)
+// send a report (of `count` 16 bit values) on the extra interface
+int8_t usb_extra_send(uint8_t report_id, const uint16_t *data, uint8_t count)
 {
-	uint8_t intr_state, timeout;
+	uint8_t i, intr_state, timeout;
 
 	if (!usb_configured()) return -1;
 	intr_state = SREG;
@@ -684,24 +963,79 @@ int8_t usb_extra_send(uint8_t report_id, uint16_t data)
 	}
 
 	UEDATX = report_id;
-        UEDATX = data&0xFF;
-        UEDATX = (data>>8)&0xFF;
+	for (i=0; i<count; i++) {
+		UEDATX = data[i]&0xFF;
+		UEDATX = (data[i]>>8)&0xFF;
+	}
 
 	UEINTX = 0x3A;
 	SREG = intr_state;
 	return 0;
 }
 
-int8_t usb_extra_consumer_send(void)
+// send a report on the extra interface, only if it's changed since the last
+// time it was sent successfully (`last` holds what was last sent)
+static int8_t usb_extra_send_changed(uint8_t report_id,
+	const uint16_t *data, uint16_t *last, uint8_t count)
 {
-	int result = 0;
-	// don't resend the same key repeatedly if held, only send it once.
-	if (consumer_key != last_consumer_key) {
-		result = usb_extra_send(REPORT_ID_CONSUMER, consumer_key);
-		if (result == 0) {
-			last_consumer_key = consumer_key;
-		}
+	uint8_t i;
+
+	for (i=0; i<count; i++) {
+		if (data[i] != last[i]) break;
+	}
+	if (i == count) return 0;  // no change
+	if (usb_extra_send(report_id, data, count)) return -1;
+	for (i=0; i<count; i++) {
+		last[i] = data[i];
+	}
+	return 0;
+}
+
+#if MAKEFILE_STENO
+// send one steno stroke (a GeminiPR packet) on the steno interface
+int8_t usb_steno_send(const uint8_t *packet)
+{
+	uint8_t i, intr_state, timeout;
+
+	if (!usb_configured()) return -1;
+	intr_state = SREG;
+	cli();
+	UENUM = STENO_ENDPOINT;
+	timeout = UDFNUML + 50;
+	while (1) {
+		// are we ready to transmit?
+		if (UEINTX & (1<<RWAL)) break;
+		SREG = intr_state;
+		// has the USB gone offline?
+		if (!usb_configured()) return -1;
+		// have we waited too long?
+		if (UDFNUML == timeout) return -1;
+		// get ready to try checking again
+		intr_state = SREG;
+		cli();
+		UENUM = STENO_ENDPOINT;
+	}
+
+	for (i=0; i<USB_STENO_PACKET_SIZE; i++) {
+		UEDATX = packet[i];
 	}
+
+	UEINTX = 0x3A;
+	SREG = intr_state;
+	return 0;
+}
+#endif
+
+// send the system control and consumer reports (whichever have changed)
+int8_t usb_extra_send_changes(void)
+{
+	int8_t result;
+
+	result = usb_extra_send_changed(REPORT_ID_SYSTEM,
+		&system_key, &last_system_key, 1);
+	if (usb_extra_send_changed(REPORT_ID_CONSUMER,
+		consumer_keys, last_consumer_keys, CONSUMER_KEYS))
+		result = -1;
 	return result;
 }
 
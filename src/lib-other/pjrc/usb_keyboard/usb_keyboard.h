@@ -8,11 +8,14 @@ uint8_t usb_configured(void);		// is the USB port configured
 
 int8_t usb_keyboard_press(uint8_t key, uint8_t modifier);
 int8_t usb_keyboard_send(void);
+int8_t usb_keyboard_send_report(uint8_t modifiers, const uint8_t *keys);
 extern uint8_t keyboard_modifier_keys;
 extern uint8_t keyboard_keys[6];
 extern volatile uint8_t keyboard_leds;
 
-extern uint16_t consumer_key;
+#define CONSUMER_KEYS	4  // how many consumer keys may be down at once
+extern uint16_t consumer_keys[CONSUMER_KEYS];
+extern uint16_t system_key;
 
 // This file does not include the HID debug functions, so these empty
 // macros replace them with nothing, so users can compile code that
@@ -20,7 +23,27 @@ extern uint16_t consumer_key;
 #define usb_debug_putchar(c)
 #define usb_debug_flush_output()
 
-int8_t usb_extra_consumer_send(void);
+int8_t usb_extra_send_changes(void);
+
+// host channel: a vendor defined feature report on the extra interface.  these
+// are called from the USB interrupt, and must be defined elsewhere (see
+// "src/lib/diagnostics/host.c")
+#define USB_HOST_REPORT_SIZE	30  // not counting the report ID
+void usb_host_report_set(const uint8_t *report);
+void usb_host_report_get(uint8_t *report);
+
+// mouse: called from the start of frame interrupt, and must be defined
+// elsewhere (see "src/lib/mouse-keys/motion.c").  `usb_mouse_frame()` is
+// called every frame; `usb_mouse_report()` when the endpoint is ready, and
+// returns non-zero if it filled in a report to send
+#define USB_MOUSE_REPORT_SIZE	5  // buttons, x, y, wheel, pan
+void usb_mouse_frame(void);
+uint8_t usb_mouse_report(uint8_t *report);
+
+// steno: one stroke per report, as a GeminiPR packet (see
+// "src/lib/steno/gemini-pr.h")
+#define USB_STENO_PACKET_SIZE	6
+int8_t usb_steno_send(const uint8_t *packet);
 
 #if 0  // removed in favor of equivalent code elsewhere ::Ben Blazak, 2012::
 
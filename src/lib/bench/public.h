@@ -0,0 +1,61 @@
+/* ----------------------------------------------------------------------------
+ * bench : public exports
+ *
+ * A build of the firmware for measuring it under simavr (see "readme.md").
+ * Compiled in by `make bench` (in the top level makefile), which sets
+ * `MAKEFILE_BENCH`; if it isn't set, the calls here compile to nothing.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__BENCH__PUBLIC_h
+	#define LIB__BENCH__PUBLIC_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include "../../keyboard/matrix.h"
+
+	// --------------------------------------------------------------------
+
+	/*
+	 * BENCH_LATENCY_MAX
+	 * - How many scans a key event can wait for a report that changes
+	 *   before it's counted as not having changed one (e.g. a layer key)
+	 *
+	 * BENCH_TAIL
+	 * - How many scans to keep going after the last event of the corpus
+	 *   (so timeouts, e.g. for leader keys or combos, can run out)
+	 */
+	#define  BENCH_LATENCY_MAX  100
+	#define  BENCH_TAIL         250
+
+	// corpus entries (used by the generated code): the number of scans to
+	// wait after the last event, then the key, and whether it's pressed
+	#define  BENCH_EVENT(wait, row, column, is_pressed)		\
+		{ (wait), ((is_pressed) ? 0x80 : 0) | (row) << 4 | (column) }
+
+	// --------------------------------------------------------------------
+
+	#if MAKEFILE_BENCH
+
+		void bench_init          (void);
+		void bench_update_matrix (bool matrix[KB_ROWS][KB_COLUMNS]);
+		void bench_scan_start    (void);
+		void bench_scan_end      (void);
+		void bench_event_start   (void);
+		void bench_event_end     (void);
+
+	#else
+
+		#define  bench_scan_start()
+		#define  bench_scan_end()
+		#define  bench_event_start()
+		#define  bench_event_end()
+
+	#endif
+
+#endif
+
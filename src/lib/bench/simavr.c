@@ -0,0 +1,204 @@
+/* ----------------------------------------------------------------------------
+ * bench : simavr : code
+ *
+ * Plays the corpus (generated by "build-scripts/gen-bench.py") into the key
+ * matrix, one scan at a time, and writes measurements to the simavr console,
+ * one per line:
+ * - `bench s <cycles>`: the length of a scan (from the start of the main
+ *   loop to the sleep before the next one)
+ * - `bench e <cycles>`: the length of a call to `main_key_event()`
+ * - `bench l <scans>`: for each report that differs from the last, the
+ *   number of scans since the earliest key event it's the first report after
+ * - `bench n`: a key event that no report changed for within
+ *   `BENCH_LATENCY_MAX` scans
+ * - `bench end`
+ *
+ * Notes
+ * - The USB interface is never initialized (so the send functions return
+ *   right away), and neither is the controller (so no TWI traffic): the
+ *   cycles counted are for everything but reading the matrix and sending
+ *   the reports
+ * - Cycles are counted with Timer/Counter3 (unused otherwise), running at
+ *   the CPU clock, and extended to 32 bits by its overflow interrupt
+ * - Measurements from a scan are buffered, and written after it's measured
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../../keyboard/matrix.h"
+#include "../timer.h"
+#include "./public.h"
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_BENCH
+// ----------------------------------------------------------------------------
+
+#include <avr/avr_mcu_section.h>  // (from simavr)
+
+AVR_MCU(F_CPU, "atmega32u4");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+// generated by "build-scripts/gen-bench.py"
+extern const uint8_t PROGMEM bench_corpus[][2];
+extern const uint16_t bench_corpus_length;
+
+// ----------------------------------------------------------------------------
+
+#define  EVENTS_PER_SCAN  16  // the most `main_key_event()`s measured per scan
+
+static volatile uint16_t overflows;
+
+static bool     matrix[KB_ROWS][KB_COLUMNS];  // as played so far
+static uint16_t next;  // the next corpus entry
+static uint8_t  wait;  // scans left before it
+static uint16_t scan;  // (number)
+static uint16_t tail;  // scans since the corpus ended
+
+static uint32_t scan_start;
+static uint32_t event_start;
+static uint32_t events[EVENTS_PER_SCAN];
+static uint8_t  events_count;
+
+static bool     pending;       // whether a key event is waiting for a report
+static uint16_t pending_scan;  // the scan of the earliest one
+static uint8_t  last_report[7];
+
+// ----------------------------------------------------------------------------
+
+ISR(TIMER3_OVF_vect) {
+	overflows++;
+}
+
+static uint32_t now(void) {
+	uint16_t high, low;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		low  = TCNT3;
+		high = overflows;
+		// (an overflow that hasn't been counted yet)
+		if ((TIFR3 & (1<<TOV3)) && low < 0x8000)
+			high++;
+	}
+	return (uint32_t)high << 16 | low;
+}
+
+static void print(const char * s) {
+	while (*s)
+		GPIOR0 = *s++;
+}
+
+static void print_sample(char kind, uint32_t value) {
+	char buffer[11];
+	print("bench ");
+	GPIOR0 = kind;
+	GPIOR0 = ' ';
+	print(ultoa(value, buffer, 10));
+	GPIOR0 = '\r';
+}
+
+// ----------------------------------------------------------------------------
+
+void bench_init(void) {
+	timer_init();
+
+	// Timer/Counter3: normal mode, clock/1, overflow interrupt
+	TCCR3A = 0;
+	TCCR3B = (1<<CS30);
+	TIMSK3 = (1<<TOIE3);
+
+	wait = pgm_read_byte(&bench_corpus[0][0]);
+
+	sei();
+}
+
+void bench_update_matrix(bool m[KB_ROWS][KB_COLUMNS]) {
+	while (next < bench_corpus_length) {
+		if (wait) {
+			wait--;
+			break;
+		}
+		uint8_t key = pgm_read_byte(&bench_corpus[next][1]);
+		matrix[(key >> 4) & 0x07][key & 0x0F] = key >> 7;
+		if (!pending) {
+			pending = true;
+			pending_scan = scan;
+		}
+		if (++next < bench_corpus_length)
+			wait = pgm_read_byte(&bench_corpus[next][0]);
+	}
+
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		for (uint8_t col=0; col<KB_COLUMNS; col++)
+			m[row][col] = matrix[row][col];
+}
+
+void bench_scan_start(void) {
+	scan_start = now();
+}
+
+void bench_scan_end(void) {
+	uint32_t length = now() - scan_start;
+	bool changed = false;
+
+	print_sample('s', length);
+	for (uint8_t i=0; i<events_count; i++)
+		print_sample('e', events[i]);
+	events_count = 0;
+
+	// report latency
+	if (keyboard_modifier_keys != last_report[0]) {
+		last_report[0] = keyboard_modifier_keys;
+		changed = true;
+	}
+	for (uint8_t i=0; i<6; i++) {
+		if (keyboard_keys[i] != last_report[i+1]) {
+			last_report[i+1] = keyboard_keys[i];
+			changed = true;
+		}
+	}
+	if (pending && changed) {
+		print_sample('l', scan - pending_scan);
+		pending = false;
+	} else if (pending && scan - pending_scan >= BENCH_LATENCY_MAX) {
+		print("bench n\r");
+		pending = false;
+	}
+
+	scan++;
+
+	// stop the simulation (simavr quits when the CPU sleeps with
+	// interrupts disabled)
+	if (next == bench_corpus_length && ++tail > BENCH_TAIL && !pending) {
+		print("bench end\r");
+		cli();
+		sleep_enable();
+		sleep_cpu();
+	}
+}
+
+void bench_event_start(void) {
+	event_start = now();
+}
+
+void bench_event_end(void) {
+	if (events_count < EVENTS_PER_SCAN)
+		events[events_count++] = now() - event_start;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
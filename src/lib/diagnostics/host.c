@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * diagnostics : host channel : code
+ *
+ * The host reads diagnostics through a vendor defined feature report on the
+ * extra USB interface: it sets the report to select a page (and an offset
+ * into it), then gets the report to read the data.  See "readme.md" for the
+ * format.
+ *
+ * Note
+ * - These are called from the USB interrupt.  A read may mix values from two
+ *   consecutive scans, but no single value will be torn (values longer than a
+ *   byte are updated atomically).
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_DIAGNOSTICS
+// ----------------------------------------------------------------------------
+
+
+#include <stdint.h>
+#include "../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../../keyboard/matrix.h"
+#include "../twi.h"
+#include "./public.h"
+
+// ----------------------------------------------------------------------------
+
+#define  HEADER_SIZE  3  // page, offset, length
+
+// ----------------------------------------------------------------------------
+
+static uint8_t selected_page;
+static uint8_t selected_offset;
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Called when the host sets the report
+ * - `report[0]`: the page to select
+ * - `report[1]`: the offset (in keys, for per key pages) to start at
+ */
+void usb_host_report_set(const uint8_t * report) {
+	if (report[0] == DIAG_PAGE_CLEAR) {
+		diag_matrix_clear();
+		diag_stats_clear();
+		twi_errors_clear();
+		return;
+	}
+
+	selected_page = report[0];
+	selected_offset = report[1];
+}
+
+/*
+ * Called when the host gets the report
+ * - `report[0]`: the selected page
+ * - `report[1]`: the selected offset
+ * - `report[2]`: the number of valid data bytes that follow (0 if the page
+ *   doesn't exist, or the offset is past the end of it)
+ */
+void usb_host_report_get(uint8_t * report) {
+	uint8_t * data = report + HEADER_SIZE;
+	uint8_t length = 0;
+
+	for (uint8_t i=0; i<USB_HOST_REPORT_SIZE; i++)
+		report[i] = 0;
+
+	if (selected_page == DIAG_PAGE_INFO) {
+		data[length++] = DIAG_VERSION;
+		data[length++] = KB_ROWS;
+		data[length++] = KB_COLUMNS;
+		data[length++] = USB_HOST_REPORT_SIZE - HEADER_SIZE;
+		data[length++] = MAKEFILE_DEBOUNCE_TIME;
+		data[length++] = DIAG_TICK_TIME & 0xFF;
+		data[length++] = DIAG_TICK_TIME >> 8;
+		data[length++] = DIAG_STUCK_TIME;
+		data[length++] = DIAG_CHATTER_LIMIT;
+		data[length++] = DIAG_KEY_STATS;
+		data[length++] = DIAG_SCAN_BOUNCE_TIME;
+	} else if (selected_page == DIAG_PAGE_TWI_ERRORS) {
+		// (one report's worth, so nothing past offset 0)
+		for (uint8_t i=0; i<TWI_ERRORS && !selected_offset; i++) {
+			data[length++] = twi_errors[i] & 0xFF;
+			data[length++] = twi_errors[i] >> 8;
+		}
+	} else if (selected_page < DIAG_PAGE_PRESS_COUNT) {
+		length = diag_matrix_page( selected_page, selected_offset,
+		                           data, USB_HOST_REPORT_SIZE-HEADER_SIZE );
+	} else {
+		length = diag_stats_page( selected_page, selected_offset,
+		                          data, USB_HOST_REPORT_SIZE-HEADER_SIZE );
+	}
+
+	report[0] = selected_page;
+	report[1] = selected_offset;
+	report[2] = length;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,250 @@
+/* ----------------------------------------------------------------------------
+ * diagnostics : matrix checks : code
+ *
+ * Run over the matrix after each scan (before any keys are executed).  Keys
+ * that are flagged may be masked (set to released) in the matrix that the rest
+ * of the firmware sees; what was actually read is kept in
+ * `DIAG_FLAG_PRESSED`.
+ *
+ * - Ghosting: a rectangle is 2 rows with 2 or more pressed columns in common,
+ *   within one block of the matrix.  With a diode on every key (as on the
+ *   ErgoDox) that's just 4 keys pressed together, so keys pressed into one
+ *   are only counted.  Without diodes (or with a bad one) one of the corners
+ *   may not really be pressed, and we can't tell which; so with
+ *   `DIAG_MASK_GHOST` (the usual approach) keys in the rectangle that weren't
+ *   already pressed in the last scan are masked until the rectangle goes
+ *   away.
+ * - Stuck keys: keys held down for longer than `DIAG_STUCK_TIME` are counted
+ *   (and, with `DIAG_MASK_STUCK`, masked until they're released).
+ * - Chatter: keys pressed more than `DIAG_CHATTER_LIMIT` times in a one
+ *   second window are masked until they go a whole window without a press.
+ *
+ * Each of these increments a (saturating) per key counter, once per event.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_DIAGNOSTICS
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../keyboard/matrix.h"
+#include "../timer.h"
+#include "./public.h"
+
+// ----------------------------------------------------------------------------
+
+#ifndef KB_BLOCK_COLUMNS
+	#define  KB_BLOCK_COLUMNS  KB_COLUMNS
+#endif
+
+#if KB_BLOCK_COLUMNS > 8
+	#error "KB_BLOCK_COLUMNS must be 8 or less (so a row fits in a byte)"
+#endif
+#if KB_COLUMNS % KB_BLOCK_COLUMNS
+	#error "KB_COLUMNS must be a multiple of KB_BLOCK_COLUMNS"
+#endif
+
+#define  STUCK_TICKS   ( DIAG_STUCK_TIME * 1000UL / DIAG_TICK_TIME )
+#define  WINDOW_TICKS  ( 1000 / DIAG_TICK_TIME )
+
+#if STUCK_TICKS > 255
+	#error "DIAG_STUCK_TIME is too long for DIAG_TICK_TIME"
+#endif
+
+#define  MASKED  ( DIAG_FLAG_CHATTER                               \
+                  | (DIAG_MASK_GHOST ? DIAG_FLAG_GHOST : 0)        \
+                  | (DIAG_MASK_STUCK ? DIAG_FLAG_STUCK : 0) )
+
+// saturating increment
+#define  inc(var)  do { if ((var) < 0xFF) (var)++; } while(0)
+
+// ----------------------------------------------------------------------------
+
+static uint8_t flags        [KB_ROWS][KB_COLUMNS];
+static uint8_t held_ticks   [KB_ROWS][KB_COLUMNS];
+static uint8_t presses      [KB_ROWS][KB_COLUMNS];  // in this window
+
+static uint8_t ghost_count  [KB_ROWS][KB_COLUMNS];
+static uint8_t stuck_count  [KB_ROWS][KB_COLUMNS];
+static uint8_t chatter_count[KB_ROWS][KB_COLUMNS];
+
+static uint16_t last_tick;
+static uint8_t  window_ticks;
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Set `DIAG_FLAG_GHOST` for the keys that were just pressed into a ghosting
+ * rectangle (or, if they're masked, are still masked because of one), and
+ * clear it for everything else
+ */
+static void check_ghosting( bool is_pressed[KB_ROWS][KB_COLUMNS],
+                            bool was_pressed[KB_ROWS][KB_COLUMNS] ) {
+	for (uint8_t first=0; first<KB_COLUMNS; first+=KB_BLOCK_COLUMNS) {
+		uint8_t rows[KB_ROWS];
+		uint8_t ghost_rows = 0;  // bitmask
+		uint8_t ghost_cols = 0;  // bitmask
+
+		for (uint8_t row=0; row<KB_ROWS; row++) {
+			rows[row] = 0;
+			for (uint8_t col=0; col<KB_BLOCK_COLUMNS; col++)
+				if (is_pressed[row][first+col])
+					rows[row] |= (1<<col);
+		}
+
+		for (uint8_t r1=0; r1<KB_ROWS; r1++) {
+			// (no rectangle unless the row has at least 2 keys pressed)
+			if (!(rows[r1] & (rows[r1]-1)))
+				continue;
+			for (uint8_t r2=r1+1; r2<KB_ROWS; r2++) {
+				uint8_t common = rows[r1] & rows[r2];
+				if (common & (common-1)) {
+					ghost_rows |= (1<<r1)|(1<<r2);
+					ghost_cols |= common;
+				}
+			}
+		}
+
+		for (uint8_t row=0; row<KB_ROWS; row++) {
+			for (uint8_t col=0; col<KB_BLOCK_COLUMNS; col++) {
+				uint8_t * f = &flags[row][first+col];
+				if ( (ghost_rows & (1<<row))
+				     && (ghost_cols & (1<<col))
+				     && is_pressed[row][first+col]
+				     && ! was_pressed[row][first+col] ) {
+					if (!(*f & DIAG_FLAG_GHOST))
+						inc(ghost_count[row][first+col]);
+					*f |= DIAG_FLAG_GHOST;
+				} else {
+					*f &= ~DIAG_FLAG_GHOST;
+				}
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Arguments
+ * - `is_pressed`: the matrix, as just read; masked keys will be set to
+ *   released
+ * - `was_pressed`: the matrix from the last scan (after masking)
+ */
+void diag_matrix_check( bool is_pressed[KB_ROWS][KB_COLUMNS],
+                        bool was_pressed[KB_ROWS][KB_COLUMNS] ) {
+	bool tick = false;
+	bool window_end = false;
+
+	if ((uint16_t)(timer_get_ms() - last_tick) >= DIAG_TICK_TIME) {
+		last_tick += DIAG_TICK_TIME;
+		tick = true;
+		if (++window_ticks >= WINDOW_TICKS) {
+			window_ticks = 0;
+			window_end = true;
+		}
+	}
+
+	check_ghosting(is_pressed, was_pressed);
+
+	for (uint8_t row=0; row<KB_ROWS; row++) {
+		for (uint8_t col=0; col<KB_COLUMNS; col++) {
+			uint8_t f = flags[row][col];
+
+			if (is_pressed[row][col]) {
+				// chatter
+				if (!(f & DIAG_FLAG_PRESSED)) {
+					inc(presses[row][col]);
+					if ( presses[row][col] > DIAG_CHATTER_LIMIT
+					     && !(f & DIAG_FLAG_CHATTER) ) {
+						f |= DIAG_FLAG_CHATTER;
+						inc(chatter_count[row][col]);
+					}
+				}
+				// stuck
+				if (tick)
+					inc(held_ticks[row][col]);
+				if ( held_ticks[row][col] >= STUCK_TICKS
+				     && !(f & DIAG_FLAG_STUCK) ) {
+					f |= DIAG_FLAG_STUCK;
+					inc(stuck_count[row][col]);
+				}
+				f |= DIAG_FLAG_PRESSED;
+			} else {
+				held_ticks[row][col] = 0;
+				f &= ~(DIAG_FLAG_STUCK|DIAG_FLAG_PRESSED);
+			}
+
+			if (window_end) {
+				if (!presses[row][col])
+					f &= ~DIAG_FLAG_CHATTER;
+				presses[row][col] = 0;
+			}
+
+			if (f & MASKED)
+				is_pressed[row][col] = false;
+
+			flags[row][col] = f;
+		}
+	}
+}
+
+/*
+ * Reset all the counters (the flags are left alone, since they're current
+ * state)
+ */
+void diag_matrix_clear(void) {
+	for (uint8_t row=0; row<KB_ROWS; row++) {
+		for (uint8_t col=0; col<KB_COLUMNS; col++) {
+			ghost_count[row][col] = 0;
+			stuck_count[row][col] = 0;
+			chatter_count[row][col] = 0;
+		}
+	}
+}
+
+/*
+ * Copy part of one of the per key tables (for the host)
+ *
+ * Arguments
+ * - `page`: which table (one of the `DIAG_PAGE_*` per key pages)
+ * - `offset`: the first key to copy (keys are numbered `row*KB_COLUMNS+col`)
+ * - `data`: where to copy to
+ * - `length`: the maximum number of bytes to copy
+ *
+ * Returns
+ * - success: the number of bytes copied
+ * - failure: 0 (unknown page, or `offset` is out of bounds)
+ */
+uint8_t diag_matrix_page( uint8_t page, uint8_t offset,
+                          uint8_t * data, uint8_t length ) {
+	const uint8_t * table;
+	uint8_t i;
+
+	switch (page) {
+		case DIAG_PAGE_FLAGS:         table = &flags[0][0];         break;
+		case DIAG_PAGE_GHOST_COUNT:   table = &ghost_count[0][0];   break;
+		case DIAG_PAGE_STUCK_COUNT:   table = &stuck_count[0][0];   break;
+		case DIAG_PAGE_CHATTER_COUNT: table = &chatter_count[0][0]; break;
+		default: return 0;
+	}
+
+	for (i=0; i<length && offset+i < KB_ROWS*KB_COLUMNS; i++)
+		data[i] = table[offset+i];
+
+	return i;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,153 @@
+/* ----------------------------------------------------------------------------
+ * diagnostics : public exports
+ *
+ * Checks the key matrix (after each scan) for readings that can't be trusted,
+ * masks the keys involved, and keeps per key counters that the host can read.
+ * Compiled in if `DIAGNOSTICS` is set in "src/makefile-options"; if not, the
+ * calls here compile to nothing.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__DIAGNOSTICS__PUBLIC_h
+	#define LIB__DIAGNOSTICS__PUBLIC_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include "../../keyboard/matrix.h"
+
+	// --------------------------------------------------------------------
+
+	/*
+	 * DIAG_TICK_TIME
+	 * - The resolution (in ms) of the stuck key timer
+	 *
+	 * DIAG_STUCK_TIME
+	 * - How long (in seconds) a key can be held down before it's considered
+	 *   stuck (and counted; and masked until it's released, if
+	 *   `DIAG_MASK_STUCK`)
+	 *
+	 * DIAG_CHATTER_LIMIT
+	 * - How many times (per second) a key can be pressed before it's
+	 *   considered to be chattering, and masked (until it goes a second
+	 *   without being pressed)
+	 */
+	#ifndef DIAG_TICK_TIME
+		#define  DIAG_TICK_TIME      250
+	#endif
+	#ifndef DIAG_STUCK_TIME
+		#define  DIAG_STUCK_TIME     60
+	#endif
+	#ifndef DIAG_CHATTER_LIMIT
+		#define  DIAG_CHATTER_LIMIT  20
+	#endif
+
+	/*
+	 * DIAG_MASK_GHOST
+	 * - Whether to mask keys that are part of a ghosting rectangle, instead
+	 *   of only counting them.  With a diode on every key (as on the
+	 *   ErgoDox), a rectangle is a real chord (e.g. a steno stroke, or a 4
+	 *   key combo), so this should only be set for a matrix without diodes
+	 *   (or to work around a bad one).
+	 *
+	 * DIAG_MASK_STUCK
+	 * - Whether to mask keys held longer than `DIAG_STUCK_TIME` (until
+	 *   they're released), instead of only counting them.  Layer keys,
+	 *   modifiers, and game keys may well be held that long on purpose.
+	 */
+	#ifndef DIAG_MASK_GHOST
+		#define  DIAG_MASK_GHOST  0
+	#endif
+	#ifndef DIAG_MASK_STUCK
+		#define  DIAG_MASK_STUCK  0
+	#endif
+
+	/*
+	 * DIAG_KEY_STATS
+	 * - Whether to keep per key statistics (press count, scan bounce count,
+	 *   shortest and longest scan bounce, and the length of the last stuck
+	 *   press); costs 11 bytes of SRAM per matrix position (924 bytes on
+	 *   the ErgoDox, on top of the matrix checks), so it's off by default
+	 *
+	 * DIAG_SCAN_BOUNCE_TIME
+	 * - Changes (as read by the scan) that happen within this many ms of
+	 *   the last change to the same key are counted as part of one scan
+	 *   bounce
+	 *
+	 * Notes
+	 * - The matrix is sampled once per scan, every `DEBOUNCE_TIME` ms, so
+	 *   contact bounce shorter than that is never seen: a "scan bounce" is
+	 *   a key that changed again in a later scan, measured in multiples of
+	 *   the scan period, not the bounce of the switch itself.  It's still
+	 *   useful for tuning: if keys show scan bounces with the usual
+	 *   `DEBOUNCE_TIME`, their contacts bounce (or chatter) for longer than
+	 *   a scan, and `DEBOUNCE_TIME` should be a bit longer than the longest
+	 *   one seen.
+	 */
+	#ifndef DIAG_KEY_STATS
+		#define  DIAG_KEY_STATS         0
+	#endif
+	#ifndef DIAG_SCAN_BOUNCE_TIME
+		#define  DIAG_SCAN_BOUNCE_TIME  20
+	#endif
+
+	// per key flags (current state)
+	#define  DIAG_FLAG_GHOST    (1<<0)  // part of a ghosting rectangle
+	#define  DIAG_FLAG_STUCK    (1<<1)  // held longer than DIAG_STUCK_TIME
+	#define  DIAG_FLAG_CHATTER  (1<<2)  // pressed too often
+	#define  DIAG_FLAG_PRESSED  (1<<7)  // pressed (before masking)
+
+	// host channel pages (see "readme.md")
+	#define  DIAG_PAGE_INFO           0x00
+	#define  DIAG_PAGE_FLAGS          0x01
+	#define  DIAG_PAGE_GHOST_COUNT    0x02
+	#define  DIAG_PAGE_STUCK_COUNT    0x03
+	#define  DIAG_PAGE_CHATTER_COUNT  0x04
+	#define  DIAG_PAGE_TWI_ERRORS     0x05
+	#define  DIAG_PAGE_PRESS_COUNT    0x10
+	#define  DIAG_PAGE_SCAN_BOUNCE_COUNT  0x11
+	#define  DIAG_PAGE_SCAN_BOUNCE_MIN    0x12
+	#define  DIAG_PAGE_SCAN_BOUNCE_MAX    0x13
+	#define  DIAG_PAGE_STUCK_TIME     0x14
+	#define  DIAG_PAGE_CLEAR          0x7F
+
+	#define  DIAG_VERSION  2
+
+	// --------------------------------------------------------------------
+
+	#if MAKEFILE_DIAGNOSTICS
+
+		void diag_matrix_check( bool is_pressed[KB_ROWS][KB_COLUMNS],
+		                        bool was_pressed[KB_ROWS][KB_COLUMNS] );
+
+		void diag_matrix_clear(void);
+		uint8_t diag_matrix_page( uint8_t page, uint8_t offset,
+		                          uint8_t * data, uint8_t length );
+
+	#else
+
+		#define  diag_matrix_check(is_pressed, was_pressed)
+
+	#endif
+
+	#if MAKEFILE_DIAGNOSTICS && DIAG_KEY_STATS
+
+		void diag_stats_update(bool is_pressed[KB_ROWS][KB_COLUMNS]);
+
+		void diag_stats_clear(void);
+		uint8_t diag_stats_page( uint8_t page, uint8_t offset,
+		                         uint8_t * data, uint8_t length );
+
+	#else
+
+		#define  diag_stats_update(is_pressed)
+		#define  diag_stats_clear()
+		#define  diag_stats_page(page, offset, data, length)  0
+
+	#endif
+
+#endif
+
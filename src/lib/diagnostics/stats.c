@@ -0,0 +1,213 @@
+/* ----------------------------------------------------------------------------
+ * diagnostics : per key statistics : code
+ *
+ * Run over the matrix after each scan, before the matrix checks (so chatter
+ * and stuck keys are counted even though they'll be masked).
+ *
+ * - A "scan bounce" is a run of changes to one key, seen in scans each within
+ *   `DIAG_SCAN_BOUNCE_TIME` of the last.  Its duration is the time from the
+ *   first change seen to the last.  A single clean change isn't one.
+ * - The matrix is only sampled once per scan (every `DEBOUNCE_TIME` ms), so
+ *   contact bounce shorter than a scan is never seen, and what is seen is
+ *   measured in whole scan periods: these are the changes that got past the
+ *   scan rate, not the bounce of the switch itself.
+ * - A press is counted when a key settles in the pressed state after being
+ *   released (so a scan bounce that settles where it started isn't a press).
+ * - A press that lasted at least `DIAG_STUCK_TIME` has its length (in
+ *   seconds) recorded as the last stuck interval.
+ *
+ * All counters saturate instead of rolling over.
+ *
+ * Notes
+ * - Times within a scan bounce are kept as the low byte of the millisecond timer;
+ *   every key is looked at every scan, so as long as a scan is shorter than
+ *   `256 - DIAG_SCAN_BOUNCE_TIME` ms, the differences are always correct.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <util/atomic.h>
+#include "../../keyboard/matrix.h"
+#include "../timer.h"
+#include "./public.h"
+
+// ----------------------------------------------------------------------------
+// conditional compile (after the includes, since `DIAG_KEY_STATS` is defined
+// in "public.h")
+#if MAKEFILE_DIAGNOSTICS && DIAG_KEY_STATS
+// ----------------------------------------------------------------------------
+
+#if DIAG_SCAN_BOUNCE_TIME > 200
+	#error "DIAG_SCAN_BOUNCE_TIME must be 200ms or less"
+#endif
+
+// `state` bits
+#define  PRESSED   (1<<0)  // as of the last scan
+#define  SETTLED   (1<<1)  // the state before the current scan bounce
+#define  CHANGING  (1<<2)  // within DIAG_SCAN_BOUNCE_TIME of the last change
+#define  BOUNCED   (1<<3)  // more than one change since CHANGING was set
+
+// saturating increments
+// - 16 bit values are incremented atomically, since the host channel reads
+//   them from the USB interrupt
+#define  inc8(var)   do { if ((var) < 0xFF) (var)++; } while(0)
+#define  inc16(var)  do { if ((var) < 0xFFFF)				\
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { (var)++; } } while(0)
+
+// ----------------------------------------------------------------------------
+
+struct key_stats {
+	uint16_t presses;
+	uint16_t scan_bounces;
+	uint8_t  scan_bounce_min;  // ms; only valid if `scan_bounces`
+	uint8_t  scan_bounce_max;  // ms
+	uint8_t  stuck_time;       // s; length of the last stuck press
+	uint8_t  held_time;        // s; length of the current press
+	uint8_t  last_change;      // ms; low byte of the timer
+	uint8_t  scan_bounce_time; // ms; length of the current one, so far
+	uint8_t  state;
+};
+
+static struct key_stats stats[KB_ROWS][KB_COLUMNS];
+
+static uint16_t last_second;
+
+// ----------------------------------------------------------------------------
+
+void diag_stats_update(bool is_pressed[KB_ROWS][KB_COLUMNS]) {
+	uint16_t now = timer_get_ms();
+	uint8_t  now_low = now;
+	bool     second = false;
+
+	if ((uint16_t)(now - last_second) >= 1000) {
+		last_second += 1000;
+		second = true;
+	}
+
+	for (uint8_t row=0; row<KB_ROWS; row++) {
+		for (uint8_t col=0; col<KB_COLUMNS; col++) {
+			struct key_stats * s = &stats[row][col];
+			bool pressed = is_pressed[row][col];
+			uint8_t since = now_low - s->last_change;
+
+			// stuck interval
+			if (pressed) {
+				if (second)
+					inc8(s->held_time);
+			} else if (s->held_time) {
+				if (s->held_time >= DIAG_STUCK_TIME)
+					s->stuck_time = s->held_time;
+				s->held_time = 0;
+			}
+
+			// scan bounces and presses
+			if (pressed != (bool)(s->state & PRESSED)) {
+				if (s->state & CHANGING) {
+					s->state |= BOUNCED;
+					uint8_t t = s->scan_bounce_time;
+					s->scan_bounce_time = (since > 0xFF - t) ? 0xFF : t + since;
+				} else {
+					s->state |= CHANGING;
+					s->scan_bounce_time = 0;
+				}
+				s->state ^= PRESSED;
+				s->last_change = now_low;
+			} else if ( (s->state & CHANGING)
+			            && since >= DIAG_SCAN_BOUNCE_TIME ) {
+				if (s->state & BOUNCED) {
+					if ( !s->scan_bounces
+					     || s->scan_bounce_time < s->scan_bounce_min )
+						s->scan_bounce_min = s->scan_bounce_time;
+					if (s->scan_bounce_time > s->scan_bounce_max)
+						s->scan_bounce_max = s->scan_bounce_time;
+					inc16(s->scan_bounces);
+				}
+				if (pressed && !(s->state & SETTLED))
+					inc16(s->presses);
+
+				s->state &= ~(CHANGING|BOUNCED|SETTLED);
+				if (pressed)
+					s->state |= SETTLED;
+			}
+		}
+	}
+}
+
+/*
+ * Reset all the counters (but not the state of any scan bounce in progress)
+ */
+void diag_stats_clear(void) {
+	for (uint8_t row=0; row<KB_ROWS; row++) {
+		for (uint8_t col=0; col<KB_COLUMNS; col++) {
+			struct key_stats * s = &stats[row][col];
+			s->presses = 0;
+			s->scan_bounces = 0;
+			s->scan_bounce_min = 0;
+			s->scan_bounce_max = 0;
+			s->stuck_time = 0;
+		}
+	}
+}
+
+/*
+ * Copy part of one of the per key statistics (for the host)
+ *
+ * Arguments
+ * - `page`: which statistic (one of the `DIAG_PAGE_*` per key statistics
+ *   pages)
+ * - `offset`: the first key to copy (keys are numbered `row*KB_COLUMNS+col`)
+ * - `data`: where to copy to (16 bit values are copied little endian)
+ * - `length`: the maximum number of bytes to copy
+ *
+ * Returns
+ * - success: the number of bytes copied (a whole number of values)
+ * - failure: 0 (unknown page, or `offset` is out of bounds)
+ */
+uint8_t diag_stats_page( uint8_t page, uint8_t offset,
+                         uint8_t * data, uint8_t length ) {
+	uint8_t field, size;
+	uint8_t i = 0;
+
+	switch (page) {
+		case DIAG_PAGE_PRESS_COUNT:
+			field = offsetof(struct key_stats, presses);
+			size = 2; break;
+		case DIAG_PAGE_SCAN_BOUNCE_COUNT:
+			field = offsetof(struct key_stats, scan_bounces);
+			size = 2; break;
+		case DIAG_PAGE_SCAN_BOUNCE_MIN:
+			field = offsetof(struct key_stats, scan_bounce_min);
+			size = 1; break;
+		case DIAG_PAGE_SCAN_BOUNCE_MAX:
+			field = offsetof(struct key_stats, scan_bounce_max);
+			size = 1; break;
+		case DIAG_PAGE_STUCK_TIME:
+			field = offsetof(struct key_stats, stuck_time);
+			size = 1; break;
+		default:
+			return 0;
+	}
+
+	for ( uint8_t key=offset;
+	      key < KB_ROWS*KB_COLUMNS && i+size <= length;
+	      key++ ) {
+		// (avr is little endian)
+		const uint8_t * value = (const uint8_t *)(&stats[0][0] + key) + field;
+		for (uint8_t b=0; b<size; b++)
+			data[i++] = value[b];
+	}
+
+	return i;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,166 @@
+/* ----------------------------------------------------------------------------
+ * key functions : auto-shift : code
+ *
+ * Notes
+ * - Pending keys are kept in the order they were pressed, so the oldest is
+ *   always first: that's the one that times out first, the one that's
+ *   evicted, and (along with any pressed before it) the ones sent when a key
+ *   is released
+ * - Keys are sent with `usb_keyboard_send()` as soon as they're resolved, one
+ *   report per key, so that keys resolved in the same scan still reach the
+ *   host in order
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../../lib/usb/usage-page/keyboard.h"
+#include "../../keyboard/matrix.h"
+#include "../timer.h"
+#include "./private.h"
+#include "./autoshift.h"
+#include "./unicode.h"
+
+// ----------------------------------------------------------------------------
+
+// keys pressed, but not yet sent (oldest first)
+static struct {
+	uint8_t  row;
+	uint8_t  col;
+	uint8_t  keycode;
+	uint16_t since;
+} pending[AUTOSHIFT_PENDING];
+static uint8_t pending_count;
+
+// keys sent shifted, and still held (one bit per column, for each row)
+static uint16_t shifted[KB_ROWS];
+static uint8_t  shifted_count;
+static bool     shift_was_pressed;  // (before the first shifted key)
+
+// whether we're sending keys ourselves (so presses shouldn't flush)
+static bool busy;
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Send the oldest pending key (shifted or not), and remove it from the list
+ */
+static void send_oldest(bool shift) {
+	uint8_t row = pending[0].row;
+	uint8_t col = pending[0].col;
+
+	// (shift pressed for another key, not by the user, shouldn't apply)
+	bool unshift = !shift && shifted_count && !shift_was_pressed;
+
+	busy = true;
+	if (shift) {
+		if (!shifted_count++) {
+			shift_was_pressed = _kbfun_is_pressed(KEY_LeftShift);
+			_kbfun_press_release(true, KEY_LeftShift);
+		}
+		shifted[row] |= (1U << col);
+	}
+	if (unshift)
+		_kbfun_press_release(false, KEY_LeftShift);
+	_kbfun_press_release(true, pending[0].keycode);
+	if (!unicode_is_sending())  // (it would land in the middle of one)
+		usb_keyboard_send();
+	if (unshift)
+		_kbfun_press_release(true, KEY_LeftShift);
+	busy = false;
+
+	pending_count--;
+	for (uint8_t i=0; i<pending_count; i++)
+		pending[i] = pending[i+1];
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Press or release an auto-shift key
+ *
+ * Arguments
+ * - `press`: whether this is a press or a release
+ * - `row`, `col`: the key's position in the matrix
+ * - `keycode`: the (unshifted) keycode to send
+ */
+void autoshift_press_release( bool press, uint8_t row, uint8_t col,
+                              uint8_t keycode ) {
+	uint8_t i;
+
+	if (press) {
+		if (pending_count == AUTOSHIFT_PENDING)
+			send_oldest(false);  // (to make room)
+		pending[pending_count].row     = row;
+		pending[pending_count].col     = col;
+		pending[pending_count].keycode = keycode;
+		pending[pending_count].since   = timer_get_ms();
+		pending_count++;
+		return;
+	}
+
+	for (i=0; i<pending_count; i++)
+		if (pending[i].row == row && pending[i].col == col)
+			break;
+
+	// a tap: send (unshifted) everything pressed before this key, then
+	// this key
+	if (i < pending_count) {
+		for (; i; i--)
+			send_oldest(false);
+		send_oldest(false);
+		_kbfun_press_release(false, keycode);
+		return;
+	}
+
+	// already sent
+	_kbfun_press_release(false, keycode);
+	if (shifted[row] & (1U << col)) {
+		shifted[row] &= ~(1U << col);
+		if (!--shifted_count && !shift_was_pressed)
+			_kbfun_press_release(false, KEY_LeftShift);
+	}
+}
+
+/*
+ * Send all pending keys (unshifted)
+ *
+ * Called before any other key press, so keys are sent in the order they were
+ * pressed
+ */
+void autoshift_flush(void) {
+	if (busy)
+		return;
+
+	while (pending_count)
+		send_oldest(false);
+}
+
+/*
+ * Called once per scan: send (shifted) any keys held long enough
+ */
+void autoshift_update(void) {
+	while ( pending_count && (uint16_t)(timer_get_ms() - pending[0].since)
+	                         >= AUTOSHIFT_TIME )
+		send_oldest(true);
+}
+
+/*
+ * Forget all pending and shifted keys (releasing the shift pressed for them),
+ * e.g. when the layout is switched
+ */
+void autoshift_reset(void) {
+	if (shifted_count && !shift_was_pressed)
+		_kbfun_press_release(false, KEY_LeftShift);
+
+	pending_count = 0;
+	shifted_count = 0;
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		shifted[row] = 0;
+}
+
@@ -0,0 +1,61 @@
+/* ----------------------------------------------------------------------------
+ * key functions : auto-shift : exports
+ *
+ * Keys using `kbfun_autoshift_press_release` send their keycode if tapped,
+ * and shift + their keycode if held for at least `AUTOSHIFT_TIME` ms.
+ *
+ * Since it isn't known which to send until the key is released (or the time
+ * is up), presses are held back ("pending") until then.  To keep characters
+ * in the order they were typed
+ * - any other key press sends all pending keys first (unshifted), since
+ *   they were pressed before it
+ * - releasing a pending key sends all the keys pending before it first
+ *   (unshifted, since they weren't held long enough either)
+ * - keys that were pending before a key that timed out, have already timed
+ *   out themselves (and been sent)
+ * - if more keys are pending than there's room for, the oldest is sent
+ *   (unshifted) to make room
+ *
+ * A key that's sent shifted holds shift down until it's released (so the
+ * host's key repeat repeats the shifted character).  Other auto-shift keys
+ * sent unshifted in the meantime still are.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__KEY_FUNCTIONS__AUTOSHIFT_h
+	#define LIB__KEY_FUNCTIONS__AUTOSHIFT_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include "../../keyboard/layout.h"
+
+	// --------------------------------------------------------------------
+
+	/*
+	 * AUTOSHIFT_TIME
+	 * - How long (in ms) a key has to be held to be sent shifted
+	 * - May be defined in the layout's ".h"
+	 *
+	 * AUTOSHIFT_PENDING
+	 * - The most keys that can be pending at once
+	 */
+	#ifndef AUTOSHIFT_TIME
+		#define  AUTOSHIFT_TIME  175
+	#endif
+
+	#define  AUTOSHIFT_PENDING  4
+
+	// --------------------------------------------------------------------
+
+	void autoshift_press_release ( bool press, uint8_t row, uint8_t col,
+	                               uint8_t keycode );
+	void autoshift_flush         (void);
+	void autoshift_update        (void);
+	void autoshift_reset         (void);
+
+#endif
+
@@ -0,0 +1,277 @@
+/* ----------------------------------------------------------------------------
+ * key functions : combos : code
+ *
+ * Notes
+ * - Sets of keys are kept packed, one `uint16_t` per row, so checking whether
+ *   one set is a subset of another is `KB_ROWS` ANDs, no matter how many keys
+ *   are in either
+ * - All keys that are part of any combo are collected into one set, the first
+ *   time a key event comes in; so keys that can't start a combo (most of
+ *   them, usually) cost one subset check, and the scan is never slowed by the
+ *   number of combos
+ * - Only key events (and a held back key's timeout) look through the combo
+ *   table, and only when a key that's part of some combo is involved
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../../keyboard/layout.h"
+#include "../../keyboard/matrix.h"
+#include "../../main.h"
+#include "../timer.h"
+#include "./combo.h"
+#include "./unicode.h"
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#ifdef KB_COMBOS
+// ----------------------------------------------------------------------------
+
+
+extern const struct kb_combo PROGMEM _kb_combos[KB_COMBOS];
+
+#define  NONE  0xFF
+
+// ----------------------------------------------------------------------------
+
+typedef uint16_t keys_t[KB_ROWS];
+
+// held back key presses, in the order they happened
+static struct {
+	uint8_t row;
+	uint8_t col;
+} held[COMBO_MAX_KEYS];
+static uint8_t  held_count;
+static keys_t   held_keys;
+static uint16_t held_since;
+
+static keys_t  combo_keys;  // every key that's part of a combo
+static bool    initialized;
+
+static keys_t  consumed;  // keys whose release belongs to a combo
+static uint8_t active[COMBO_MAX_ACTIVE];  // combos whose key is pressed
+
+// ----------------------------------------------------------------------------
+
+static bool is_in(const keys_t keys, uint8_t row, uint8_t col) {
+	return keys[row] & (1U << col);
+}
+
+/*
+ * Returns `true` if `keys` (in RAM) is a subset of combo `index`'s keys, and
+ * sets `*equal` if they're the same
+ */
+static bool is_subset(const keys_t keys, uint8_t index, bool * equal) {
+	bool same = true;
+
+	for (uint8_t row=0; row<KB_ROWS; row++) {
+		uint16_t combo = pgm_read_word(&_kb_combos[index].keys[row]);
+		if (keys[row] & ~combo)
+			return false;
+		if (keys[row] != combo)
+			same = false;
+	}
+
+	*equal = same;
+	return true;
+}
+
+/*
+ * Press or release the key function for combo `index`
+ */
+static void exec(uint8_t index, bool is_pressed) {
+	struct key_event event = {
+		.layer      = pgm_read_byte(&_kb_combos[index].layer),
+		.row        = pgm_read_byte(&_kb_combos[index].row),
+		.col        = pgm_read_byte(&_kb_combos[index].column),
+		.is_pressed = is_pressed,
+	};
+	main_exec_key(&event);
+}
+
+/*
+ * Send the reports now, so the host sees what was just pressed even if it's
+ * released again in the same scan (e.g. a quick tap of a held back key, which
+ * is passed on right after this)
+ *
+ * Note
+ * - The keyboard report isn't sent while unicode characters are (it would
+ *   land in the middle of one)
+ */
+static void send(void) {
+	if (!unicode_is_sending())
+		usb_keyboard_send();
+	usb_extra_send_changes();
+}
+
+/*
+ * Decide what the held back keys were: either a combo (which is pressed now,
+ * and released when the first of its keys is), or normal key presses (which
+ * are sent now, in the order they happened)
+ */
+static void resolve(void) {
+	uint8_t match = NONE;
+	bool    equal;
+
+	for (uint8_t i=0; i<KB_COMBOS; i++)
+		if (is_subset(held_keys, i, &equal) && equal)
+			match = i;
+
+	if (match != NONE) {
+		uint8_t slot = NONE;
+		for (uint8_t i=0; i<COMBO_MAX_ACTIVE; i++) {
+			if (active[i] == NONE) {
+				active[slot = i] = match;
+				break;
+			}
+		}
+		for (uint8_t row=0; row<KB_ROWS; row++)
+			consumed[row] |= held_keys[row];
+
+		exec(match, true);
+		send();
+		if (slot == NONE)  // (too many held down; no way to remember it)
+			exec(match, false);
+	} else {
+		for (uint8_t i=0; i<held_count; i++)
+			main_key_event(held[i].row, held[i].col, true);
+		send();
+	}
+
+	held_count = 0;
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		held_keys[row] = 0;
+}
+
+/*
+ * Hold back a key press, if (with the keys already held back) it might be part
+ * of a combo
+ *
+ * Returns
+ * - `true` if the key was held back
+ */
+static bool hold(uint8_t row, uint8_t col) {
+	uint8_t supersets = 0;
+	bool    complete  = false;
+	bool    equal;
+
+	held_keys[row] |= (1U << col);
+	for (uint8_t i=0; i<KB_COMBOS; i++) {
+		if (is_subset(held_keys, i, &equal)) {
+			supersets++;
+			if (equal)
+				complete = true;
+		}
+	}
+
+	if (!supersets) {
+		held_keys[row] &= ~(1U << col);
+		return false;
+	}
+
+	if (!held_count)
+		held_since = timer_get_ms();
+	held[held_count].row = row;
+	held[held_count].col = col;
+	held_count++;
+
+	// no point waiting, if no other combo could still be completed
+	if (complete && supersets == 1)
+		resolve();
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Handle a key press or release, before it's sent to `main_key_event()`
+ *
+ * Returns
+ * - `true` if the event was handled here (held back, or part of a combo)
+ * - `false` if it should be passed on as usual
+ */
+bool combo_key_event(uint8_t row, uint8_t col, bool is_pressed) {
+	if (!initialized) {
+		for (uint8_t i=0; i<KB_COMBOS; i++)
+			for (uint8_t r=0; r<KB_ROWS; r++)
+				combo_keys[r] |= pgm_read_word(&_kb_combos[i].keys[r]);
+		for (uint8_t i=0; i<COMBO_MAX_ACTIVE; i++)
+			active[i] = NONE;
+		initialized = true;
+	}
+
+	if (is_pressed) {
+		if (held_count) {
+			if (hold(row, col))
+				return true;
+			resolve();  // (so the held back keys go first)
+		}
+		if (is_in(combo_keys, row, col))
+			return hold(row, col);
+		return false;
+	}
+
+	// releasing a held back key ends the wait (so a quick tap of the keys
+	// in a combo still works); any other key event has to wait for the held
+	// back keys to be sent, to keep everything in order
+	if (held_count)
+		resolve();
+
+	if (is_in(consumed, row, col)) {
+		consumed[row] &= ~(1U << col);
+		for (uint8_t i=0; i<COMBO_MAX_ACTIVE; i++) {
+			if (active[i] != NONE) {
+				uint16_t keys =
+					pgm_read_word(&_kb_combos[active[i]].keys[row]);
+				if (keys & (1U << col)) {
+					exec(active[i], false);
+					active[i] = NONE;
+				}
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Called once per scan: stop waiting for a combo, if it's been too long
+ */
+void combo_update(void) {
+	if (held_count && (uint16_t)(timer_get_ms() - held_since) >= COMBO_TIME)
+		resolve();
+}
+
+/*
+ * Release the combos that are pressed, and forget the held back keys, e.g.
+ * when the layout is switched (the releases of their keys are then passed on,
+ * and ignored by `main_key_event()`)
+ */
+void combo_reset(void) {
+	for (uint8_t i=0; i<COMBO_MAX_ACTIVE; i++) {
+		if (active[i] != NONE) {
+			exec(active[i], false);
+			active[i] = NONE;
+		}
+	}
+
+	held_count = 0;
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		held_keys[row] = consumed[row] = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
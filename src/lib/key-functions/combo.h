@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------------------
+ * key functions : combos : exports
+ *
+ * Combos (chords) are groups of keys that do something different when
+ * pressed together (within `COMBO_TIME` ms of each other) than when pressed
+ * one at a time.
+ *
+ * To use combos, a layout should
+ * - `#define KB_COMBOS` (the number of combos) in its ".h"
+ * - define `_kb_combos[KB_COMBOS]` in its ".c", e.g.
+ *
+ *       const struct kb_combo PROGMEM _kb_combos[KB_COMBOS] = {
+ *           // J + K => whatever is at layer 5, row 3, column 9
+ *           KB_COMBO( 5, 0x3,0x9,  KB_COMBO_KEYS(0x39, 0x3A) ),
+ *       };
+ *
+ *   where keys are given as `0xRC` (row, column; the same numbering as the
+ *   `kRC` names in "keyboard/ergodox/matrix.h")
+ *
+ * When a combo is pressed, the key function at its position (layer, row,
+ * column) in the layout is pressed; it's released when the first of the
+ * combo's keys is released.  Any layer (or position) may be used, but it's
+ * easiest to use positions on a layer that's otherwise unused.  Key functions
+ * that work with the layer stack (like `kbfun_transparent`) won't do anything
+ * sensible there.
+ *
+ * Layouts that don't define `KB_COMBOS` don't pay for any of this: key events
+ * go straight to `main_key_event()`.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__KEY_FUNCTIONS__COMBO_h
+	#define LIB__KEY_FUNCTIONS__COMBO_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include "../../keyboard/layout.h"
+	#include "../../keyboard/matrix.h"
+
+	// --------------------------------------------------------------------
+
+	/*
+	 * COMBO_TIME
+	 * - How long (in ms) after the first key of a possible combo is
+	 *   pressed, to wait for the rest of it
+	 * - Keys that are part of any combo are held back (not sent to the
+	 *   host) until it's clear whether they're part of one or not: until
+	 *   a combo is completed, a key that can't be part of one is pressed,
+	 *   a held back key is released, or this much time passes
+	 * - May be defined in the layout's ".h"
+	 */
+	#ifndef COMBO_TIME
+		#define  COMBO_TIME  50
+	#endif
+
+	// the most keys that can be in one combo
+	#define  COMBO_MAX_KEYS  8
+
+	// the most combos that can be held down at once
+	#define  COMBO_MAX_ACTIVE  4
+
+	// --------------------------------------------------------------------
+
+	#if KB_COLUMNS > 16
+		#error "combos: rows are packed into 16 bits"
+	#endif
+
+	/*
+	 * The keys in a combo, as a bitmask for each row (bit `c` of `keys[r]`
+	 * is the key at row `r`, column `c`), and the position of the key
+	 * function to run when it's pressed
+	 */
+	struct kb_combo {
+		uint16_t keys[KB_ROWS];
+		uint8_t  layer;
+		uint8_t  row;
+		uint8_t  column;
+	};
+
+	// (for a key `0xRC`, its bit in row `r`)
+	#define  _KB_COMBO_BIT(r, key)  \
+		( ((key) >> 4) == (r) ? (1U << ((key) & 0x0F)) : 0 )
+
+	#define  _KB_COMBO_ROW(r, k1,k2,k3,k4,k5,k6,k7,k8, ...)		\
+		( _KB_COMBO_BIT(r,k1) | _KB_COMBO_BIT(r,k2) |		\
+		  _KB_COMBO_BIT(r,k3) | _KB_COMBO_BIT(r,k4) |		\
+		  _KB_COMBO_BIT(r,k5) | _KB_COMBO_BIT(r,k6) |		\
+		  _KB_COMBO_BIT(r,k7) | _KB_COMBO_BIT(r,k8) )
+
+	// (pad to `COMBO_MAX_KEYS` with a row that doesn't exist)
+	#define  _KB_COMBO_ROWS(r, ...)  \
+		_KB_COMBO_ROW(r, __VA_ARGS__, 0xF0,0xF0,0xF0,0xF0,0xF0,0xF0,0xF0)
+
+	// the keys in a combo (2 to `COMBO_MAX_KEYS` of them, as `0xRC`)
+	#define  KB_COMBO_KEYS(...)  {			\
+		_KB_COMBO_ROWS(0, __VA_ARGS__),		\
+		_KB_COMBO_ROWS(1, __VA_ARGS__),		\
+		_KB_COMBO_ROWS(2, __VA_ARGS__),		\
+		_KB_COMBO_ROWS(3, __VA_ARGS__),		\
+		_KB_COMBO_ROWS(4, __VA_ARGS__),		\
+		_KB_COMBO_ROWS(5, __VA_ARGS__) }
+
+	#if KB_ROWS != 6
+		#error "combos: `KB_COMBO_KEYS()` expects 6 rows"
+	#endif
+
+	// a combo
+	#define  KB_COMBO(layer, row, column, keys)  \
+		{ keys, layer, row, column }
+
+	// --------------------------------------------------------------------
+
+	#ifdef KB_COMBOS
+
+		bool combo_key_event (uint8_t row, uint8_t col, bool is_pressed);
+		void combo_update    (void);
+		void combo_reset     (void);
+
+	#else
+
+		#define  combo_key_event(row, col, is_pressed)  false
+		#define  combo_update()
+		#define  combo_reset()
+
+	#endif
+
+#endif
+
@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ * key functions : leader key : code
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "../../lib/data-types/misc.h"
+#include "../../lib/usb/usage-page/keyboard.h"
+#include "../timer.h"
+#include "./leader.h"
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_LEADER
+// ----------------------------------------------------------------------------
+
+
+// generated from the layout's "--leader.txt" (see "build-scripts/gen-leader.py")
+extern const uint16_t      PROGMEM _kb_leader_trie[];
+extern const void_funptr_t PROGMEM _kb_leader_actions[];
+
+// ----------------------------------------------------------------------------
+
+static bool     active;
+static uint8_t  node;        // index of the current node
+static uint16_t last_press;  // when the sequence was started or last added to
+
+// ----------------------------------------------------------------------------
+
+/*
+ * End the sequence, calling function `action` (1 + its number; or 0, for
+ * none)
+ */
+static void finish(uint8_t action) {
+	active = false;
+	if (action)
+		( (void_funptr_t)
+		  pgm_read_word(&_kb_leader_actions[action-1]) )();
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Start a sequence (or start over, if one has already been started)
+ */
+void leader_start(void) {
+	active     = true;
+	node       = 0;
+	last_press = timer_get_ms();
+}
+
+/*
+ * Handle a key press, if a sequence has been started
+ *
+ * Returns
+ * - `true` if the key was part of a sequence (and so shouldn't be pressed)
+ * - `false` if it should be pressed as usual
+ */
+bool leader_key(uint8_t keycode) {
+	if (!active)
+		return false;
+	if (keycode >= KEY_LeftControl && keycode <= KEY_RightGUI)
+		return false;
+
+	for (uint8_t i=node;; i++) {
+		uint16_t entry = pgm_read_word(&_kb_leader_trie[i]);
+		if ((uint8_t)entry == 0) {
+			finish(0);  // (not the next key of any sequence)
+			return true;
+		}
+		if ((uint8_t)entry == keycode) {
+			node = entry >> 8;
+			break;
+		}
+	}
+
+	// if nothing can come after this, there's no point waiting
+	uint16_t first = pgm_read_word(&_kb_leader_trie[node]);
+	if ((uint8_t)first == 0)
+		finish(first >> 8);
+	else
+		last_press = timer_get_ms();
+
+	return true;
+}
+
+/*
+ * Called once per scan: end the sequence, if it's been too long since the
+ * last key
+ */
+void leader_update(void) {
+	if (!active || (uint16_t)(timer_get_ms() - last_press) < LEADER_TIME)
+		return;
+
+	uint16_t entry;
+	for (uint8_t i=node;; i++)
+		if ((uint8_t)(entry = pgm_read_word(&_kb_leader_trie[i])) == 0)
+			break;
+
+	finish(entry >> 8);
+}
+
+/*
+ * Drop the sequence, if one has been started, without calling anything
+ */
+void leader_reset(void) {
+	active = false;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * key functions : leader key : exports
+ *
+ * Pressing a key using `kbfun_leader` starts a sequence: the keys typed after
+ * it aren't sent to the host, but matched against a list of sequences, and
+ * when one is completed, its function is called.
+ *
+ * To use leader sequences, a layout should have a file
+ * "<layout>--leader.txt" next to its ".c" (the format is described in
+ * "build-scripts/gen-leader.py"), and define the functions it names.  The
+ * makefile compiles the sequences into a trie (in flash), and sets
+ * `MAKEFILE_LEADER`.  Layouts without one don't pay for any of this.
+ *
+ * A sequence ends
+ * - when it's matched, and no longer sequence starts with it (its function is
+ *   called right away)
+ * - when it's matched, and no key is pressed for `LEADER_TIME` ms (its
+ *   function is called then)
+ * - when a key is pressed that isn't the next key of any sequence, or when no
+ *   key is pressed for `LEADER_TIME` ms before a sequence is matched (nothing
+ *   happens; the keys typed are dropped)
+ *
+ * Modifier keys are never part of a sequence: they're passed on as usual.
+ *
+ * The trie is a flat array of `uint16_t` entries, each a keycode (low byte)
+ * and an index (high byte).  A node is a run of entries, one per key that can
+ * come next (with the index of the node for the sequence so far plus that
+ * key), ended by an entry with keycode 0 (whose index is 1 + the number of the
+ * function to call if the sequence so far is complete, or 0).  The root is at
+ * index 0.  So, looking up a key is one flash read per entry checked, and the
+ * only state kept in RAM is the current node.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__KEY_FUNCTIONS__LEADER_h
+	#define LIB__KEY_FUNCTIONS__LEADER_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+
+	// --------------------------------------------------------------------
+
+	/*
+	 * LEADER_TIME
+	 * - How long (in ms) to wait for the next key of a sequence
+	 * - May be defined in the layout's ".h"
+	 */
+	#ifndef LEADER_TIME
+		#define  LEADER_TIME  1000
+	#endif
+
+	// --------------------------------------------------------------------
+
+	// trie entries (used by the generated code)
+	#define  KB_LEADER_EDGE(keycode, index)  \
+		( ((uint16_t)(index) << 8) | (uint8_t)(keycode) )
+	#define  KB_LEADER_END(action)  \
+		( (uint16_t)(action) << 8 )
+
+	// --------------------------------------------------------------------
+
+	#if MAKEFILE_LEADER
+
+		void leader_start  (void);
+		bool leader_key    (uint8_t keycode);
+		void leader_update (void);
+		void leader_reset  (void);
+
+	#else
+
+		#define  leader_start()
+		#define  leader_key(keycode)  ((void)(keycode), false)
+		#define  leader_update()
+		#define  leader_reset()
+
+	#endif
+
+#endif
+
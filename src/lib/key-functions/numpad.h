@@ -0,0 +1,28 @@
+/* ----------------------------------------------------------------------------
+ * key functions : numpad : exports
+ *
+ * `kbfun_layer_push_numpad` and `kbfun_layer_pop_numpad` toggle numlock along
+ * with the numpad layer.  The numlock tap is queued, and sent by
+ * `numpad_update()` over the next two scans (pressed, then released), with
+ * the usual report: not from inside the key function, and not while unicode
+ * characters are being sent.
+ *
+ * `numpad_reset()` turns the numpad off (popping its layer, and toggling
+ * numlock back), if it's on; for when the layout changes.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__KEY_FUNCTIONS__NUMPAD_h
+	#define LIB__KEY_FUNCTIONS__NUMPAD_h
+
+	// --------------------------------------------------------------------
+
+	void numpad_update (void);
+	void numpad_reset  (void);
+
+#endif
+
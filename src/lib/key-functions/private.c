@@ -15,20 +15,95 @@
 #include "../../keyboard/matrix.h"
 #include "../../main.h"
 #include "./public.h"
+#include "./autoshift.h"
+#include "./leader.h"
+#include "./unicode.h"
+
+// ----------------------------------------------------------------------------
+
+/* ----------------------------------------------------------------------------
+ * modifier state
+ *
+ * Modifiers are kept in two parts
+ * - `held`: the modifiers whose keys are pressed (or which key functions have
+ *   pressed, e.g. `kbfun_shift_press_release`)
+ * - `override`: how the key pressed most recently changes them, if it was
+ *   pressed with `_kbfun_press_release_modified()` (e.g. `kbfun_shift_inverted_
+ *   press_release`).  Lasts until that key is released, or another key is
+ *   pressed.
+ *
+ * and `keyboard_modifier_keys` (what's sent) is composed from the two whenever
+ * either changes.
+ * ------------------------------------------------------------------------- */
+
+static uint8_t modifiers_held;
+
+static struct {
+	uint8_t keycode;  // the key the override belongs to (0 if none)
+	uint8_t add;
+	uint8_t remove;
+	uint8_t invert;
+} override;
 
 /*
- * MediaCodeLookupTable is used to translate from enumeration in keyboard.h to
- *  consumer key scan code in usb_keyboard.h
+ * Compose the modifiers to send: held, plus `add`, minus `remove`, and then
+ * with each kind of modifier (ctrl, shift, alt, gui) in `invert` inverted
+ * (released on both sides if either side is pressed, or pressed on the left
+ * if neither is)
  */
-static const uint16_t _media_code_lookup_table[] = {
-	TRANSPORT_PLAY_PAUSE, /* MEDIAKEY_PLAY_PAUSE */
-	TRANSPORT_STOP, /* MEDIAKEY_STOP */
-	TRANSPORT_PREV_TRACK, /* MEDIAKEY_PREV_TRACK */
-	TRANSPORT_NEXT_TRACK, /* MEDIAKEY_NEXT_TRACK */
-	AUDIO_MUTE, /* MEDIAKEY_AUDIO_MUTE */
-	AUDIO_VOL_UP, /* MEDIAKEY_AUDIO_VOL_UP */
-	AUDIO_VOL_DOWN, /* MEDIAKEY_AUDIO_VOL_DOWN */
-};
+static uint8_t modifiers_compose(uint8_t add, uint8_t remove, uint8_t invert) {
+	uint8_t mods  = (modifiers_held | add) & ~remove;
+	uint8_t kinds = (mods | (mods >> 4)) & 0x0F;
+	uint8_t inv   = (invert | (invert >> 4)) & 0x0F;
+
+	mods &= ~((inv & kinds) * 0x11);
+	mods |= inv & ~kinds;
+
+	return mods;
+}
+
+/*
+ * Change the override (and so the modifiers sent)
+ *
+ * Note
+ * - If that changes the modifiers, the report is sent as it is first, so keys
+ *   already in it are sent with the modifiers they were pressed with (unless
+ *   unicode characters are being sent: they have the report to themselves)
+ */
+static void modifiers_override( uint8_t keycode, uint8_t add,
+                                uint8_t remove, uint8_t invert ) {
+	uint8_t mods = modifiers_compose(add, remove, invert);
+
+	if (mods != keyboard_modifier_keys) {
+		if (!unicode_is_sending())
+			usb_keyboard_send();
+		keyboard_modifier_keys = mods;
+	}
+
+	override.keycode = keycode;
+	override.add     = add;
+	override.remove  = remove;
+	override.invert  = invert;
+}
+
+/*
+ * Add or remove `keycode` (not a modifier) from the list of pressed keys
+ */
+static void keys_press_release(bool press, uint8_t keycode) {
+	for (uint8_t i=0; i<6; i++) {
+		if (press) {
+			if (keyboard_keys[i] == 0) {
+				keyboard_keys[i] = keycode;
+				return;
+			}
+		} else {
+			if (keyboard_keys[i] == keycode) {
+				keyboard_keys[i] = 0;
+				return;
+			}
+		}
+	}
+}
 
 // ----------------------------------------------------------------------------
 
@@ -49,81 +124,82 @@ void _kbfun_press_release(bool press, uint8_t keycode) {
 	if (keycode == 0)
 		return;
 
+	// keys held back by auto-shift were pressed first, so they go first
+	if (press)
+		autoshift_flush();
+
 	// modifier keys
-	switch (keycode) {
-		case KEY_LeftControl:  (press)
-				       ? (keyboard_modifier_keys |=  (1<<0))
-				       : (keyboard_modifier_keys &= ~(1<<0));
-				       return;
-		case KEY_LeftShift:    (press)
-				       ? (keyboard_modifier_keys |=  (1<<1))
-				       : (keyboard_modifier_keys &= ~(1<<1));
-				       return;
-		case KEY_LeftAlt:      (press)
-				       ? (keyboard_modifier_keys |=  (1<<2))
-				       : (keyboard_modifier_keys &= ~(1<<2));
-				       return;
-		case KEY_LeftGUI:      (press)
-				       ? (keyboard_modifier_keys |=  (1<<3))
-				       : (keyboard_modifier_keys &= ~(1<<3));
-				       return;
-		case KEY_RightControl: (press)
-				       ? (keyboard_modifier_keys |=  (1<<4))
-				       : (keyboard_modifier_keys &= ~(1<<4));
-				       return;
-		case KEY_RightShift:   (press)
-				       ? (keyboard_modifier_keys |=  (1<<5))
-				       : (keyboard_modifier_keys &= ~(1<<5));
-				       return;
-		case KEY_RightAlt:     (press)
-				       ? (keyboard_modifier_keys |=  (1<<6))
-				       : (keyboard_modifier_keys &= ~(1<<6));
-				       return;
-		case KEY_RightGUI:     (press)
-				       ? (keyboard_modifier_keys |=  (1<<7))
-				       : (keyboard_modifier_keys &= ~(1<<7));
-				       return;
+	if (keycode >= KEY_LeftControl && keycode <= KEY_RightGUI) {
+		uint8_t mask = 1 << (keycode - KEY_LeftControl);
+
+		if (press)
+			modifiers_held |= mask;
+		else
+			modifiers_held &= ~mask;
+
+		keyboard_modifier_keys = modifiers_compose( override.add,
+		                                            override.remove,
+		                                            override.invert );
+		return;
 	}
 
-	// all others
-	for (uint8_t i=0; i<6; i++) {
-		if (press) {
-			if (keyboard_keys[i] == 0) {
-				keyboard_keys[i] = keycode;
-				return;
-			}
-		} else {
-			if (keyboard_keys[i] == keycode) {
-				keyboard_keys[i] = 0;
-				return;
-			}
-		}
+	// keys typed after the leader key are part of a sequence instead
+	if (press && leader_key(keycode))
+		return;
+
+	// all others (ending any override: it only applies to its own key)
+	if (press && override.keycode)
+		modifiers_override(0, 0, 0, 0);
+	keys_press_release(press, keycode);
+}
+
+/*
+ * Generate a keypress or keyrelease, with the modifiers sent changed while the
+ * key is pressed
+ *
+ * Arguments
+ * - press: whether to generate a keypress (true) or keyrelease (false)
+ * - keycode: the keycode to use (not a modifier)
+ * - add, remove, invert: modifier masks (`MOD_*`, as in
+ *   `keyboard_modifier_keys`) to press, release, or invert (see
+ *   `modifiers_compose()`)
+ *
+ * Note
+ * - The modifiers are changed until this key is released, or another key is
+ *   pressed (whichever happens first); and the changes are sent in their own
+ *   report, so they don't apply to any other key
+ */
+void _kbfun_press_release_modified( bool press, uint8_t keycode,
+                                    uint8_t add, uint8_t remove,
+                                    uint8_t invert ) {
+	if (keycode == 0)
+		return;
+
+	if (press) {
+		autoshift_flush();
+		if (leader_key(keycode))
+			return;
+		modifiers_override(keycode, add, remove, invert);
+	} else if (override.keycode == keycode) {
+		override.keycode = 0;
+		override.add = override.remove = override.invert = 0;
+		keyboard_modifier_keys = modifiers_compose(0, 0, 0);
 	}
+
+	keys_press_release(press, keycode);
 }
 
 /*
  * Is the given keycode pressed?
+ *
+ * Note
+ * - For modifiers, this is whether the modifier is held, regardless of any
+ *   override
  */
 bool _kbfun_is_pressed(uint8_t keycode) {
 	// modifier keys
-	switch (keycode) {
-		case KEY_LeftControl:  if (keyboard_modifier_keys & (1<<0))
-					       return true;
-		case KEY_LeftShift:    if (keyboard_modifier_keys & (1<<1))
-					       return true;
-		case KEY_LeftAlt:      if (keyboard_modifier_keys & (1<<2))
-					       return true;
-		case KEY_LeftGUI:      if (keyboard_modifier_keys & (1<<3))
-					       return true;
-		case KEY_RightControl: if (keyboard_modifier_keys & (1<<4))
-					       return true;
-		case KEY_RightShift:   if (keyboard_modifier_keys & (1<<5))
-					       return true;
-		case KEY_RightAlt:     if (keyboard_modifier_keys & (1<<6))
-					       return true;
-		case KEY_RightGUI:     if (keyboard_modifier_keys & (1<<7))
-					       return true;
-	}
+	if (keycode >= KEY_LeftControl && keycode <= KEY_RightGUI)
+		return modifiers_held & (1 << (keycode - KEY_LeftControl));
 
 	// all others
 	for (uint8_t i=0; i<6; i++)
@@ -133,16 +209,55 @@ bool _kbfun_is_pressed(uint8_t keycode) {
 	return false;
 }
 
-void _kbfun_mediakey_press_release(bool press, uint8_t keycode) {
-	uint16_t mediakey_code = _media_code_lookup_table[keycode];
-	if (press) {
-		consumer_key = mediakey_code;
-	} else {
-		// Only one key can be pressed at a time so only clear the keypress for
-		//  active key (most recently pressed)
-		if (mediakey_code == consumer_key) {
-			consumer_key = 0;
+/*
+ * Generate a consumer (media, application launch, etc.) keypress or
+ * keyrelease
+ *
+ * Arguments
+ * - press: whether to generate a keypress (true) or keyrelease (false)
+ * - usage: the consumer usage (usage page 0x0C) to use
+ *
+ * Note
+ * - Like `_kbfun_press_release()`, this adds or removes 'usage' from the list
+ *   of currently pressed consumer keys, to be sent at the end of the current
+ *   cycle (if the list changed).  If the list is full, presses are ignored.
+ */
+void _kbfun_consumer_press_release(bool press, uint16_t usage) {
+	// no-op
+	if (usage == 0)
+		return;
+
+	for (uint8_t i=0; i<CONSUMER_KEYS; i++) {
+		if (press) {
+			if (consumer_keys[i] == 0) {
+				consumer_keys[i] = usage;
+				return;
+			}
+		} else {
+			if (consumer_keys[i] == usage) {
+				consumer_keys[i] = 0;
+				return;
+			}
 		}
 	}
 }
 
+/*
+ * Generate a system control (power down, sleep, wake up, etc.) keypress or
+ * keyrelease
+ *
+ * Arguments
+ * - press: whether to generate a keypress (true) or keyrelease (false)
+ * - usage: the system control usage (usage page 0x01) to use
+ *
+ * Note
+ * - Only one system control key can be reported at a time, so only the most
+ *   recently pressed one is cleared on release
+ */
+void _kbfun_system_press_release(bool press, uint8_t usage) {
+	if (press)
+		system_key = usage;
+	else if (system_key == usage)
+		system_key = 0;
+}
+
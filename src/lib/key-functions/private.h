@@ -19,9 +19,31 @@
 
 	// --------------------------------------------------------------------
 
+	// modifier masks (bits of `keyboard_modifier_keys`), for
+	// `_kbfun_press_release_modified()`
+	#define  MOD_LeftControl   (1<<0)
+	#define  MOD_LeftShift     (1<<1)
+	#define  MOD_LeftAlt       (1<<2)
+	#define  MOD_LeftGUI       (1<<3)
+	#define  MOD_RightControl  (1<<4)
+	#define  MOD_RightShift    (1<<5)
+	#define  MOD_RightAlt      (1<<6)
+	#define  MOD_RightGUI      (1<<7)
+	// (either side)
+	#define  MOD_Control       (MOD_LeftControl | MOD_RightControl)
+	#define  MOD_Shift         (MOD_LeftShift   | MOD_RightShift)
+	#define  MOD_Alt           (MOD_LeftAlt     | MOD_RightAlt)
+	#define  MOD_GUI           (MOD_LeftGUI     | MOD_RightGUI)
+
+	// --------------------------------------------------------------------
+
 	void _kbfun_press_release     (bool press, uint8_t keycode);
+	void _kbfun_press_release_modified ( bool press, uint8_t keycode,
+	                                     uint8_t add, uint8_t remove,
+	                                     uint8_t invert );
 	bool _kbfun_is_pressed        (uint8_t keycode);
-	void _kbfun_mediakey_press_release (bool press, uint8_t keycode);
+	void _kbfun_consumer_press_release (bool press, uint16_t usage);
+	void _kbfun_system_press_release   (bool press, uint8_t usage);
 
 #endif
 
@@ -12,68 +12,95 @@
 
 	#include <stdbool.h>
 	#include <stdint.h>
+	#include "../../main.h"
 
 	// --------------------------------------------------------------------
 
 	// basic
-	void kbfun_press_release (void);
-	void kbfun_press_release_preserve_sticky (void);
-	void kbfun_toggle        (void);
-	void kbfun_transparent   (void);
+	void kbfun_press_release (struct key_event * event);
+	void kbfun_press_release_preserve_sticky (struct key_event * event);
+	void kbfun_toggle        (struct key_event * event);
+	void kbfun_transparent   (struct key_event * event);
 	// --- layer push/pop functions
-	void kbfun_layer_push_1  (void);
-	void kbfun_layer_push_2  (void);
-	void kbfun_layer_push_3  (void);
-	void kbfun_layer_push_4  (void);
-	void kbfun_layer_push_5  (void);
-	void kbfun_layer_push_6  (void);
-	void kbfun_layer_push_7  (void);
-	void kbfun_layer_push_8  (void);
-	void kbfun_layer_push_9  (void);
-	void kbfun_layer_push_10 (void);
-	void kbfun_layer_sticky_1  (void);
-	void kbfun_layer_sticky_2  (void);
-	void kbfun_layer_sticky_3  (void);
-	void kbfun_layer_sticky_4  (void);
-	void kbfun_layer_sticky_5  (void);
-	void kbfun_layer_sticky_6  (void);
-	void kbfun_layer_sticky_7  (void);
-	void kbfun_layer_sticky_8  (void);
-	void kbfun_layer_sticky_9  (void);
-	void kbfun_layer_sticky_10 (void);
-	void kbfun_layer_pop_1   (void);
-	void kbfun_layer_pop_2   (void);
-	void kbfun_layer_pop_3   (void);
-	void kbfun_layer_pop_4   (void);
-	void kbfun_layer_pop_5   (void);
-	void kbfun_layer_pop_6   (void);
-	void kbfun_layer_pop_7   (void);
-	void kbfun_layer_pop_8   (void);
-	void kbfun_layer_pop_9   (void);
-	void kbfun_layer_pop_10  (void);
-	void kbfun_layer_pop_all (void);
+	void kbfun_layer_push    (struct key_event * event);
+	void kbfun_layer_sticky  (struct key_event * event);
+	void kbfun_layer_pop     (struct key_event * event);
+	void kbfun_layer_toggle  (struct key_event * event);
+	void kbfun_layer_push_1  (struct key_event * event);
+	void kbfun_layer_push_2  (struct key_event * event);
+	void kbfun_layer_push_3  (struct key_event * event);
+	void kbfun_layer_push_4  (struct key_event * event);
+	void kbfun_layer_push_5  (struct key_event * event);
+	void kbfun_layer_push_6  (struct key_event * event);
+	void kbfun_layer_push_7  (struct key_event * event);
+	void kbfun_layer_push_8  (struct key_event * event);
+	void kbfun_layer_push_9  (struct key_event * event);
+	void kbfun_layer_push_10 (struct key_event * event);
+	void kbfun_layer_sticky_1  (struct key_event * event);
+	void kbfun_layer_sticky_2  (struct key_event * event);
+	void kbfun_layer_sticky_3  (struct key_event * event);
+	void kbfun_layer_sticky_4  (struct key_event * event);
+	void kbfun_layer_sticky_5  (struct key_event * event);
+	void kbfun_layer_sticky_6  (struct key_event * event);
+	void kbfun_layer_sticky_7  (struct key_event * event);
+	void kbfun_layer_sticky_8  (struct key_event * event);
+	void kbfun_layer_sticky_9  (struct key_event * event);
+	void kbfun_layer_sticky_10 (struct key_event * event);
+	void kbfun_layer_pop_1   (struct key_event * event);
+	void kbfun_layer_pop_2   (struct key_event * event);
+	void kbfun_layer_pop_3   (struct key_event * event);
+	void kbfun_layer_pop_4   (struct key_event * event);
+	void kbfun_layer_pop_5   (struct key_event * event);
+	void kbfun_layer_pop_6   (struct key_event * event);
+	void kbfun_layer_pop_7   (struct key_event * event);
+	void kbfun_layer_pop_8   (struct key_event * event);
+	void kbfun_layer_pop_9   (struct key_event * event);
+	void kbfun_layer_pop_10  (struct key_event * event);
+	void kbfun_layer_pop_all (struct key_event * event);
 
-	void kbfun_layer_toggle_1   (void);
-	void kbfun_layer_toggle_2   (void);
-	void kbfun_layer_toggle_3   (void);
-	void kbfun_layer_toggle_4   (void);
-	void kbfun_layer_toggle_5   (void);
-	void kbfun_layer_toggle_6   (void);
-	void kbfun_layer_toggle_7   (void);
-	void kbfun_layer_toggle_8   (void);
-	void kbfun_layer_toggle_9   (void);
-	void kbfun_layer_toggle_10  (void);
+	void kbfun_layer_toggle_1   (struct key_event * event);
+	void kbfun_layer_toggle_2   (struct key_event * event);
+	void kbfun_layer_toggle_3   (struct key_event * event);
+	void kbfun_layer_toggle_4   (struct key_event * event);
+	void kbfun_layer_toggle_5   (struct key_event * event);
+	void kbfun_layer_toggle_6   (struct key_event * event);
+	void kbfun_layer_toggle_7   (struct key_event * event);
+	void kbfun_layer_toggle_8   (struct key_event * event);
+	void kbfun_layer_toggle_9   (struct key_event * event);
+	void kbfun_layer_toggle_10  (struct key_event * event);
 	// ---
 
+	// layouts (see `EXTRA_LAYOUTS` in "makefile-options")
+	void kbfun_layout_next (struct key_event * event);
+	void kbfun_layout_set  (struct key_event * event);
+
 	// device
-	void kbfun_jump_to_bootloader (void);
+	void kbfun_jump_to_bootloader (struct key_event * event);
 
 	// special
-	void kbfun_shift_press_release           (void);
-	void kbfun_2_keys_capslock_press_release (void);
-	void kbfun_layer_push_numpad             (void);
-	void kbfun_layer_pop_numpad              (void);
-	void kbfun_mediakey_press_release        (void);
+	void kbfun_shift_press_release           (struct key_event * event);
+	void kbfun_shift_inverted_press_release  (struct key_event * event);
+	void kbfun_2_keys_capslock_press_release (struct key_event * event);
+	void kbfun_autoshift_press_release       (struct key_event * event);
+	void kbfun_leader                        (struct key_event * event);
+	void kbfun_layer_push_numpad             (struct key_event * event);
+	void kbfun_layer_pop_numpad              (struct key_event * event);
+	void kbfun_mediakey_press_release        (struct key_event * event);
+	void kbfun_consumer_press_release        (struct key_event * event);
+	void kbfun_consumer_1_press_release      (struct key_event * event);
+	void kbfun_consumer_2_press_release      (struct key_event * event);
+	void kbfun_system_press_release          (struct key_event * event);
+
+	// mouse
+	void kbfun_mouse_move_press_release   (struct key_event * event);
+	void kbfun_mouse_button_press_release (struct key_event * event);
+
+	// steno
+	void kbfun_steno_press_release (struct key_event * event);
+
+	// unicode
+	void kbfun_unicode_press (struct key_event * event);
+	void kbfun_unicode_mode  (struct key_event * event);
 
 #endif
 
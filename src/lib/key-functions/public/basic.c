@@ -11,20 +11,32 @@
 #include "../../../keyboard/layout.h"
 #include "../public.h"
 #include "../private.h"
+#include "../combo.h"
+#include "../autoshift.h"
+#include "../leader.h"
+#include "../numpad.h"
 
 // ----------------------------------------------------------------------------
 
 #define  MAX_LAYER_PUSH_POP_FUNCTIONS  10
 
+// the number of layer ids to keep track of: one for each numbered layer
+//  function, and one for each layer (for the layer functions that take the
+//  layer number from the keymap)
+#if KB_LAYERS > 1 + MAX_LAYER_PUSH_POP_FUNCTIONS
+	#define  LAYER_IDS  KB_LAYERS
+#else
+	#define  LAYER_IDS  (1 + MAX_LAYER_PUSH_POP_FUNCTIONS)
+#endif
+
 // ----------------------------------------------------------------------------
 
 // convenience macros
-#define  LAYER         main_arg_layer
-#define  LAYER_OFFSET  main_arg_layer_offset
-#define  ROW           main_arg_row
-#define  COL           main_arg_col
-#define  IS_PRESSED    main_arg_is_pressed
-#define  WAS_PRESSED   main_arg_was_pressed
+#define  LAYER         (event->layer)
+#define  LAYER_OFFSET  (event->layer_offset)
+#define  ROW           (event->row)
+#define  COL           (event->col)
+#define  IS_PRESSED    (event->is_pressed)
 
 // ----------------------------------------------------------------------------
 
@@ -35,10 +47,10 @@
  * [description]
  *   Generate a normal keypress or keyrelease
  */
-void kbfun_press_release(void) {
-	if (!main_arg_trans_key_pressed)
-		main_arg_any_non_trans_key_pressed = true;
-	kbfun_press_release_preserve_sticky();
+void kbfun_press_release(struct key_event * event) {
+	if (!event->trans_key_pressed)
+		main_any_non_trans_key_pressed = true;
+	kbfun_press_release_preserve_sticky(event);
 }
 
 /*
@@ -56,7 +68,7 @@ void kbfun_press_release(void) {
  *    modifier key (shift, control, alt, gui) on the sticky layer instead of
  *    defining the key to be transparent for the layer.
  */
-void kbfun_press_release_preserve_sticky(void) {
+void kbfun_press_release_preserve_sticky(struct key_event * event) {
 	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
 	_kbfun_press_release(IS_PRESSED, keycode);
 }
@@ -68,7 +80,7 @@ void kbfun_press_release_preserve_sticky(void) {
  * [description]
  *   Toggle the key pressed or unpressed
  */
-void kbfun_toggle(void) {
+void kbfun_toggle(struct key_event * event) {
 	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
 
 	if (_kbfun_is_pressed(keycode))
@@ -84,13 +96,18 @@ void kbfun_toggle(void) {
  * [description]
  *   Execute the key that would have been executed if the current layer was not
  *   active
+ *
+ * [note]
+ *   Keys with this function are resolved by `main_exec_key()` itself, without
+ *   calling it (see "main.c"); this is here for other code that wants to call
+ *   it directly
  */
-void kbfun_transparent(void) {
-	main_arg_trans_key_pressed = true;
+void kbfun_transparent(struct key_event * event) {
+	event->trans_key_pressed = true;
 	LAYER_OFFSET++;
 	LAYER = main_layers_peek(LAYER_OFFSET);
-	main_layers_pressed[ROW][COL] = LAYER;
-	main_exec_key();
+	main_layers_pressed_set(ROW, COL, LAYER);
+	main_exec_key(event);
 }
 
 
@@ -98,12 +115,17 @@ void kbfun_transparent(void) {
  * layer push/pop functions
  * ------------------------------------------------------------------------- */
 
-// While there are only MAX_LAYER_PUSH_POP_FUNCTIONS number of layer functions,
-//  there are 1 + MAX_LAYER_PUSH_POP_FUNCTIONS layer ids because we still have
-//  layer 0 even if we will never have a push or pop function for it
-static uint8_t layer_ids[1 + MAX_LAYER_PUSH_POP_FUNCTIONS];
+// While there are only MAX_LAYER_PUSH_POP_FUNCTIONS number of numbered layer
+//  functions, there are at least 1 + MAX_LAYER_PUSH_POP_FUNCTIONS layer ids
+//  because we still have layer 0 even if we will never have a push or pop
+//  function for it.  Local id `n` is shared by the `*_n` functions and the
+//  unnumbered functions for layer `n`.
+static uint8_t layer_ids[LAYER_IDS];
 
 static void layer_pop(uint8_t local_id) {
+	if (local_id >= LAYER_IDS)
+		return;
+
 	uint8_t id = layer_ids[local_id];
 	if (id != 0) {
 		main_layers_pop_id(id);
@@ -111,7 +133,10 @@ static void layer_pop(uint8_t local_id) {
 	}
 }
 
-static void layer_push(uint8_t local_id) {
+static void layer_push(struct key_event * event, uint8_t local_id) {
+	if (local_id >= LAYER_IDS)
+		return;
+
 	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
 	layer_pop(local_id);
 	// Only the topmost layer on the stack should be in sticky once state, pop
@@ -123,7 +148,10 @@ static void layer_push(uint8_t local_id) {
 	layer_ids[local_id] = main_layers_push(keycode, eStickyNone);
 }
 
-static void layer_sticky(uint8_t local_id) {
+static void layer_sticky(struct key_event * event, uint8_t local_id) {
+	if (local_id >= LAYER_IDS)
+		return;
+
 	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
 	if (IS_PRESSED) {
 		uint8_t topLayer = main_layers_peek(0);
@@ -139,7 +167,7 @@ static void layer_sticky(uint8_t local_id) {
 			}
 			layer_ids[local_id] = main_layers_push(keycode, eStickyOnceDown);
 			// this should be the only place we care about this flag being cleared
-			main_arg_any_non_trans_key_pressed = false;
+			main_any_non_trans_key_pressed = false;
 		}
 	} else {
 		uint8_t topLayer = main_layers_peek(0);
@@ -148,7 +176,7 @@ static void layer_sticky(uint8_t local_id) {
 			if (topSticky == eStickyOnceDown) {
 				// When releasing this sticky key, pop the layer always
 				layer_pop(local_id);
-				if (!main_arg_any_non_trans_key_pressed) {
+				if (!main_any_non_trans_key_pressed) {
 					// If no key defined for this layer (a non-transparent key)
 					//  was pressed, push the layer again, but in the
 					//  StickyOnceUp state
@@ -159,14 +187,68 @@ static void layer_sticky(uint8_t local_id) {
 	}
 }
 
-static void layer_toggle(uint8_t local_id) {
+static void layer_toggle(struct key_event * event, uint8_t local_id) {
+	if (local_id >= LAYER_IDS)
+		return;
+
 	if (layer_ids[local_id] != 0) {
 		layer_pop(local_id);
 	} else {
-		layer_push(local_id);
+		layer_push(event, local_id);
 	}
 }
 
+/*
+ * [name]
+ *   Layer push
+ *
+ * [description]
+ *   Push a layer element containing the layer value specified in the keymap to
+ *   the top of the stack, and record the id of that layer element (the same
+ *   as `kbfun_layer_push_N()`, with `N` being the layer value; so this works
+ *   for every layer, up to `KB_LAYERS`)
+ */
+void kbfun_layer_push(struct key_event * event) {
+	layer_push(event, kb_layout_get(LAYER, ROW, COL));
+}
+
+/*
+ * [name]
+ *   Layer sticky cycle
+ *
+ * [description]
+ *   See the description of kbfun_layer_sticky_1() (the layer is the one
+ *   specified in the keymap)
+ */
+void kbfun_layer_sticky(struct key_event * event) {
+	layer_sticky(event, kb_layout_get(LAYER, ROW, COL));
+}
+
+/*
+ * [name]
+ *   Layer pop
+ *
+ * [description]
+ *   Pop the layer element created by "layer push" (or the other unnumbered
+ *   layer functions) for the layer specified in the keymap out of the layer
+ *   stack
+ */
+void kbfun_layer_pop(struct key_event * event) {
+	layer_pop(kb_layout_get(LAYER, ROW, COL));
+}
+
+/*
+ * [name]
+ *   Layer toggle
+ *
+ * [description]
+ *   If the layer element for the layer specified in the keymap is already in
+ *   the layer stack, pop it.  Otherwise, push it to the top of the stack.
+ */
+void kbfun_layer_toggle(struct key_event * event) {
+	layer_toggle(event, kb_layout_get(LAYER, ROW, COL));
+}
+
 /*
  * [name]
  *   Layer push #1
@@ -175,8 +257,8 @@ static void layer_toggle(uint8_t local_id) {
  *   Push a layer element containing the layer value specified in the keymap to
  *   the top of the stack, and record the id of that layer element
  */
-void kbfun_layer_push_1(void) {
-	layer_push(1);
+void kbfun_layer_push_1(struct key_event * event) {
+	layer_push(event, 1);
 }
 
 /*
@@ -214,8 +296,8 @@ void kbfun_layer_push_1(void) {
  *      state when the layer sticky key was pressed again. The layer will be
  *      popped if the function is invoked on a subsequent keypress.
  */
-void kbfun_layer_sticky_1  (void) {
-	layer_sticky(1);
+void kbfun_layer_sticky_1  (struct key_event * event) {
+	layer_sticky(event, 1);
 }
 
 /*
@@ -227,7 +309,7 @@ void kbfun_layer_sticky_1  (void) {
  *   out of the layer stack (no matter where it is in the stack, without
  *   touching any other elements)
  */
-void kbfun_layer_pop_1(void) {
+void kbfun_layer_pop_1(struct key_event * event) {
 	layer_pop(1);
 }
 
@@ -239,8 +321,8 @@ void kbfun_layer_pop_1(void) {
  *   If the layer element is already in the layer stack, pop it.  Otherwise,
  *   push the layer element to the top of the stack.
  */
-void kbfun_layer_toggle_1(void) {
-	layer_toggle(1);
+void kbfun_layer_toggle_1(struct key_event * event) {
+	layer_toggle(event, 1);
 }
 
 /*
@@ -250,8 +332,8 @@ void kbfun_layer_toggle_1(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_2(void) {
-	layer_push(2);
+void kbfun_layer_push_2(struct key_event * event) {
+	layer_push(event, 2);
 }
 
 /*
@@ -261,8 +343,8 @@ void kbfun_layer_push_2(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_2  (void) {
-	layer_sticky(2);
+void kbfun_layer_sticky_2  (struct key_event * event) {
+	layer_sticky(event, 2);
 }
 
 /*
@@ -272,7 +354,7 @@ void kbfun_layer_sticky_2  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_2(void) {
+void kbfun_layer_pop_2(struct key_event * event) {
 	layer_pop(2);
 }
 
@@ -283,8 +365,8 @@ void kbfun_layer_pop_2(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_2(void) {
-	layer_toggle(2);
+void kbfun_layer_toggle_2(struct key_event * event) {
+	layer_toggle(event, 2);
 }
 
 /*
@@ -294,8 +376,8 @@ void kbfun_layer_toggle_2(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_3(void) {
-	layer_push(3);
+void kbfun_layer_push_3(struct key_event * event) {
+	layer_push(event, 3);
 }
 
 /*
@@ -305,8 +387,8 @@ void kbfun_layer_push_3(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_3  (void) {
-	layer_sticky(3);
+void kbfun_layer_sticky_3  (struct key_event * event) {
+	layer_sticky(event, 3);
 }
 
 /*
@@ -316,7 +398,7 @@ void kbfun_layer_sticky_3  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_3(void) {
+void kbfun_layer_pop_3(struct key_event * event) {
 	layer_pop(3);
 }
 
@@ -327,8 +409,8 @@ void kbfun_layer_pop_3(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_3(void) {
-	layer_toggle(3);
+void kbfun_layer_toggle_3(struct key_event * event) {
+	layer_toggle(event, 3);
 }
 
 /*
@@ -338,8 +420,8 @@ void kbfun_layer_toggle_3(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_4(void) {
-	layer_push(4);
+void kbfun_layer_push_4(struct key_event * event) {
+	layer_push(event, 4);
 }
 
 /*
@@ -349,8 +431,8 @@ void kbfun_layer_push_4(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_4  (void) {
-	layer_sticky(4);
+void kbfun_layer_sticky_4  (struct key_event * event) {
+	layer_sticky(event, 4);
 }
 
 /*
@@ -360,7 +442,7 @@ void kbfun_layer_sticky_4  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_4(void) {
+void kbfun_layer_pop_4(struct key_event * event) {
 	layer_pop(4);
 }
 
@@ -371,8 +453,8 @@ void kbfun_layer_pop_4(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_4(void) {
-	layer_toggle(4);
+void kbfun_layer_toggle_4(struct key_event * event) {
+	layer_toggle(event, 4);
 }
 
 /*
@@ -382,8 +464,8 @@ void kbfun_layer_toggle_4(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_5(void) {
-	layer_push(5);
+void kbfun_layer_push_5(struct key_event * event) {
+	layer_push(event, 5);
 }
 
 /*
@@ -393,8 +475,8 @@ void kbfun_layer_push_5(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_5  (void) {
-	layer_sticky(5);
+void kbfun_layer_sticky_5  (struct key_event * event) {
+	layer_sticky(event, 5);
 }
 
 /*
@@ -404,7 +486,7 @@ void kbfun_layer_sticky_5  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_5(void) {
+void kbfun_layer_pop_5(struct key_event * event) {
 	layer_pop(5);
 }
 
@@ -415,8 +497,8 @@ void kbfun_layer_pop_5(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_5(void) {
-	layer_toggle(5);
+void kbfun_layer_toggle_5(struct key_event * event) {
+	layer_toggle(event, 5);
 }
 
 /*
@@ -426,8 +508,8 @@ void kbfun_layer_toggle_5(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_6(void) {
-	layer_push(6);
+void kbfun_layer_push_6(struct key_event * event) {
+	layer_push(event, 6);
 }
 
 /*
@@ -437,8 +519,8 @@ void kbfun_layer_push_6(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_6  (void) {
-	layer_sticky(6);
+void kbfun_layer_sticky_6  (struct key_event * event) {
+	layer_sticky(event, 6);
 }
 
 /*
@@ -448,7 +530,7 @@ void kbfun_layer_sticky_6  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_6(void) {
+void kbfun_layer_pop_6(struct key_event * event) {
 	layer_pop(6);
 }
 
@@ -459,8 +541,8 @@ void kbfun_layer_pop_6(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_6(void) {
-	layer_toggle(6);
+void kbfun_layer_toggle_6(struct key_event * event) {
+	layer_toggle(event, 6);
 }
 
 /*
@@ -470,8 +552,8 @@ void kbfun_layer_toggle_6(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_7(void) {
-	layer_push(7);
+void kbfun_layer_push_7(struct key_event * event) {
+	layer_push(event, 7);
 }
 
 /*
@@ -481,8 +563,8 @@ void kbfun_layer_push_7(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_7  (void) {
-	layer_sticky(7);
+void kbfun_layer_sticky_7  (struct key_event * event) {
+	layer_sticky(event, 7);
 }
 
 /*
@@ -492,7 +574,7 @@ void kbfun_layer_sticky_7  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_7(void) {
+void kbfun_layer_pop_7(struct key_event * event) {
 	layer_pop(7);
 }
 
@@ -503,8 +585,8 @@ void kbfun_layer_pop_7(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_7(void) {
-	layer_toggle(7);
+void kbfun_layer_toggle_7(struct key_event * event) {
+	layer_toggle(event, 7);
 }
 
 /*
@@ -514,8 +596,8 @@ void kbfun_layer_toggle_7(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_8(void) {
-	layer_push(8);
+void kbfun_layer_push_8(struct key_event * event) {
+	layer_push(event, 8);
 }
 
 /*
@@ -525,8 +607,8 @@ void kbfun_layer_push_8(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_8  (void) {
-	layer_sticky(8);
+void kbfun_layer_sticky_8  (struct key_event * event) {
+	layer_sticky(event, 8);
 }
 
 /*
@@ -536,7 +618,7 @@ void kbfun_layer_sticky_8  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_8(void) {
+void kbfun_layer_pop_8(struct key_event * event) {
 	layer_pop(8);
 }
 
@@ -547,8 +629,8 @@ void kbfun_layer_pop_8(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_8(void) {
-	layer_toggle(8);
+void kbfun_layer_toggle_8(struct key_event * event) {
+	layer_toggle(event, 8);
 }
 
 /*
@@ -558,8 +640,8 @@ void kbfun_layer_toggle_8(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_9(void) {
-	layer_push(9);
+void kbfun_layer_push_9(struct key_event * event) {
+	layer_push(event, 9);
 }
 
 /*
@@ -569,8 +651,8 @@ void kbfun_layer_push_9(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_9  (void) {
-	layer_sticky(9);
+void kbfun_layer_sticky_9  (struct key_event * event) {
+	layer_sticky(event, 9);
 }
 
 /*
@@ -580,7 +662,7 @@ void kbfun_layer_sticky_9  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_9(void) {
+void kbfun_layer_pop_9(struct key_event * event) {
 	layer_pop(9);
 }
 
@@ -591,8 +673,8 @@ void kbfun_layer_pop_9(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_9(void) {
-	layer_toggle(9);
+void kbfun_layer_toggle_9(struct key_event * event) {
+	layer_toggle(event, 9);
 }
 
 /*
@@ -602,8 +684,8 @@ void kbfun_layer_toggle_9(void) {
  * [description]
  *   See the description of kbfun_layer_push_1()
  */
-void kbfun_layer_push_10(void) {
-	layer_push(10);
+void kbfun_layer_push_10(struct key_event * event) {
+	layer_push(event, 10);
 }
 
 /*
@@ -613,8 +695,8 @@ void kbfun_layer_push_10(void) {
  * [description]
  *   See the description of kbfun_layer_sticky_1()
  */
-void kbfun_layer_sticky_10  (void) {
-	layer_sticky(10);
+void kbfun_layer_sticky_10  (struct key_event * event) {
+	layer_sticky(event, 10);
 }
 
 /*
@@ -624,7 +706,7 @@ void kbfun_layer_sticky_10  (void) {
  * [description]
  *   See the description of kbfun_layer_pop_1()
  */
-void kbfun_layer_pop_10(void) {
+void kbfun_layer_pop_10(struct key_event * event) {
 	layer_pop(10);
 }
 
@@ -635,8 +717,8 @@ void kbfun_layer_pop_10(void) {
  * [description]
  *   See the description of kbfun_layer_toggle_1()
  */
-void kbfun_layer_toggle_10(void) {
-	layer_toggle(10);
+void kbfun_layer_toggle_10(struct key_event * event) {
+	layer_toggle(event, 10);
 }
 
 /*
@@ -646,17 +728,69 @@ void kbfun_layer_toggle_10(void) {
  * [description]
  *   Pops all layers from the stack.  Resets the layout to the default state.
  */
-void kbfun_layer_pop_all(void) {
-	kbfun_layer_pop_1();
-	kbfun_layer_pop_2();
-	kbfun_layer_pop_3();
-	kbfun_layer_pop_4();
-	kbfun_layer_pop_5();
-	kbfun_layer_pop_6();
-	kbfun_layer_pop_7();
-	kbfun_layer_pop_8();
-	kbfun_layer_pop_9();
-	kbfun_layer_pop_10();
+void kbfun_layer_pop_all(struct key_event * event) {
+	for (uint8_t local_id=1; local_id<LAYER_IDS; local_id++)
+		layer_pop(local_id);
+}
+
+// ----------------------------------------------------------------------------
+
+static void layout_set(struct key_event * event, uint8_t layout) {
+	if (!IS_PRESSED || layout >= KB_LAYOUTS || layout == kb_layouts_get())
+		return;
+
+	// release the combos that are pressed, and the keys that are held (this
+	// one too, which does nothing), with the functions they were pressed
+	// with.  Their releases, when they come, are then ignored by
+	// `main_key_event()`, instead of running whatever function the new
+	// layout has there.
+	combo_reset();
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		for (uint8_t col=0; col<KB_COLUMNS; col++)
+			if (main_key_pressed_get(row, col))
+				main_key_event(row, col, false);
+
+	// (nothing that was started in the old layout should carry over)
+	autoshift_reset();
+	leader_reset();
+
+	// (the numpad's layer isn't one of ours, and numlock goes with it)
+	numpad_reset();
+	kbfun_layer_pop_all(event);
+	kb_layouts_set(layout);
+}
+
+/*
+ * [name]
+ *   Layout next
+ *
+ * [description]
+ *   Switch to the next of the layouts compiled into the firmware (see
+ *   `EXTRA_LAYOUTS` in "makefile-options"), or back to the first one after
+ *   the last.  The layout chosen is kept in the EEPROM, so it's still active
+ *   after the keyboard is unplugged.
+ *
+ * [note]
+ *   Other keys held at the time (and combos) are released, and all layers
+ *   popped (the numpad's too, with numlock toggled back).  Pending auto-shift
+ *   keys and leader sequences are dropped.  Keys still held (this one
+ *   included) do nothing when they're released.
+ */
+void kbfun_layout_next(struct key_event * event) {
+	layout_set(event, (kb_layouts_get() + 1) % KB_LAYOUTS);
+}
+
+/*
+ * [name]
+ *   Layout set
+ *
+ * [description]
+ *   Switch to the layout specified in the keymap (0 for the main one, 1 for
+ *   the first of `EXTRA_LAYOUTS`, etc.).  See the description of
+ *   kbfun_layout_next().
+ */
+void kbfun_layout_set(struct key_event * event) {
+	layout_set(event, kb_layout_get(LAYER, ROW, COL));
 }
 
 /* ----------------------------------------------------------------------------
@@ -23,7 +23,7 @@
  * [description]
  *   For reflashing the controller
  */
-void kbfun_jump_to_bootloader(void);
+void kbfun_jump_to_bootloader(struct key_event * event);
 
 
 // ----------------------------------------------------------------------------
@@ -32,7 +32,7 @@ void kbfun_jump_to_bootloader(void);
 
 // from PJRC (slightly modified)
 // <http://www.pjrc.com/teensy/jump_to_bootloader.html>
-void kbfun_jump_to_bootloader(void) {
+void kbfun_jump_to_bootloader(struct key_event * event) {
 	// --- for all Teensy boards ---
 
 	cli();
@@ -58,7 +58,7 @@ void kbfun_jump_to_bootloader(void) {
 #else
 // ----------------------------------------------------------------------------
 
-void kbfun_jump_to_bootloader(void) {}
+void kbfun_jump_to_bootloader(struct key_event * event) {}
 
 
 // ----------------------------------------------------------------------------
@@ -0,0 +1,64 @@
+/* ----------------------------------------------------------------------------
+ * key functions : mouse : code
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../../lib/mouse-keys/public.h"
+#include "../../../keyboard/layout.h"
+#include "../../../main.h"
+#include "../public.h"
+
+// ----------------------------------------------------------------------------
+
+// convenience macros
+#define  LAYER       (event->layer)
+#define  ROW         (event->row)
+#define  COL         (event->col)
+#define  IS_PRESSED  (event->is_pressed)
+
+
+// ----------------------------------------------------------------------------
+
+
+/*
+ * [name]
+ *   Mouse Move Press Release
+ *
+ * [description]
+ *   Move the mouse pointer, or scroll, while the key is held.  The keycode is
+ *   one of the `MOUSE_*` directions (see "lib/mouse-keys/public.h"); more than
+ *   one (e.g. `MOUSE_UP|MOUSE_LEFT`) moves diagonally.
+ *
+ * [note]
+ *   Does nothing unless `MOUSE_KEYS` is set in "src/makefile-options"
+ */
+void kbfun_mouse_move_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+	mousekeys_move(keycode, IS_PRESSED);
+}
+
+/*
+ * [name]
+ *   Mouse Button Press Release
+ *
+ * [description]
+ *   Press or release a mouse button.  The keycode is one of the
+ *   `MOUSE_BUTTON_*` buttons (see "lib/mouse-keys/public.h").
+ *
+ * [note]
+ *   Does nothing unless `MOUSE_KEYS` is set in "src/makefile-options"
+ */
+void kbfun_mouse_button_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+	mousekeys_button(keycode, IS_PRESSED);
+}
+
+/* ----------------------------------------------------------------------------
+ * ------------------------------------------------------------------------- */
+
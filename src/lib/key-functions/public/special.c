@@ -15,16 +15,19 @@
 #include "../../../main.h"
 #include "../public.h"
 #include "../private.h"
+#include "../autoshift.h"
+#include "../leader.h"
+#include "../numpad.h"
+#include "../unicode.h"
 
 // ----------------------------------------------------------------------------
 
 // convenience macros
-#define  LAYER         main_arg_layer
-#define  LAYER_OFFSET  main_arg_layer_offset
-#define  ROW           main_arg_row
-#define  COL           main_arg_col
-#define  IS_PRESSED    main_arg_is_pressed
-#define  WAS_PRESSED   main_arg_was_pressed
+#define  LAYER         (event->layer)
+#define  LAYER_OFFSET  (event->layer_offset)
+#define  ROW           (event->row)
+#define  COL           (event->col)
+#define  IS_PRESSED    (event->is_pressed)
 
 
 // ----------------------------------------------------------------------------
@@ -38,9 +41,30 @@
  *   Generate a 'shift' press or release before the normal keypress or
  *   keyrelease
  */
-void kbfun_shift_press_release(void) {
+void kbfun_shift_press_release(struct key_event * event) {
 	_kbfun_press_release(IS_PRESSED, KEY_LeftShift);
-	kbfun_press_release();
+	kbfun_press_release(event);
+}
+
+/*
+ * [name]
+ *   Invert shift + press|release
+ *
+ * [description]
+ *   Generate a normal keypress or keyrelease, sent shifted if shift isn't
+ *   pressed, and unshifted if it is (e.g. for a number row that types symbols
+ *   by default)
+ *
+ * [note]
+ *   Only this key is affected: shift goes back to how it was when the key is
+ *   released, or another key is pressed
+ */
+void kbfun_shift_inverted_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+
+	if (!event->trans_key_pressed)
+		main_any_non_trans_key_pressed = true;
+	_kbfun_press_release_modified(IS_PRESSED, keycode, 0, 0, MOD_Shift);
 }
 
 /*
@@ -58,7 +82,7 @@ void kbfun_shift_press_release(void) {
  *   Capslock will then be pressed and released, and the original state of the
  *   shifts will be restored
  */
-void kbfun_2_keys_capslock_press_release(void) {
+void kbfun_2_keys_capslock_press_release(struct key_event * event) {
 	static uint8_t keys_pressed;
 	static bool lshift_pressed;
 	static bool rshift_pressed;
@@ -95,17 +119,83 @@ void kbfun_2_keys_capslock_press_release(void) {
 	if (IS_PRESSED) keys_pressed++;
 }
 
+/*
+ * [name]
+ *   Auto-shift + press|release
+ *
+ * [description]
+ *   Generate a normal keypress and keyrelease if the key is tapped, or a
+ *   'shift' + keypress if it's held for at least `AUTOSHIFT_TIME` ms (see
+ *   "lib/key-functions/autoshift.h")
+ *
+ * [note]
+ *   Nothing is sent until the key is released, or held long enough.  Keys
+ *   pressed in the meantime are kept in order.
+ */
+void kbfun_autoshift_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+
+	if (!event->trans_key_pressed)
+		main_any_non_trans_key_pressed = true;
+	autoshift_press_release(IS_PRESSED, ROW, COL, keycode);
+}
+
+/*
+ * [name]
+ *   Leader
+ *
+ * [description]
+ *   Start a leader key sequence: the keys typed next are matched against the
+ *   layout's list of sequences, instead of being sent (see
+ *   "lib/key-functions/leader.h")
+ *
+ * [note]
+ *   Does nothing unless the layout has a "--leader.txt" file
+ */
+void kbfun_leader(struct key_event * event) {
+	if (IS_PRESSED)
+		leader_start();
+}
+
 /* ----------------------------------------------------------------------------
  * numpad functions
  * ------------------------------------------------------------------------- */
 
 static uint8_t numpad_layer_id;
 
-static inline void numpad_toggle_numlock(void) {
-	_kbfun_press_release(true, KEY_LockingNumLock);
-	usb_keyboard_send();
-	_kbfun_press_release(false, KEY_LockingNumLock);
-	usb_keyboard_send();
+static uint8_t numlock_taps;     // queued (see "../numpad.h")
+static bool    numlock_pressed;  // (to be released next scan)
+
+static void numpad_toggle_numlock(void) {
+	if (numlock_taps < 0xFF)
+		numlock_taps++;
+}
+
+/*
+ * Called once per scan, before the keyboard report is sent: press (or
+ * release) numlock, for the next queued tap
+ */
+void numpad_update(void) {
+	if (numlock_pressed) {
+		_kbfun_press_release(false, KEY_LockingNumLock);
+		numlock_pressed = false;
+	} else if (numlock_taps && !unicode_is_sending()) {
+		_kbfun_press_release(true, KEY_LockingNumLock);
+		numlock_pressed = true;
+		numlock_taps--;
+	}
+}
+
+/*
+ * Turn the numpad off, if it's on (see "../numpad.h")
+ */
+void numpad_reset(void) {
+	if (!numpad_layer_id)
+		return;
+
+	main_layers_pop_id(numpad_layer_id);
+	numpad_layer_id = 0;
+	numpad_toggle_numlock();
 }
 
 /*
@@ -115,13 +205,14 @@ static inline void numpad_toggle_numlock(void) {
  * [description]
  *   Set the numpad to on (put the numpad layer, specified in the keymap, in an
  *   element at the top of the layer stack, and record that element's id) and
- *   toggle numlock (regardless of whether or not numlock is currently on)
+ *   toggle numlock (regardless of whether or not numlock is currently on; the
+ *   tap is sent over the next two scans, see "../numpad.h")
  *
  * [note]
  *   Meant to be assigned (along with "numpad off") instead of a normal numlock
  *   key
  */
-void kbfun_layer_push_numpad(void) {
+void kbfun_layer_push_numpad(struct key_event * event) {
 	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
 	main_layers_pop_id(numpad_layer_id);
 	numpad_layer_id = main_layers_push(keycode, eStickyNone);
@@ -135,13 +226,13 @@ void kbfun_layer_push_numpad(void) {
  * [description]
  *   Set the numpad to off (pop the layer element created by "numpad on" out of
  *   the stack) and toggle numlock (regardless of whether or not numlock is
- *   currently on)
+ *   currently on; the tap is sent over the next two scans)
  *
  * [note]
  *   Meant to be assigned (along with "numpad on") instead of a normal numlock
  *   key
  */
-void kbfun_layer_pop_numpad(void) {
+void kbfun_layer_pop_numpad(struct key_event * event) {
 	main_layers_pop_id(numpad_layer_id);
 	numpad_layer_id = 0;
 	numpad_toggle_numlock();
@@ -155,10 +246,71 @@ void kbfun_layer_pop_numpad(void) {
  *   Generate a keypress for a media key, such as play/pause, next track, or
  *   previous track
  *
+ * [note]
+ *   The same as the 0x00xx consumer key function; kept for the `MEDIAKEY_*`
+ *   keycodes in "lib/usb/usage-page/keyboard.h"
+ */
+void kbfun_mediakey_press_release(struct key_event * event) {
+	kbfun_consumer_press_release(event);
+}
+
+/*
+ * [name]
+ *   Consumer Key Press Release (usages 0x00xx)
+ *
+ * [description]
+ *   Generate a keypress for a consumer control (usage page 0x0C) with a usage
+ *   between 0x0000 and 0x00FF (media controls, volume, brightness, etc.).  The
+ *   keycode is the low byte of the usage (see
+ *   "lib/usb/usage-page/consumer.h").
+ */
+void kbfun_consumer_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+	_kbfun_consumer_press_release(IS_PRESSED, keycode);
+}
+
+/*
+ * [name]
+ *   Consumer Key Press Release (usages 0x01xx)
+ *
+ * [description]
+ *   Generate a keypress for a consumer control (usage page 0x0C) with a usage
+ *   between 0x0100 and 0x01FF (application launch buttons: calculator, email,
+ *   browser, etc.).  The keycode is the low byte of the usage (see
+ *   "lib/usb/usage-page/consumer.h").
+ */
+void kbfun_consumer_1_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+	_kbfun_consumer_press_release(IS_PRESSED, 0x0100 | keycode);
+}
+
+/*
+ * [name]
+ *   Consumer Key Press Release (usages 0x02xx)
+ *
+ * [description]
+ *   Generate a keypress for a consumer control (usage page 0x0C) with a usage
+ *   between 0x0200 and 0x02FF (application controls: back, forward, search,
+ *   etc.).  The keycode is the low byte of the usage (see
+ *   "lib/usb/usage-page/consumer.h").
+ */
+void kbfun_consumer_2_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+	_kbfun_consumer_press_release(IS_PRESSED, 0x0200 | keycode);
+}
+
+/*
+ * [name]
+ *   System Key Press Release
+ *
+ * [description]
+ *   Generate a keypress for a system control (power down, sleep, wake up,
+ *   etc.).  The keycode is the usage (see
+ *   "lib/usb/usage-page/generic-desktop.h").
  */
-void kbfun_mediakey_press_release(void) {
+void kbfun_system_press_release(struct key_event * event) {
 	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
-	_kbfun_mediakey_press_release(IS_PRESSED, keycode);
+	_kbfun_system_press_release(IS_PRESSED, keycode);
 }
 
 /* ----------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+ * key functions : steno : code
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../../../keyboard/layout.h"
+#include "../../../main.h"
+#include "../public.h"
+
+// ----------------------------------------------------------------------------
+
+// convenience macros
+#define  LAYER       (event->layer)
+#define  ROW         (event->row)
+#define  COL         (event->col)
+#define  IS_PRESSED  (event->is_pressed)
+
+
+// ----------------------------------------------------------------------------
+// descriptions
+// ----------------------------------------------------------------------------
+
+/*
+ * [name]
+ *   Steno Key Press Release
+ *
+ * [description]
+ *   Add a steno key to the current stroke.  The keycode is one of the
+ *   `STENO_*` keys (see "lib/steno/gemini-pr.h").  Nothing is sent while
+ *   keys are held; when the last steno key is released (counting physical
+ *   keys, so a steno key can be on more than one), the whole stroke is sent
+ *   to the host (on its own USB interface, as a GeminiPR packet in a
+ *   vendor defined HID report), and a new stroke begins.
+ *
+ * [note]
+ *   Does nothing unless `STENO` is set in "src/makefile-options"
+ */
+void kbfun_steno_press_release(struct key_event * event);
+
+
+// ----------------------------------------------------------------------------
+#if MAKEFILE_STENO
+// ----------------------------------------------------------------------------
+
+static uint8_t stroke[USB_STENO_PACKET_SIZE];  // every key pressed
+static uint8_t held;  // physical keys still down (a steno key may be on more
+                      // than one)
+
+void kbfun_steno_press_release(struct key_event * event) {
+	uint8_t keycode = kb_layout_get(LAYER, ROW, COL);
+	uint8_t byte = keycode >> 3;
+	uint8_t mask = 1 << (keycode & 0x07);
+
+	if (byte >= USB_STENO_PACKET_SIZE)
+		return;
+
+	if (IS_PRESSED) {
+		stroke[byte] |= mask;
+		held++;
+		return;
+	}
+
+	if (!held || --held)
+		return;
+
+	stroke[0] |= 0x80;  // (marks the first byte of a packet)
+	usb_steno_send(stroke);
+	for (uint8_t i=0; i<USB_STENO_PACKET_SIZE; i++)
+		stroke[i] = 0;
+}
+
+
+// ----------------------------------------------------------------------------
+#else
+// ----------------------------------------------------------------------------
+
+void kbfun_steno_press_release(struct key_event * event) {}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
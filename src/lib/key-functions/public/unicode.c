@@ -0,0 +1,64 @@
+/* ----------------------------------------------------------------------------
+ * key functions : unicode : code
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../../keyboard/layout.h"
+#include "../../../main.h"
+#include "../public.h"
+#include "../autoshift.h"
+#include "../unicode.h"
+
+// ----------------------------------------------------------------------------
+
+// convenience macros
+#define  LAYER       (event->layer)
+#define  ROW         (event->row)
+#define  COL         (event->col)
+#define  IS_PRESSED  (event->is_pressed)
+
+
+// ----------------------------------------------------------------------------
+
+/*
+ * [name]
+ *   Unicode Press
+ *
+ * [description]
+ *   Type a Unicode character.  The keycode is the character's index in the
+ *   layout's `_kb_unicode[]` (see "lib/key-functions/unicode.h").
+ *
+ * [note]
+ *   The character is queued, and typed over the next few scans (using the
+ *   current input method); holding the key does not repeat it
+ */
+void kbfun_unicode_press(struct key_event * event) {
+	if (!IS_PRESSED)
+		return;
+
+	if (!event->trans_key_pressed)
+		main_any_non_trans_key_pressed = true;
+
+	autoshift_flush();  // (keys held back by auto-shift were pressed first)
+	unicode_send(kb_layout_get(LAYER, ROW, COL));
+}
+
+/*
+ * [name]
+ *   Unicode Mode
+ *
+ * [description]
+ *   Choose the input method used to type Unicode characters.  The keycode is
+ *   one of the `UNICODE_*` modes (see "lib/key-functions/unicode.h").
+ */
+void kbfun_unicode_mode(struct key_event * event) {
+	if (IS_PRESSED)
+		unicode_set_mode(kb_layout_get(LAYER, ROW, COL));
+}
+
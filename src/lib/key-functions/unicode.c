@@ -0,0 +1,311 @@
+/* ----------------------------------------------------------------------------
+ * key functions : unicode : code
+ *
+ * Notes
+ * - The queue holds indices into `_kb_unicode[]` (1 byte each), not code
+ *   points, and the reports for a character are worked out one at a time, as
+ *   they're sent; so the RAM used doesn't depend on the input method
+ * - Keys that were held when the queue started being sent stay held in every
+ *   report sent from it (so the host doesn't see them released and pressed
+ *   again); key events after that are kept, and replayed (by the main loop,
+ *   with `unicode_replay()`) when the queue is empty
+ * - Kept events are packed into a byte each: `(is_pressed << 7) | (row << 4)
+ *   | col`
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../../lib/usb/usage-page/keyboard.h"
+#include "../../keyboard/layout.h"
+#include "./private.h"
+#include "./unicode.h"
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#ifdef KB_UNICODE_CHARS
+// ----------------------------------------------------------------------------
+
+
+#if KB_ROWS > 8 || KB_COLUMNS > 16
+	#error "the kept key events don't have room for this matrix"
+#endif
+
+extern const kb_unicode_t PROGMEM _kb_unicode[KB_UNICODE_CHARS];
+
+// ----------------------------------------------------------------------------
+
+/*
+ * The reports (modifiers, key) to send for a character, with each input
+ * method
+ *
+ * - `DIGITS` stands for the code point's hex digits, each pressed and then
+ *   released (with the modifiers given)
+ * - `END` ends the list
+ */
+#define  DIGITS  0xFF
+#define  END     0xFE
+#define  STEPS   8
+
+static const uint8_t PROGMEM steps[][STEPS][2] = {
+	[UNICODE_LINUX] = {
+		{ MOD_LeftControl | MOD_LeftShift,  KEY_u_U },
+		{ 0,                                0 },
+		{ 0,                                DIGITS },
+		{ 0,                                KEY_Spacebar },
+		{ 0,                                0 },
+		{ 0,                                END } },
+	[UNICODE_WINDOWS] = {
+		{ MOD_LeftAlt,                      0 },
+		{ MOD_LeftAlt,                      KEYPAD_Plus },
+		{ MOD_LeftAlt,                      0 },
+		{ MOD_LeftAlt,                      DIGITS },
+		{ 0,                                0 },
+		{ 0,                                END } },
+	[UNICODE_WINCOMPOSE] = {
+		{ MOD_RightAlt,                     0 },
+		{ 0,                                0 },
+		{ 0,                                KEY_u_U },
+		{ 0,                                0 },
+		{ 0,                                DIGITS },
+		{ 0,                                KEY_ReturnEnter },
+		{ 0,                                0 },
+		{ 0,                                END } },
+};
+
+#define  MODES  (sizeof(steps) / sizeof(steps[0]))
+
+// ----------------------------------------------------------------------------
+
+static uint8_t queue[UNICODE_QUEUE];  // indices into `_kb_unicode[]`
+static uint8_t queue_head;
+static uint8_t queue_count;
+
+static uint8_t mode = UNICODE_MODE;  // for characters not yet started
+static uint8_t char_mode;            // for the character being sent
+static uint8_t step;                 // the next report's position in `steps`
+static uint8_t digit;                // (2 per digit: pressed, released)
+
+static bool    sending;
+static uint8_t held[6];  // keys held when sending started
+
+static uint8_t events[UNICODE_EVENTS];  // key events kept while sending
+static uint8_t events_head;
+static uint8_t events_count;
+static bool    flushing;  // (`events` filled up; replay them now anyway)
+
+// ----------------------------------------------------------------------------
+
+static uint32_t code_point(uint8_t index) {
+	return            pgm_read_byte(&_kb_unicode[index][0])
+	     | (uint16_t) pgm_read_byte(&_kb_unicode[index][1]) << 8
+	     | (uint32_t) pgm_read_byte(&_kb_unicode[index][2]) << 16;
+}
+
+/*
+ * The keycode for a hex digit
+ */
+static uint8_t digit_key(uint8_t value, bool keypad) {
+	if (value >= 10)
+		return KEY_a_A + (value - 10);
+	if (value == 0)
+		return keypad ? KEYPAD_0_Insert : KEY_0_RightParenthesis;
+	return (keypad ? KEYPAD_1_End : KEY_1_Exclamation) + (value - 1);
+}
+
+/*
+ * Work out the next report to send for the character at the head of the
+ * queue
+ *
+ * Returns
+ * - `false` if there are no more (and nothing was changed)
+ */
+static bool next_report(uint8_t * modifiers, uint8_t * key) {
+	uint32_t cp = code_point(queue[queue_head]);
+	uint8_t  digits = (cp > 0xFFFFF) ? 6 : (cp > 0xFFFF) ? 5 : 4;
+
+	// (this method can't type it)
+	if (char_mode == UNICODE_WINDOWS && cp > 0xFFFF)
+		return false;
+
+	for (;;) {
+		*modifiers = pgm_read_byte(&steps[char_mode][step][0]);
+		*key       = pgm_read_byte(&steps[char_mode][step][1]);
+
+		if (*key == END)
+			return false;
+		if (*key != DIGITS) {
+			step++;
+			return true;
+		}
+		if (digit < digits*2) {
+			if (digit & 1) {
+				*key = 0;
+			} else {
+				uint8_t shift = (digits - 1 - digit/2) * 4;
+				*key = digit_key( (cp >> shift) & 0x0F,
+				                  char_mode == UNICODE_WINDOWS );
+			}
+			digit++;
+			return true;
+		}
+		step++;
+		digit = 0;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Queue character `index` (of `_kb_unicode[]`) to be sent
+ *
+ * Note
+ * - If the queue is full, the character is dropped
+ */
+void unicode_send(uint8_t index) {
+	if (index >= KB_UNICODE_CHARS || queue_count == UNICODE_QUEUE)
+		return;
+
+	queue[(queue_head + queue_count) % UNICODE_QUEUE] = index;
+	queue_count++;
+}
+
+/*
+ * Choose the input method (one of the `UNICODE_*` modes) for characters sent
+ * from now on
+ */
+void unicode_set_mode(uint8_t new_mode) {
+	if (new_mode < MODES)
+		mode = new_mode;
+}
+
+/*
+ * Called once per scan, before the keyboard report is sent: send the next
+ * report for the queued characters, if there are any
+ *
+ * Returns
+ * - `true` if the report this scan was taken care of here (and the usual one
+ *   should not be sent)
+ */
+bool unicode_update(void) {
+	uint8_t modifiers, key;
+
+	if (!queue_count) {
+		sending = false;
+		return false;
+	}
+
+	// let this scan's report go first (keys pressed before the character)
+	if (!sending) {
+		sending = true;
+		step = digit = 0;
+		char_mode = mode;
+		for (uint8_t i=0; i<6; i++)
+			held[i] = keyboard_keys[i];
+		return false;
+	}
+
+	// (on to the next character, if this one is done)
+	uint8_t saved_step = step, saved_digit = digit;
+	while (!next_report(&modifiers, &key)) {
+		queue_head = (queue_head + 1) % UNICODE_QUEUE;
+		queue_count--;
+		step = digit = 0;
+		char_mode = mode;
+		if (!queue_count) {
+			sending = false;
+			return false;
+		}
+		saved_step = saved_digit = 0;
+	}
+
+	uint8_t keys[6];
+	for (uint8_t i=0; i<6; i++)
+		keys[i] = held[i];
+	for (uint8_t i=0; key && i<6; i++) {
+		if (!keys[i] || i == 5) {
+			keys[i] = key;
+			break;
+		}
+	}
+
+	// if the endpoint is busy, try again next scan
+	if (usb_keyboard_send_report(modifiers, keys)) {
+		step  = saved_step;
+		digit = saved_digit;
+	}
+
+	return true;
+}
+
+/*
+ * Whether characters are being sent (so the keyboard report belongs to
+ * `unicode_update()`, and shouldn't be sent from anywhere else)
+ */
+bool unicode_is_sending(void) {
+	return sending;
+}
+
+/*
+ * Called by the main loop for every key event: while characters are being
+ * sent, keep it to be replayed after
+ *
+ * Returns
+ * - `true` if the event was kept (and shouldn't be handled now)
+ *
+ * Note
+ * - If there's no more room, the event isn't kept, and the kept ones should
+ *   be replayed (with `unicode_replay()`, which gives them up right away in
+ *   this case) before it's handled, so nothing is reordered.  Their reports
+ *   are then only sent when the characters are done (so taps among them are
+ *   lost), but no key is left pressed.
+ */
+bool unicode_key_event(uint8_t row, uint8_t col, bool is_pressed) {
+	if (!sending)
+		return false;
+
+	if (events_count == UNICODE_EVENTS) {
+		flushing = true;
+		return false;
+	}
+
+	events[(events_head + events_count) % UNICODE_EVENTS] =
+		(is_pressed << 7) | (row << 4) | col;
+	events_count++;
+	return true;
+}
+
+/*
+ * Take the oldest kept key event, once the characters are sent
+ *
+ * Returns
+ * - `false` if there isn't one (or if it should wait)
+ */
+bool unicode_replay(uint8_t * row, uint8_t * col, bool * is_pressed) {
+	if (!events_count || (sending && !flushing)) {
+		flushing = false;
+		return false;
+	}
+
+	uint8_t event = events[events_head];
+	events_head = (events_head + 1) % UNICODE_EVENTS;
+	events_count--;
+
+	*is_pressed = event >> 7;
+	*row        = (event >> 4) & 0x07;
+	*col        = event & 0x0F;
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,112 @@
+/* ----------------------------------------------------------------------------
+ * key functions : unicode : exports
+ *
+ * Keys using `kbfun_unicode_press` type a Unicode character, using one of the
+ * input methods hosts provide for typing characters by code point:
+ * - `UNICODE_LINUX`: 'ctrl' + 'shift' + 'u', then the code point in hex, then
+ *   'space' (for IBus; GTK applications support this without IBus, too)
+ * - `UNICODE_WINDOWS`: 'alt' held, 'keypad +', then the code point in hex.
+ *   Needs the registry value "EnableHexNumpad" (a string, "1", in
+ *   "HKEY_CURRENT_USER\Control Panel\Input Method") set, and only works for
+ *   code points up to 0xFFFF.
+ * - `UNICODE_WINCOMPOSE`: 'right alt' (WinCompose's default compose key), 'u',
+ *   then the code point in hex, then 'enter'
+ *
+ * Each character takes many reports, so they're queued, and sent one report
+ * per scan (after the scan's own report is sent, and instead of the ones
+ * after, until the queue is empty).  So key functions never wait for them to
+ * be sent.  Keys pressed and released in the meantime are kept (up to
+ * `UNICODE_EVENTS` of them), and replayed once the queue is empty, so they
+ * come out after, in order.
+ *
+ * To use unicode, a layout should
+ * - `#define KB_UNICODE_CHARS` (the number of characters) in its ".h"
+ * - define `_kb_unicode[KB_UNICODE_CHARS]` in its ".c", e.g.
+ *
+ *       const kb_unicode_t PROGMEM _kb_unicode[KB_UNICODE_CHARS] = {
+ *           KB_UNICODE_CHAR( 0x00E9 ),   // 0: e with acute
+ *           KB_UNICODE_CHAR( 0x1F600 ),  // 1: grinning face
+ *       };
+ *
+ *   and use the index of a character as the keycode of its key
+ *
+ * Code points are stored packed, in 3 bytes each (they're at most 21 bits).
+ *
+ * Layouts that don't define `KB_UNICODE_CHARS` don't pay for any of this.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__KEY_FUNCTIONS__UNICODE_h
+	#define LIB__KEY_FUNCTIONS__UNICODE_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+	#include "../../keyboard/layout.h"
+
+	// --------------------------------------------------------------------
+
+	// input methods (the keycodes for `kbfun_unicode_mode`)
+	#define  UNICODE_LINUX       0
+	#define  UNICODE_WINDOWS     1
+	#define  UNICODE_WINCOMPOSE  2
+
+	/*
+	 * UNICODE_MODE
+	 * - The input method to use until another is chosen
+	 * - May be defined in the layout's ".h"
+	 *
+	 * UNICODE_QUEUE
+	 * - The most characters that can be waiting to be sent
+	 *
+	 * UNICODE_EVENTS
+	 * - The most key events that can be kept while characters are being
+	 *   sent (1 byte each)
+	 */
+	#ifndef UNICODE_MODE
+		#define  UNICODE_MODE  UNICODE_LINUX
+	#endif
+
+	#define  UNICODE_QUEUE   8
+	#define  UNICODE_EVENTS  16
+
+	// --------------------------------------------------------------------
+
+	typedef uint8_t kb_unicode_t[3];
+
+	// a character, for `_kb_unicode[]`
+	#define  KB_UNICODE_CHAR(code_point)  {				\
+		(uint8_t)(code_point),					\
+		(uint8_t)((uint32_t)(code_point) >> 8),			\
+		(uint8_t)((uint32_t)(code_point) >> 16) }
+
+	// --------------------------------------------------------------------
+
+	#ifdef KB_UNICODE_CHARS
+
+		void unicode_send       (uint8_t index);
+		void unicode_set_mode   (uint8_t mode);
+		bool unicode_update     (void);
+		bool unicode_is_sending (void);
+		bool unicode_key_event  (uint8_t row, uint8_t col, bool is_pressed);
+		bool unicode_replay     ( uint8_t * row, uint8_t * col,
+		                          bool * is_pressed );
+
+	#else
+
+		#define  unicode_send(index)    ((void)(index))
+		#define  unicode_set_mode(mode) ((void)(mode))
+		#define  unicode_update()       false
+		#define  unicode_is_sending()   false
+		#define  unicode_key_event(row, col, is_pressed)		\
+			((void)(row), (void)(col), (void)(is_pressed), false)
+		#define  unicode_replay(row, col, is_pressed)			\
+			((void)(row), (void)(col), (void)(is_pressed), false)
+
+	#endif
+
+#endif
+
@@ -0,0 +1,277 @@
+/* ----------------------------------------------------------------------------
+ * mouse keys : motion : code
+ *
+ * `usb_mouse_frame()` and `usb_mouse_report()` are called from the USB start
+ * of frame interrupt (see "usb_keyboard.c"), so everything here runs once per
+ * millisecond.
+ *
+ * Fixed point
+ * - Positions and speeds are in counts (or detents), with 16 fractional bits
+ *   ("Q16")
+ * - How far along the acceleration curve a movement is, is kept as a 16 bit
+ *   fraction of the way from min to max speed, incremented every frame
+ *   until it saturates
+ * - The curve is `min + (max - min) * p^2`, where `p` is the top 8 bits of
+ *   that fraction (with `p^2` scaled so it reaches 255/256 at full speed);
+ *   so each frame is an 8 bit multiply, one or two 32 bit multiplies, and
+ *   some adds (a few hundred cycles at most, out of the 16000 in a frame)
+ * - Constants are rounded to the nearest, and `max - min` is multiplied
+ *   before it's shifted, so the speeds stay within about 1% of the curve
+ *   (see "test/mouse-keys.c")
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_MOUSE_KEYS
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <util/atomic.h>
+#include "../../lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "./public.h"
+
+// ----------------------------------------------------------------------------
+
+// counts per second -> Q16 counts per frame (1 frame = 1ms)
+#define  Q16_PER_FRAME(per_second)  ( ((per_second) * 65536UL + 500) / 1000 )
+
+// ms to accelerate -> progress per frame (a 16 bit fraction)
+#define  STEP(ms)  ( (0xFFFFUL + (ms)/2) / (ms) )
+
+#define  POINTER_MIN    Q16_PER_FRAME(MOUSE_SPEED_MIN)
+#define  POINTER_RANGE  ( Q16_PER_FRAME(MOUSE_SPEED_MAX) - POINTER_MIN )
+#define  POINTER_STEP   STEP(MOUSE_ACCEL_TIME)
+
+#define  WHEEL_MIN      Q16_PER_FRAME(MOUSE_WHEEL_SPEED_MIN)
+#define  WHEEL_RANGE    ( Q16_PER_FRAME(MOUSE_WHEEL_SPEED_MAX) - WHEEL_MIN )
+#define  WHEEL_STEP     STEP(MOUSE_WHEEL_ACCEL_TIME)
+
+#if MOUSE_SPEED_MAX < MOUSE_SPEED_MIN \
+	|| MOUSE_WHEEL_SPEED_MAX < MOUSE_WHEEL_SPEED_MIN
+	#error "mouse keys: max speeds must be at least the min speeds"
+#endif
+#if POINTER_RANGE > 0xFFFFFFFFUL / 255 || WHEEL_RANGE > 0xFFFFFFFFUL / 255
+	#error "mouse keys: max speeds are too high"
+#endif
+#if MOUSE_DELAY > 255
+	#error "mouse keys: the delay must be 255 ms or less"
+#endif
+#if MOUSE_ACCEL_TIME < 1 || MOUSE_ACCEL_TIME > 0xFFFF \
+	|| MOUSE_WHEEL_ACCEL_TIME < 1 || MOUSE_WHEEL_ACCEL_TIME > 0xFFFF
+	#error "mouse keys: acceleration times must be between 1 and 65535 ms"
+#endif
+
+#define  POINTER  (MOUSE_UP|MOUSE_DOWN|MOUSE_LEFT|MOUSE_RIGHT)
+#define  WHEEL    (MOUSE_WHEEL_UP|MOUSE_WHEEL_DOWN|	\
+		   MOUSE_WHEEL_LEFT|MOUSE_WHEEL_RIGHT)
+
+#define  ONE_COUNT    ( 1L << 16 )
+#define  MAX_PENDING  ( 127L << 16 )
+
+// report axes (in report order, after the buttons)
+#define  AXIS_X      0
+#define  AXIS_Y      1
+#define  AXIS_WHEEL  2
+#define  AXIS_PAN    3
+#define  AXES        4
+
+// ----------------------------------------------------------------------------
+
+// - written by key functions, read (and, for `taps`, cleared) every frame
+static volatile uint8_t directions;  // held
+static volatile uint8_t taps;        // pressed since the last frame
+static volatile uint8_t buttons;
+
+// - used only in the interrupt
+static uint8_t  last_buttons;        // as last reported
+static uint8_t  pointer_wait;        // frames held, until `MOUSE_DELAY`
+static uint8_t  wheel_wait;
+static uint16_t pointer_progress;
+static uint16_t wheel_progress;
+static int32_t  pending[AXES];       // Q16; not yet reported
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Advance `*progress` by `step` (saturating), and return the speed (Q16 per
+ * frame) for the new position on the curve
+ */
+static uint32_t curve(uint16_t * progress, uint16_t step,
+                      uint32_t min, uint32_t range) {
+	uint8_t p;
+
+	*progress = (*progress > 0xFFFF - step) ? 0xFFFF : *progress + step;
+	p = *progress >> 8;
+	p = ((uint16_t)p * (p + 1)) >> 8;
+
+	return min + ( (range * p) >> 8 );
+}
+
+/*
+ * Add `amount` (Q16) to an axis, in the direction given by which of the two
+ * bits in `held` is set (`positive` or `negative`; if both, they cancel)
+ */
+static void add(uint8_t axis, uint8_t held, uint8_t positive,
+                uint8_t negative, int32_t amount) {
+	int32_t p = pending[axis];
+
+	if (held & positive) p += amount;
+	if (held & negative) p -= amount;
+
+	if      (p >  MAX_PENDING) p =  MAX_PENDING;
+	else if (p < -MAX_PENDING) p = -MAX_PENDING;
+
+	pending[axis] = p;
+}
+
+/*
+ * Remove (and return) the whole number of counts pending on an axis, up to
+ * what fits in a report
+ */
+static int8_t take(uint8_t axis) {
+	int32_t p = pending[axis];
+	int8_t whole;
+
+	// (rounding toward zero, so the fractional part keeps its sign)
+	whole = (p < 0) ? -(int8_t)((-p) >> 16) : (int8_t)(p >> 16);
+	pending[axis] = p - (int32_t)whole * ONE_COUNT;
+
+	return whole;
+}
+
+/*
+ * Discard the fraction of a count pending on an axis (keeping any whole
+ * counts not yet reported), so that a leftover fraction from the last movement
+ * can't cancel (or add to) the first count of the next one
+ */
+static void drop_fraction(uint8_t axis) {
+	pending[axis] -= pending[axis] % ONE_COUNT;
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Called every frame (whether or not a report can be sent)
+ */
+void usb_mouse_frame(void) {
+	uint8_t held = directions;
+	uint8_t tapped = taps;
+	taps = 0;
+
+	// pointer
+	// - nothing but the first count (below) until `MOUSE_DELAY` has passed
+	if (!(held & POINTER)) {
+		pointer_wait = 0;
+		if (pointer_progress) {
+			pointer_progress = 0;
+			drop_fraction(AXIS_X);
+			drop_fraction(AXIS_Y);
+		}
+	} else if (pointer_wait < MOUSE_DELAY) {
+		pointer_wait++;
+	} else {
+		int32_t speed = curve( &pointer_progress, POINTER_STEP,
+		                       POINTER_MIN, POINTER_RANGE );
+		// diagonal: scale by 181/256 (about 1/sqrt(2))
+		if ((held & (MOUSE_UP|MOUSE_DOWN)) && (held & (MOUSE_LEFT|MOUSE_RIGHT)))
+			speed = (speed >> 8) * 181;
+		add(AXIS_X, held, MOUSE_RIGHT, MOUSE_LEFT, speed);
+		add(AXIS_Y, held, MOUSE_DOWN,  MOUSE_UP,   speed);
+	}
+
+	// wheel
+	if (!(held & WHEEL)) {
+		wheel_wait = 0;
+		if (wheel_progress) {
+			wheel_progress = 0;
+			drop_fraction(AXIS_WHEEL);
+			drop_fraction(AXIS_PAN);
+		}
+	} else if (wheel_wait < MOUSE_DELAY) {
+		wheel_wait++;
+	} else {
+		int32_t speed = curve( &wheel_progress, WHEEL_STEP,
+		                       WHEEL_MIN, WHEEL_RANGE );
+		add(AXIS_WHEEL, held, MOUSE_WHEEL_UP,    MOUSE_WHEEL_DOWN, speed);
+		add(AXIS_PAN,   held, MOUSE_WHEEL_RIGHT, MOUSE_WHEEL_LEFT, speed);
+	}
+
+	// one count immediately, for each new press
+	if (tapped) {
+		add(AXIS_X,     tapped, MOUSE_RIGHT,       MOUSE_LEFT,       ONE_COUNT);
+		add(AXIS_Y,     tapped, MOUSE_DOWN,        MOUSE_UP,         ONE_COUNT);
+		add(AXIS_WHEEL, tapped, MOUSE_WHEEL_UP,    MOUSE_WHEEL_DOWN, ONE_COUNT);
+		add(AXIS_PAN,   tapped, MOUSE_WHEEL_RIGHT, MOUSE_WHEEL_LEFT, ONE_COUNT);
+	}
+}
+
+/*
+ * Called when the mouse endpoint is ready for a report
+ *
+ * Returns
+ * - true: if `report` was filled in, and should be sent (something moved, or
+ *   the buttons changed)
+ * - false: if there's nothing to send
+ */
+uint8_t usb_mouse_report(uint8_t * report) {
+	uint8_t send = false;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		int8_t whole = take(axis);
+		report[1+axis] = (uint8_t)whole;
+		if (whole)
+			send = true;
+	}
+
+	report[0] = buttons;
+	if (report[0] != last_buttons)
+		send = true;
+	last_buttons = report[0];
+
+	return send;
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Arguments
+ * - `direction`: one of the `MOUSE_*` directions
+ * - `press`: whether the key for that direction was pressed or released
+ */
+void mousekeys_move(uint8_t direction, bool press) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (press) {
+			directions |= direction;
+			taps |= direction;
+		} else {
+			directions &= ~direction;
+		}
+	}
+}
+
+/*
+ * Arguments
+ * - `button`: one of the `MOUSE_BUTTON_*` buttons
+ * - `press`: whether to press or release it
+ */
+void mousekeys_button(uint8_t button, bool press) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (press)
+			buttons |= button;
+		else
+			buttons &= ~button;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
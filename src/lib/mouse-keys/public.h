@@ -0,0 +1,104 @@
+/* ----------------------------------------------------------------------------
+ * mouse keys : public exports
+ *
+ * Moving the mouse pointer (and scroll wheel) from the keyboard.  Keys set
+ * which directions are held; the motion itself is computed every USB frame
+ * (1ms), from the time each direction has been held, so the speed doesn't
+ * depend on how often the matrix is scanned.
+ *
+ * Compiled in if `MOUSE_KEYS` is set in "src/makefile-options"; if not, the
+ * calls here compile to nothing (and there's no mouse USB interface).
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__MOUSE_KEYS__PUBLIC_h
+	#define LIB__MOUSE_KEYS__PUBLIC_h
+
+	#include <stdbool.h>
+	#include <stdint.h>
+
+	// --------------------------------------------------------------------
+
+	/*
+	 * MOUSE_SPEED_MIN, MOUSE_SPEED_MAX
+	 * - Pointer speed (in counts per second) when a direction is first
+	 *   pressed, and after it's been held for `MOUSE_ACCEL_TIME` ms
+	 *
+	 * MOUSE_WHEEL_SPEED_MIN, MOUSE_WHEEL_SPEED_MAX
+	 * - The same, for the scroll wheel (in detents per second), with
+	 *   `MOUSE_WHEEL_ACCEL_TIME`
+	 *
+	 * MOUSE_DELAY
+	 * - How long (in ms, up to 255) a direction has to be held before it
+	 *   starts moving continuously
+	 *
+	 * Notes
+	 * - Speed follows a quadratic curve between the min and the max: slow
+	 *   for a while (for small, precise moves), then quickly faster
+	 * - Each press moves by one count (or detent) immediately, and nothing
+	 *   more until `MOUSE_DELAY` has passed; so tapping a key (for less
+	 *   than that) moves the pointer exactly one count
+	 * - Diagonal pointer movement is scaled by 1/sqrt(2), so it's the same
+	 *   speed as straight movement
+	 */
+	#ifndef MOUSE_SPEED_MIN
+		#define  MOUSE_SPEED_MIN         100
+	#endif
+	#ifndef MOUSE_SPEED_MAX
+		#define  MOUSE_SPEED_MAX         1500
+	#endif
+	#ifndef MOUSE_ACCEL_TIME
+		#define  MOUSE_ACCEL_TIME        1500
+	#endif
+	#ifndef MOUSE_WHEEL_SPEED_MIN
+		#define  MOUSE_WHEEL_SPEED_MIN   4
+	#endif
+	#ifndef MOUSE_WHEEL_SPEED_MAX
+		#define  MOUSE_WHEEL_SPEED_MAX   25
+	#endif
+	#ifndef MOUSE_WHEEL_ACCEL_TIME
+		#define  MOUSE_WHEEL_ACCEL_TIME  2000
+	#endif
+	#ifndef MOUSE_DELAY
+		#define  MOUSE_DELAY             150
+	#endif
+
+	// directions (for `mousekeys_move()`)
+	#define  MOUSE_UP           (1<<0)
+	#define  MOUSE_DOWN         (1<<1)
+	#define  MOUSE_LEFT         (1<<2)
+	#define  MOUSE_RIGHT        (1<<3)
+	#define  MOUSE_WHEEL_UP     (1<<4)
+	#define  MOUSE_WHEEL_DOWN   (1<<5)
+	#define  MOUSE_WHEEL_LEFT   (1<<6)
+	#define  MOUSE_WHEEL_RIGHT  (1<<7)
+
+	// buttons (for `mousekeys_button()`)
+	#define  MOUSE_BUTTON_LEFT     (1<<0)
+	#define  MOUSE_BUTTON_RIGHT    (1<<1)
+	#define  MOUSE_BUTTON_MIDDLE   (1<<2)
+	#define  MOUSE_BUTTON_BACK     (1<<3)
+	#define  MOUSE_BUTTON_FORWARD  (1<<4)
+
+	// --------------------------------------------------------------------
+
+	#if MAKEFILE_MOUSE_KEYS
+
+		void mousekeys_move   (uint8_t direction, bool press);
+		void mousekeys_button (uint8_t button, bool press);
+
+	#else
+
+		#define  mousekeys_move(direction, press)  \
+			((void)(direction), (void)(press))
+		#define  mousekeys_button(button, press)  \
+			((void)(button), (void)(press))
+
+	#endif
+
+#endif
+
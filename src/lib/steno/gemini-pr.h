@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * Steno keys, as bits in a GeminiPR packet
+ *
+ * A GeminiPR packet is 6 bytes.  The high bit of the first byte is always
+ * set (marking the start of a packet), the high bit of the others is always
+ * clear, and the low 7 bits of each byte are keys, in the order listed here
+ * (from bit 6 of byte 0, to bit 0 of byte 5).
+ *
+ * - Keycodes are `(byte << 3) | bit`, so that they fit in a layout matrix,
+ *   and are quick to turn into a byte index and a mask
+ * - Use with `kbfun_steno_press_release`
+ * - Names are the usual ones for a steno machine: `L` for keys on the left
+ *   side of the keyboard (e.g. `STENO_S1L` is `S1-`), and `R` for keys on
+ *   the right side (e.g. `STENO_SR` is `-S`)
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef LIB__STENO__GEMINI_PR_h
+	#define LIB__STENO__GEMINI_PR_h
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+//      Name                     Keycode   // Key    Byte  Bit
+//      ----------------------   -------      -----  ----  ---
+
+#define STENO_Fn                  0x06     // Fn     0     6
+#define STENO_N1                  0x05     // #1     0     5
+#define STENO_N2                  0x04     // #2     0     4
+#define STENO_N3                  0x03     // #3     0     3
+#define STENO_N4                  0x02     // #4     0     2
+#define STENO_N5                  0x01     // #5     0     1
+#define STENO_N6                  0x00     // #6     0     0
+
+#define STENO_S1L                 0x0E     // S1-    1     6
+#define STENO_S2L                 0x0D     // S2-    1     5
+#define STENO_TL                  0x0C     // T-     1     4
+#define STENO_KL                  0x0B     // K-     1     3
+#define STENO_PL                  0x0A     // P-     1     2
+#define STENO_WL                  0x09     // W-     1     1
+#define STENO_HL                  0x08     // H-     1     0
+
+#define STENO_RL                  0x16     // R-     2     6
+#define STENO_A                   0x15     // A-     2     5
+#define STENO_O                   0x14     // O-     2     4
+#define STENO_ST1                 0x13     // *1     2     3
+#define STENO_ST2                 0x12     // *2     2     2
+#define STENO_RES1                0x11     // res1   2     1
+#define STENO_RES2                0x10     // res2   2     0
+
+#define STENO_PWR                 0x1E     // pwr    3     6
+#define STENO_ST3                 0x1D     // *3     3     5
+#define STENO_ST4                 0x1C     // *4     3     4
+#define STENO_E                   0x1B     // -E     3     3
+#define STENO_U                   0x1A     // -U     3     2
+#define STENO_FR                  0x19     // -F     3     1
+#define STENO_RR                  0x18     // -R     3     0
+
+#define STENO_PR                  0x26     // -P     4     6
+#define STENO_BR                  0x25     // -B     4     5
+#define STENO_LR                  0x24     // -L     4     4
+#define STENO_GR                  0x23     // -G     4     3
+#define STENO_TR                  0x22     // -T     4     2
+#define STENO_SR                  0x21     // -S     4     1
+#define STENO_DR                  0x20     // -D     4     0
+
+#define STENO_N7                  0x2E     // #7     5     6
+#define STENO_N8                  0x2D     // #8     5     5
+#define STENO_N9                  0x2C     // #9     5     4
+#define STENO_NA                  0x2B     // #A     5     3
+#define STENO_NB                  0x2A     // #B     5     2
+#define STENO_NC                  0x29     // #C     5     1
+#define STENO_ZR                  0x28     // -Z     5     0
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif
+
@@ -0,0 +1,91 @@
+/* ----------------------------------------------------------------------------
+ * Very simple Teensy 2.0 millisecond timer : code
+ *
+ * - Timer/Counter0 in CTC mode, interrupting once every millisecond (see
+ *   datasheet section 13)
+ * - The count is 16 bits, so it rolls over about once a minute; take the
+ *   difference of two readings (as a `uint16_t`) to get elapsed time
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_BOARD == teensy-2-0
+// ----------------------------------------------------------------------------
+
+
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include "./teensy-2-0.h"
+
+// ----------------------------------------------------------------------------
+
+#if F_CPU != 16000000
+	#error "Expecting different CPU frequency"
+#endif
+
+static volatile uint16_t timer_ms;
+
+// ----------------------------------------------------------------------------
+
+ISR(TIMER0_COMPA_vect) {
+	timer_ms++;
+}
+
+void timer_init(void) {
+	// CTC mode (TOP = OCR0A), clock/64 : 16MHz / 64 / 250 = 1kHz
+	TCCR0A = (1<<WGM01);
+	TCCR0B = (1<<CS01)|(1<<CS00);
+	OCR0A  = 250-1;
+	// enable the compare match interrupt
+	// - interrupts are enabled globally by `usb_init()`
+	TIMSK0 = (1<<OCIE0A);
+}
+
+uint16_t timer_get_ms(void) {
+	uint16_t ms;
+	uint8_t sreg = SREG;
+	cli();
+	ms = timer_ms;
+	SREG = sreg;
+	return ms;
+}
+
+/*
+ * Sleep (in idle mode) for at least `ms` milliseconds
+ *
+ * Notes:
+ * - `start` is read partway through a tick, so we wait for `ms + 1` ticks:
+ *   `ms` ticks could be as little as `ms - 1` milliseconds
+ * - Any interrupt will wake the processor (the timer, USB start of frame,
+ *   ...).  The condition is checked with interrupts disabled, and `sei` is
+ *   followed immediately by `sleep`, so an interrupt between the check and the
+ *   `sleep` can't be missed.
+ */
+void timer_sleep_ms(uint16_t ms) {
+	uint16_t start = timer_get_ms();
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	for (;;) {
+		cli();
+		if ((uint16_t)(timer_ms - start) > ms)
+			break;
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,22 @@
+/* ----------------------------------------------------------------------------
+ * Very simple Teensy 2.0 millisecond timer : exports
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TIMER_h
+	#define TIMER_h
+
+	#include <stdint.h>
+
+	// --------------------------------------------------------------------
+
+	void     timer_init     (void);
+	uint16_t timer_get_ms   (void);
+	void     timer_sleep_ms (uint16_t ms);
+
+#endif
+
@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * Very simple Teensy 2.0 TWI library : bus recovery, and error counts : code
+ *
+ * Used by both the hardware and the software (bit-banged) versions.
+ *
+ * - If the master stops partway through a byte (e.g. after a glitch on the
+ *   cable, or a reset), a device may be left holding SDA low, waiting for the
+ *   rest of the clock pulses; and nothing else can happen on the bus until it
+ *   lets go.  `twi_recover()` clocks SCL (up to 9 times, by hand) until SDA is
+ *   released, then sends a stop.  See the I2C specification (NXP UM10204),
+ *   section 3.1.16, "Bus clear".
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_BOARD == teensy-2-0
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <util/delay.h>
+#include "./teensy-2-0.h"
+
+// ----------------------------------------------------------------------------
+
+// pins (open drain; the same as in "teensy-2-0--software.c")
+#define  scl_release()  (DDRD &= ~(1<<0))
+#define  scl_low()      (DDRD |=  (1<<0))
+#define  scl_read()     (PIND &   (1<<0))
+#define  sda_release()  (DDRD &= ~(1<<1))
+#define  sda_low()      (DDRD |=  (1<<1))
+#define  sda_read()     (PIND &   (1<<1))
+
+// half of a 100kHz clock period (slow enough for anything on the bus)
+#define  delay_half()  _delay_us(5)
+
+// ----------------------------------------------------------------------------
+
+#if MAKEFILE_DIAGNOSTICS
+uint16_t twi_errors[TWI_ERRORS];
+#endif
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Free the bus, if a device is holding it
+ *
+ * Returns
+ * - `true` if both lines are high (released) afterwards
+ *
+ * Notes
+ * - Takes the pins from the TWI hardware, if it's using them: the hardware
+ *   version takes them back with its next operation
+ * - Takes about 110μs, at most
+ */
+bool twi_recover(void) {
+	// pins as inputs (released), internal pull-ups off, output value low
+	TWCR = 0;
+	DDRD  &= ~( (1<<1)|(1<<0) );
+	PORTD &= ~( (1<<1)|(1<<0) );
+	delay_half();
+
+	// clock until whoever is holding SDA lets go
+	for (uint8_t i=0; i<9 && !sda_read(); i++) {
+		scl_low();
+		delay_half();
+		scl_release();
+		delay_half();
+	}
+
+	// stop : SDA goes high while SCL is high
+	scl_low();
+	sda_low();
+	delay_half();
+	scl_release();
+	delay_half();
+	sda_release();
+	delay_half();
+
+	if (scl_read() && sda_read())
+		return true;
+
+	twi_errors_count(TWI_ERROR_STUCK);
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+
+#if MAKEFILE_DIAGNOSTICS
+/*
+ * Count an error (of class `TWI_ERROR_*`)
+ *
+ * Notes
+ * - Counts saturate instead of rolling over
+ * - The host reads them from the USB interrupt, so they're updated
+ *   atomically
+ */
+void twi_errors_count(uint8_t class) {
+	if (twi_errors[class] != UINT16_MAX)
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { twi_errors[class]++; }
+}
+
+void twi_errors_clear(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i=0; i<TWI_ERRORS; i++)
+			twi_errors[i] = 0;
+	}
+}
+#endif
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
@@ -0,0 +1,245 @@
+/* ----------------------------------------------------------------------------
+ * Very simple Teensy 2.0 TWI library : software (bit-banged) master : code
+ *
+ * - Uses the same pins as the TWI hardware (SCL on D(0), SDA on D(1)), so no
+ *   wiring changes are needed.  The pins are treated as open drain: they're
+ *   left as inputs with the internal pull-ups off (the external pull-ups pull
+ *   the lines high), and set as outputs (driving low) to pull a line low.
+ * - Timing is done by counting cycles, instead of by polling a status
+ *   register after every byte.  This makes Fast-mode Plus (1MHz; which the
+ *   MCP23018 supports) possible on short cables, where the TWI hardware tops
+ *   out at 400kHz (datasheet section 20.1).
+ * - SCL is read back after every release, so slow rise times (and clock
+ *   stretching, if a device ever does it) only slow things down; but only for
+ *   up to `TWI_TIMEOUT`, after which the transaction fails, and the bus is
+ *   recovered (as with the hardware version).
+ * - Selected with `TWI_SOFTWARE` in "src/makefile-options"; the interface (and
+ *   the status codes returned) are the same as for the hardware version.
+ *
+ * Timing notes:
+ * - At 16MHz and 1MHz, a bit is 16 cycles.  Fast-mode Plus needs SCL low for
+ *   at least 0.5μs (8 cycles) and high for at least 0.26μs (~4 cycles), so we
+ *   spend half the bit period in each.
+ * - `OVERHEAD_CYCLES` is a rough count of the cycles spent on the instructions
+ *   around each half period delay (pin writes, the SCL read back, loop
+ *   control); if you change the code, you may want to check the bit period on
+ *   a logic analyzer and adjust it.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+// ----------------------------------------------------------------------------
+// conditional compile
+#if MAKEFILE_BOARD == teensy-2-0 && MAKEFILE_TWI_SOFTWARE
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/twi.h>
+#include "./teensy-2-0.h"
+
+// ----------------------------------------------------------------------------
+
+#if TWI_FREQ > 1000000
+	#error "TWI_FREQ should be 1MHz (Fast-mode Plus) or less"
+#endif
+
+#define  OVERHEAD_CYCLES  6
+#define  HALF_CYCLES      ( F_CPU / TWI_FREQ / 2 )
+
+#if HALF_CYCLES > OVERHEAD_CYCLES
+	#define  delay_half()  \
+		__builtin_avr_delay_cycles(HALF_CYCLES - OVERHEAD_CYCLES)
+#else
+	#define  delay_half()
+#endif
+
+// pins (open drain)
+#define  scl_release()  (DDRD &= ~(1<<0))
+#define  scl_low()      (DDRD |=  (1<<0))
+#define  scl_read()     (PIND &   (1<<0))
+#define  sda_release()  (DDRD &= ~(1<<1))
+#define  sda_low()      (DDRD |=  (1<<1))
+#define  sda_read()     (PIND &   (1<<1))
+
+// release SCL, and wait until it's actually high
+// - the wait is out of line, so the usual case (SCL already high) takes no
+//   longer than it used to
+#define  scl_high() do {		\
+		scl_release();		\
+		if (!scl_read())	\
+			scl_wait();	\
+	} while(0)
+
+#define  LOOP_CYCLES    8  // roughly, per iteration of the wait loop
+#define  TIMEOUT_LOOPS  ( (F_CPU / 1000000) * TWI_TIMEOUT / LOOP_CYCLES )
+
+#if TIMEOUT_LOOPS > 0xFFFF
+	#error "TWI_TIMEOUT is too long"
+#endif
+
+// ----------------------------------------------------------------------------
+
+// - `after_start`: whether the next byte sent is an address (so we know which
+//   status code to return, if it's not acknowledged)
+// - `timed_out`: SCL didn't go high in time (the rest of the current byte
+//   doesn't wait for it)
+// - `failed`: a wait timed out, and the bus was recovered; everything up to
+//   the next `twi_start()` fails right away
+static bool after_start;
+static bool timed_out;
+static bool failed;
+
+// ----------------------------------------------------------------------------
+
+static void scl_wait(void) {
+	if (timed_out)
+		return;
+	for (uint16_t i=TIMEOUT_LOOPS; i; i--)
+		if (scl_read())
+			return;
+	timed_out = true;
+}
+
+// give up on the current transaction, and free the bus
+static uint8_t timeout(void) {
+	twi_errors_count(TWI_ERROR_TIMEOUT);
+	twi_recover();  // (which also sends a stop)
+	timed_out = false;
+	failed = true;
+	return TWI_STATUS_TIMEOUT;  // error
+}
+
+// ----------------------------------------------------------------------------
+
+void twi_init(void) {
+	// make sure the TWI hardware isn't using the pins
+	TWCR = 0;
+	// pins as inputs (released), internal pull-ups off, output value low (for
+	// when we set them as outputs)
+	DDRD  &= ~( (1<<1)|(1<<0) );
+	PORTD &= ~( (1<<1)|(1<<0) );
+}
+
+uint8_t twi_start(void) {
+	failed = false;
+	// (for a repeated start, SCL is low here, and SDA may be low)
+	sda_release();
+	delay_half();
+	scl_high();
+	delay_half();
+	// if a device is still holding SDA low (or SCL didn't go high), the bus
+	// isn't ours to take
+	if (timed_out || !sda_read())
+		return timeout();
+	// start : SDA goes low while SCL is high
+	sda_low();
+	delay_half();
+	scl_low();
+
+	after_start = true;
+	return 0;  // success
+}
+
+void twi_stop(void) {
+	// (a recovery already sent one)
+	if (failed)
+		return;
+	sda_low();
+	delay_half();
+	scl_high();
+	delay_half();
+	// stop : SDA goes high while SCL is high
+	sda_release();
+	delay_half();
+	if (timed_out)
+		timeout();
+}
+
+uint8_t twi_send(uint8_t data) {
+	bool is_address = after_start;
+	bool ack;
+
+	if (failed)
+		return TWI_STATUS_TIMEOUT;  // error
+
+	after_start = false;
+
+	// send data, most significant bit first
+	for (uint8_t mask=0x80; mask; mask>>=1) {
+		if (data & mask)
+			sda_release();
+		else
+			sda_low();
+		delay_half();
+		scl_high();
+		delay_half();
+		scl_low();
+	}
+
+	// read ACK (the device pulls SDA low)
+	sda_release();
+	delay_half();
+	scl_high();
+	delay_half();
+	ack = !sda_read();
+	scl_low();
+
+	if (timed_out)
+		return timeout();
+
+	// if it didn't work, return the status code the hardware would have (else
+	// return 0)
+	if (!ack) {
+		twi_errors_count(TWI_ERROR_NACK);
+		if (!is_address)
+			return TW_MT_DATA_NACK;  // error
+		if (data & TW_READ)
+			return TW_MR_SLA_NACK;   // error
+		return TW_MT_SLA_NACK;           // error
+	}
+	return 0;  // success
+}
+
+uint8_t twi_read(uint8_t * data) {
+	uint8_t byte = 0;
+
+	if (failed)
+		return TWI_STATUS_TIMEOUT;  // error
+
+	// read 1 byte, most significant bit first
+	sda_release();
+	for (uint8_t i=0; i<8; i++) {
+		delay_half();
+		scl_high();
+		delay_half();
+		byte = (byte<<1) | (sda_read() ? 1 : 0);
+		scl_low();
+	}
+
+	// send ACK (the same as the hardware version does)
+	sda_low();
+	delay_half();
+	scl_high();
+	delay_half();
+	scl_low();
+	sda_release();
+
+	if (timed_out)
+		return timeout();
+
+	// set data variable
+	*data = byte;
+	return 0;  // success
+}
+
+
+// ----------------------------------------------------------------------------
+#endif
+// ----------------------------------------------------------------------------
+
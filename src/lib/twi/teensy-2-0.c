@@ -14,6 +14,9 @@
  *   (https://github.com/arduino/Arduino/tree/master/libraries/Wire/utility)
  *   - look for an older version if you need one that doesn't depend on all the
  *     other Arduino stuff
+ *
+ * Every wait for the hardware is bounded (by `TWI_TIMEOUT`, counted in loop
+ * iterations), so a glitch on the bus can't hang the keyboard.
  * ----------------------------------------------------------------------------
  * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
  * Released under The MIT License (MIT) (see "license.md")
@@ -23,15 +26,66 @@
 
 // ----------------------------------------------------------------------------
 // conditional compile
-#if MAKEFILE_BOARD == teensy-2-0
+#if MAKEFILE_BOARD == teensy-2-0 && !MAKEFILE_TWI_SOFTWARE
 // ----------------------------------------------------------------------------
 
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <util/twi.h>
 #include "./teensy-2-0.h"
 
 // ----------------------------------------------------------------------------
 
+#define  LOOP_CYCLES    8  // roughly, per iteration of a wait loop
+#define  TIMEOUT_LOOPS  ( (F_CPU / 1000000) * TWI_TIMEOUT / LOOP_CYCLES )
+
+#if TIMEOUT_LOOPS > 0xFFFF
+	#error "TWI_TIMEOUT is too long"
+#endif
+
+// ----------------------------------------------------------------------------
+
+// - `failed`: a wait timed out, and the bus was recovered; everything up to
+//   the next `twi_start()` fails right away
+static bool failed;
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Wait for the current operation to finish (TWINT to be set)
+ *
+ * Returns
+ * - `true` if it timed out
+ */
+static bool wait(void) {
+	for (uint16_t i=TIMEOUT_LOOPS; i; i--)
+		if (TWCR & (1<<TWINT))
+			return false;
+	return true;
+}
+
+// give up on the current transaction, and free the bus
+static uint8_t timeout(void) {
+	twi_errors_count(TWI_ERROR_TIMEOUT);
+	twi_recover();  // (which also sends a stop)
+	failed = true;
+	return TWI_STATUS_TIMEOUT;  // error
+}
+
+// count an unexpected status code, and return it
+static uint8_t error(uint8_t status) {
+	if ( status == TW_MT_SLA_NACK  ||
+	     status == TW_MT_DATA_NACK ||
+	     status == TW_MR_SLA_NACK )
+		twi_errors_count(TWI_ERROR_NACK);
+	else
+		twi_errors_count(TWI_ERROR_STATUS);
+	return status;  // error
+}
+
+// ----------------------------------------------------------------------------
+
 void twi_init(void) {
 	// set the prescaler value to 0
 	TWSR &= ~( (1<<TWPS1)|(1<<TWPS0) );
@@ -42,49 +96,63 @@ void twi_init(void) {
 }
 
 uint8_t twi_start(void) {
+	failed = false;
 	// send start
 	TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWSTA);
 	// wait for transmission to complete
-	while (!(TWCR & (1<<TWINT)));
+	if (wait())
+		return timeout();
 	// if it didn't work, return the status code (else return 0)
 	if ( (TW_STATUS != TW_START) &&
 	     (TW_STATUS != TW_REP_START) )
-		return TW_STATUS;  // error
+		return error(TW_STATUS);  // error
 	return 0;  // success
 }
 
 void twi_stop(void) {
+	// (a recovery already sent one)
+	if (failed)
+		return;
 	// send stop
 	TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWSTO);
 	// wait for transmission to complete
-	while (TWCR & (1<<TWSTO));
+	for (uint16_t i=TIMEOUT_LOOPS; i; i--)
+		if (!(TWCR & (1<<TWSTO)))
+			return;
+	timeout();
 }
 
 uint8_t twi_send(uint8_t data) {
+	if (failed)
+		return TWI_STATUS_TIMEOUT;  // error
 	// load data into the data register
 	TWDR = data;
 	// send data
 	TWCR = (1<<TWINT)|(1<<TWEN);
 	// wait for transmission to complete
-	while (!(TWCR & (1<<TWINT)));
+	if (wait())
+		return timeout();
 	// if it didn't work, return the status code (else return 0)
 	if ( (TW_STATUS != TW_MT_SLA_ACK)  &&
 	     (TW_STATUS != TW_MT_DATA_ACK) &&
 	     (TW_STATUS != TW_MR_SLA_ACK) )
-		return TW_STATUS;  // error
+		return error(TW_STATUS);  // error
 	return 0;  // success
 }
 
 uint8_t twi_read(uint8_t * data) {
+	if (failed)
+		return TWI_STATUS_TIMEOUT;  // error
 	// read 1 byte to TWDR, send ACK
 	TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWEA);
 	// wait for transmission to complete
-	while (!(TWCR & (1<<TWINT)));
+	if (wait())
+		return timeout();
 	// set data variable
 	*data = TWDR;
 	// if it didn't work, return the status code (else return 0)
 	if (TW_STATUS != TW_MR_DATA_ACK)
-		return TW_STATUS;  // error
+		return error(TW_STATUS);  // error
 	return 0;  // success
 }
 
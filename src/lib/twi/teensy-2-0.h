@@ -10,19 +10,58 @@
 #ifndef TWI_h
 	#define TWI_h
 
+	#include <stdbool.h>
+	#include <stdint.h>
+
 	// --------------------------------------------------------------------
 
 	#ifndef TWI_FREQ
 		#define TWI_FREQ 100000  // in Hz
 	#endif
 
+	/*
+	 * TWI_TIMEOUT
+	 * - How long (in μs) to wait for the bus before giving up on a
+	 *   transaction (a byte takes 22.5μs at 400kHz, and 90μs at 100kHz).
+	 *   The bus is then recovered (see "teensy-2-0--errors.c"), and
+	 *   `TWI_STATUS_TIMEOUT` is returned, right away, for everything up
+	 *   to the next `twi_start()`.
+	 */
+	#ifndef TWI_TIMEOUT
+		#define TWI_TIMEOUT 250  // in μs
+	#endif
+
+	// status code, besides the ones in <util/twi.h> (which all have the
+	// low 3 bits clear)
+	#define  TWI_STATUS_TIMEOUT  0x01
+
+	// error classes (for `twi_errors`; see "teensy-2-0.md")
+	#define  TWI_ERROR_NACK     0  // not acknowledged
+	#define  TWI_ERROR_STATUS   1  // any other unexpected status
+	#define  TWI_ERROR_TIMEOUT  2  // a wait timed out
+	#define  TWI_ERROR_STUCK    3  // the bus was still stuck after recovery
+	#define  TWI_ERRORS         4
+
 	// --------------------------------------------------------------------
 
-	void    twi_init  (void);
-	uint8_t twi_start (void);
-	void    twi_stop  (void);
-	uint8_t twi_send  (uint8_t data);
-	uint8_t twi_read  (uint8_t * data);
+	void    twi_init    (void);
+	uint8_t twi_start   (void);
+	void    twi_stop    (void);
+	uint8_t twi_send    (uint8_t data);
+	uint8_t twi_read    (uint8_t * data);
+	bool    twi_recover (void);
+
+	// error counts (read by "lib/diagnostics"; if it's not compiled in,
+	// nothing is counted)
+	#if MAKEFILE_DIAGNOSTICS
+		extern uint16_t twi_errors[TWI_ERRORS];
+
+		void twi_errors_count (uint8_t class);
+		void twi_errors_clear (void);
+	#else
+		#define  twi_errors_count(class)
+		#define  twi_errors_clear()
+	#endif
 
 #endif
 
@@ -50,4 +50,7 @@
 //     not sure if it can be used with keyboards.  if so though, i'll have to
 //     look on the unicode website, or elsewhere, coz this .pdf doesn't list
 //     anything about them out, it just references the unicode spec.
+//   - hosts don't seem to do anything with the unicode usage page from a
+//     keyboard, so characters are typed with the hosts' own input methods
+//     instead (see "src/lib/key-functions/unicode.h")
 
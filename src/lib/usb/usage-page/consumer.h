@@ -0,0 +1,110 @@
+/* ----------------------------------------------------------------------------
+ * USB Consumer Codes (usage page 0x0C)
+ *
+ * Taken from [the HID Usage Tables pdf][1], Section 15,
+ * which can be found on [the HID Page][2] at <http://www.usb.org>
+ *
+ * - Consumer usages are 16 bits (the consumer report covers 0x001..0x29C),
+ *   but layout matrices only hold 8 bits per key.  So the names here are the
+ *   low byte of the usage, and the key function used with them supplies the
+ *   high byte:
+ *   - 0x00xx : `kbfun_consumer_press_release`
+ *   - 0x01xx : `kbfun_consumer_1_press_release`
+ *   - 0x02xx : `kbfun_consumer_2_press_release`
+ * - Any usage in the range can be sent, whether or not it's named here; these
+ *   are just the ones most likely to be useful on a keyboard
+ *
+ * - `AL_` indicates an Application Launch button
+ * - `AC_` indicates an Application Control
+ *
+ * - applicable Usage Types (from Section 3.4)
+ *   - OOC : On/Off Control
+ *   - OSC : One Shot Control
+ *   - RTC : Re-trigger Control
+ *   - Sel : Selector
+ *
+ * [1]: http://www.usb.org/developers/devclass_docs/Hut1_12v2.pdf
+ * [2]: http://www.usb.org/developers/hidpage
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef USB_USAGE_PAGE_CONSUMER_h
+	#define USB_USAGE_PAGE_CONSUMER_h
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+//      Name                                  Usage     Usage Type  Section
+//      ------------------------------ ----   ------    ----------  -------
+
+// --- 0x00xx (use with `kbfun_consumer_press_release`) ----------------------
+
+#define CONSUMER_Power                 0x30  // 0x0030  OOC         15.5
+#define CONSUMER_Reset                 0x31  // 0x0031  OSC         15.5
+#define CONSUMER_Sleep                 0x32  // 0x0032  OSC         15.5
+#define CONSUMER_Menu                  0x40  // 0x0040  OOC         15.6
+#define CONSUMER_BrightnessIncrement   0x6F  // 0x006F  RTC         -
+#define CONSUMER_BrightnessDecrement   0x70  // 0x0070  RTC         -
+#define CONSUMER_Play                  0xB0  // 0x00B0  OOC         15.7
+#define CONSUMER_Pause                 0xB1  // 0x00B1  OOC         15.7
+#define CONSUMER_Record                0xB2  // 0x00B2  OOC         15.7
+#define CONSUMER_FastForward           0xB3  // 0x00B3  OOC         15.7
+#define CONSUMER_Rewind                0xB4  // 0x00B4  OOC         15.7
+#define CONSUMER_ScanNextTrack         0xB5  // 0x00B5  OSC         15.7
+#define CONSUMER_ScanPreviousTrack     0xB6  // 0x00B6  OSC         15.7
+#define CONSUMER_Stop                  0xB7  // 0x00B7  OSC         15.7
+#define CONSUMER_Eject                 0xB8  // 0x00B8  OSC         15.7
+#define CONSUMER_PlayPause             0xCD  // 0x00CD  OSC         15.7
+#define CONSUMER_Mute                  0xE2  // 0x00E2  OOC         15.9.1
+#define CONSUMER_VolumeIncrement       0xE9  // 0x00E9  RTC         15.9.1
+#define CONSUMER_VolumeDecrement       0xEA  // 0x00EA  RTC         15.9.1
+
+// --- 0x01xx (use with `kbfun_consumer_1_press_release`) --------------------
+
+#define CONSUMER_AL_ControlConfig      0x83  // 0x0183  Sel         15.15
+#define CONSUMER_AL_WordProcessor      0x84  // 0x0184  Sel         15.15
+#define CONSUMER_AL_Spreadsheet        0x86  // 0x0186  Sel         15.15
+#define CONSUMER_AL_Email              0x8A  // 0x018A  Sel         15.15
+#define CONSUMER_AL_Calendar           0x8E  // 0x018E  Sel         15.15
+#define CONSUMER_AL_Calculator         0x92  // 0x0192  Sel         15.15
+#define CONSUMER_AL_LocalBrowser       0x94  // 0x0194  Sel         15.15
+#define CONSUMER_AL_InternetBrowser    0x96  // 0x0196  Sel         15.15
+#define CONSUMER_AL_Lock               0x9E  // 0x019E  Sel         15.15
+#define CONSUMER_AL_ControlPanel       0x9F  // 0x019F  Sel         15.15
+#define CONSUMER_AL_Help               0xA6  // 0x01A6  Sel         15.15
+#define CONSUMER_AL_Documents          0xA7  // 0x01A7  Sel         15.15
+
+// --- 0x02xx (use with `kbfun_consumer_2_press_release`) --------------------
+
+#define CONSUMER_AC_New                0x01  // 0x0201  Sel         15.16
+#define CONSUMER_AC_Open               0x02  // 0x0202  Sel         15.16
+#define CONSUMER_AC_Close              0x03  // 0x0203  Sel         15.16
+#define CONSUMER_AC_Exit               0x04  // 0x0204  Sel         15.16
+#define CONSUMER_AC_Minimize           0x06  // 0x0206  Sel         15.16
+#define CONSUMER_AC_Save               0x07  // 0x0207  Sel         15.16
+#define CONSUMER_AC_Print              0x08  // 0x0208  Sel         15.16
+#define CONSUMER_AC_Undo               0x1A  // 0x021A  Sel         15.16
+#define CONSUMER_AC_Copy               0x1B  // 0x021B  Sel         15.16
+#define CONSUMER_AC_Cut                0x1C  // 0x021C  Sel         15.16
+#define CONSUMER_AC_Paste              0x1D  // 0x021D  Sel         15.16
+#define CONSUMER_AC_Find               0x1F  // 0x021F  Sel         15.16
+#define CONSUMER_AC_Search             0x21  // 0x0221  Sel         15.16
+#define CONSUMER_AC_Home               0x23  // 0x0223  Sel         15.16
+#define CONSUMER_AC_Back               0x24  // 0x0224  Sel         15.16
+#define CONSUMER_AC_Forward            0x25  // 0x0225  Sel         15.16
+#define CONSUMER_AC_Stop               0x26  // 0x0226  Sel         15.16
+#define CONSUMER_AC_Refresh            0x27  // 0x0227  Sel         15.16
+#define CONSUMER_AC_Bookmarks          0x2A  // 0x022A  Sel         15.16
+#define CONSUMER_AC_ZoomIn             0x2D  // 0x022D  Sel         15.16
+#define CONSUMER_AC_ZoomOut            0x2E  // 0x022E  Sel         15.16
+#define CONSUMER_AC_Redo               0x79  // 0x0279  Sel         15.16
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif
+
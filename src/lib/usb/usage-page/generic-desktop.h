@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * USB Generic Desktop Codes (usage page 0x01) : System Controls
+ *
+ * Taken from [the HID Usage Tables pdf][1], Section 4.5,
+ * which can be found on [the HID Page][2] at <http://www.usb.org>
+ *
+ * - Only the System Control usages (the ones a keyboard sends, in the system
+ *   control report) are listed here
+ * - Use with `kbfun_system_press_release`
+ *
+ * - applicable Usage Types (from Section 3.4)
+ *   - OOC : On/Off Control
+ *   - OSC : One Shot Control
+ *
+ * [1]: http://www.usb.org/developers/devclass_docs/Hut1_12v2.pdf
+ * [2]: http://www.usb.org/developers/hidpage
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef USB_USAGE_PAGE_GENERIC_DESKTOP_h
+	#define USB_USAGE_PAGE_GENERIC_DESKTOP_h
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+//      Name                              ID    // Usage Type  Section
+//      ------------------------------    ----     ----------  -------
+
+#define SYSTEM_PowerDown                  0x81  // OSC         4.5
+#define SYSTEM_Sleep                      0x82  // OSC         4.5
+#define SYSTEM_WakeUp                     0x83  // OSC         4.5
+#define SYSTEM_ContextMenu                0x84  // OSC         4.5
+#define SYSTEM_MainMenu                   0x85  // OSC         4.5
+#define SYSTEM_AppMenu                    0x86  // OSC         4.5
+#define SYSTEM_MenuHelp                   0x87  // OSC         4.5
+#define SYSTEM_MenuExit                   0x88  // OSC         4.5
+#define SYSTEM_MenuSelect                 0x89  // OSC         4.5
+#define SYSTEM_MenuRight                  0x8A  // OSC         4.5
+#define SYSTEM_MenuLeft                   0x8B  // OSC         4.5
+#define SYSTEM_MenuUp                     0x8C  // OSC         4.5
+#define SYSTEM_MenuDown                   0x8D  // OSC         4.5
+#define SYSTEM_ColdRestart                0x8E  // OSC         4.5
+#define SYSTEM_WarmRestart                0x8F  // OSC         4.5
+
+//      (Reserved)                  0x90..0x9F  // -           -
+
+#define SYSTEM_Dock                       0xA0  // OSC         4.5.1
+#define SYSTEM_Undock                     0xA1  // OSC         4.5.1
+#define SYSTEM_Setup                      0xA2  // OSC         4.5.1
+#define SYSTEM_Break                      0xA3  // OSC         4.9
+#define SYSTEM_DebuggerBreak              0xA4  // OSC         4.9
+#define SYSTEM_ApplicationBreak           0xA5  // OSC         4.9
+#define SYSTEM_ApplicationDebuggerBreak   0xA6  // OSC         4.9
+#define SYSTEM_SpeakerMute                0xA7  // OSC         4.5.1
+#define SYSTEM_Hibernate                  0xA8  // OSC         4.5.1
+
+//      (Reserved)                  0xA9..0xAF  // -           -
+
+#define SYSTEM_DisplayInvert              0xB0  // OSC         4.10
+#define SYSTEM_DisplayInternal            0xB1  // OSC         4.10
+#define SYSTEM_DisplayExternal            0xB2  // OSC         4.10
+#define SYSTEM_DisplayBoth                0xB3  // OSC         4.10
+#define SYSTEM_DisplayDual                0xB4  // OSC         4.10
+#define SYSTEM_DisplayToggleIntExt        0xB5  // OSC         4.10
+#define SYSTEM_DisplaySwapPrimarySecondary 0xB6 // OSC         4.10
+#define SYSTEM_DisplayLCDAutoscale        0xB7  // OSC         4.10
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif
+
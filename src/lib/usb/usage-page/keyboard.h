@@ -268,15 +268,16 @@
 
 //     (Reserved)           0xE8..0xFFFF  // -  -   -     -
 
-// Media key codes are not real scan codes, they must be translated to a 16
-//  bit number by the consumer key key function
-#define MEDIAKEY_PLAY_PAUSE     0x00
-#define MEDIAKEY_STOP           0x01
-#define MEDIAKEY_PREV_TRACK     0x02
-#define MEDIAKEY_NEXT_TRACK     0x03
-#define MEDIAKEY_AUDIO_MUTE     0x04
-#define MEDIAKEY_AUDIO_VOL_UP   0x05
-#define MEDIAKEY_AUDIO_VOL_DOWN 0x06
+// Media key codes are not keyboard usages: they're the low byte of consumer
+//  usages (usage page 0x0C, see "consumer.h"), for use with the media key (or
+//  the 0x00xx consumer key) key function
+#define MEDIAKEY_PLAY_PAUSE     0xCD
+#define MEDIAKEY_STOP           0xB7
+#define MEDIAKEY_PREV_TRACK     0xB6
+#define MEDIAKEY_NEXT_TRACK     0xB5
+#define MEDIAKEY_AUDIO_MUTE     0xE2
+#define MEDIAKEY_AUDIO_VOL_UP   0xE9
+#define MEDIAKEY_AUDIO_VOL_DOWN 0xEA
 
 
 // ----------------------------------------------------------------------------
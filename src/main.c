@@ -13,6 +13,14 @@
 #include <util/delay.h>
 #include "./lib-other/pjrc/usb_keyboard/usb_keyboard.h"
 #include "./lib/key-functions/public.h"
+#include "./lib/key-functions/combo.h"
+#include "./lib/key-functions/autoshift.h"
+#include "./lib/key-functions/leader.h"
+#include "./lib/key-functions/numpad.h"
+#include "./lib/key-functions/unicode.h"
+#include "./lib/diagnostics/public.h"
+#include "./lib/bench/public.h"
+#include "./lib/timer.h"
 #include "./keyboard/controller.h"
 #include "./keyboard/layout.h"
 #include "./keyboard/matrix.h"
@@ -30,21 +38,43 @@ bool (*main_kb_is_pressed)[KB_ROWS][KB_COLUMNS] = &_main_kb_is_pressed;
 static bool _main_kb_was_pressed[KB_ROWS][KB_COLUMNS];
 bool (*main_kb_was_pressed)[KB_ROWS][KB_COLUMNS] = &_main_kb_was_pressed;
 
-static bool main_kb_was_transparent[KB_ROWS][KB_COLUMNS];
+uint8_t main_key_state[KB_ROWS][KB_COLUMNS];
 
-uint8_t main_layers_pressed[KB_ROWS][KB_COLUMNS];
+bool main_any_non_trans_key_pressed;
 
-uint8_t main_loop_row;
-uint8_t main_loop_col;
+// ----------------------------------------------------------------------------
 
-uint8_t main_arg_layer;
-uint8_t main_arg_layer_offset;
-uint8_t main_arg_row;
-uint8_t main_arg_col;
-bool    main_arg_is_pressed;
-bool    main_arg_was_pressed;
-bool    main_arg_any_non_trans_key_pressed;
-bool    main_arg_trans_key_pressed;
+/*
+ * Handle a key event from the matrix
+ *
+ * Combos get the first look at every key event, and may hold it back, or
+ * replace it
+ */
+static void key_event(uint8_t row, uint8_t col, bool is_pressed) {
+	if (!combo_key_event(row, col, is_pressed)) {
+		bench_event_start();
+		main_key_event(row, col, is_pressed);
+		bench_event_end();
+	}
+}
+
+/*
+ * Handle the key events kept while unicode characters were being sent
+ *
+ * Note
+ * - A report is sent after each press (unless the characters aren't done), so
+ *   a key that was tapped while they were being sent isn't lost
+ */
+static void replay_key_events(void) {
+	uint8_t row, col;
+	bool is_pressed;
+
+	while (unicode_replay(&row, &col, &is_pressed)) {
+		key_event(row, col, is_pressed);
+		if (is_pressed && !unicode_is_sending())
+			usb_keyboard_send();
+	}
+}
 
 // ----------------------------------------------------------------------------
 
@@ -52,7 +82,11 @@ bool    main_arg_trans_key_pressed;
  * main()
  */
 int main(void) {
+#if MAKEFILE_BENCH
+	bench_init();  // (instead of the controller and USB; see "lib/bench")
+#else
 	kb_init();  // does controller initialization too
+	kb_layouts_init();  // (the active layout, if there are several)
 
 	kb_led_state_power_on();
 
@@ -61,64 +95,70 @@ int main(void) {
 	kb_led_delay_usb_init();  // give the OS time to load drivers, etc.
 
 	kb_led_state_ready();
+#endif
 
 	for (;;) {
+		bench_scan_start();
+
 		// swap `main_kb_is_pressed` and `main_kb_was_pressed`, then update
 		bool (*temp)[KB_ROWS][KB_COLUMNS] = main_kb_was_pressed;
 		main_kb_was_pressed = main_kb_is_pressed;
 		main_kb_is_pressed = temp;
 
+#if MAKEFILE_BENCH
+		bench_update_matrix(*main_kb_is_pressed);
+#else
 		kb_update_matrix(*main_kb_is_pressed);
+#endif
+		// collect per key statistics, then mask keys whose readings can't be
+		// trusted (ghosting, etc.)
+		diag_stats_update(*main_kb_is_pressed);
+		diag_matrix_check(*main_kb_is_pressed, *main_kb_was_pressed);
+
+		// (key events from while unicode characters were being sent go
+		// first, now that they're done)
+		replay_key_events();
 
 		// this loop is responsible to
-		// - "execute" keys when they change state
-		// - keep track of which layers the keys were on when they were pressed
-		//   (so they can be released using the function from that layer)
+		// - "execute" keys when they change state (see `main_key_event()`)
 		//
 		// note
 		// - everything else is the key function's responsibility
 		//   - see the keyboard layout file ("keyboard/ergodox/layout/*.c") for
 		//     which key is assigned which function (per layer)
 		//   - see "lib/key-functions/public/*.c" for the function definitions
-		#define row          main_loop_row
-		#define col          main_loop_col
-		#define layer        main_arg_layer
-		#define is_pressed   main_arg_is_pressed
-		#define was_pressed  main_arg_was_pressed
-		for (row=0; row<KB_ROWS; row++) {
-			for (col=0; col<KB_COLUMNS; col++) {
-				is_pressed = (*main_kb_is_pressed)[row][col];
-				was_pressed = (*main_kb_was_pressed)[row][col];
-
-				if (is_pressed != was_pressed) {
-					if (is_pressed) {
-						layer = main_layers_peek(0);
-						main_layers_pressed[row][col] = layer;
-						main_arg_trans_key_pressed = false;
-					} else {
-						layer = main_layers_pressed[row][col];
-						main_arg_trans_key_pressed = main_kb_was_transparent[row][col];
-					}
-
-					// set remaining vars, and "execute" key
-					main_arg_row          = row;
-					main_arg_col          = col;
-					main_arg_layer_offset = 0;
-					main_exec_key();
-					main_kb_was_transparent[row][col] = main_arg_trans_key_pressed;
-				}
+		for (uint8_t row=0; row<KB_ROWS; row++) {
+			for (uint8_t col=0; col<KB_COLUMNS; col++) {
+				bool is_pressed = (*main_kb_is_pressed)[row][col];
+
+				if (is_pressed == (*main_kb_was_pressed)[row][col])
+					continue;
+
+				// (while unicode characters are being sent, key events
+				// are kept until they're done)
+				if (unicode_key_event(row, col, is_pressed))
+					continue;
+				replay_key_events();  // (if there wasn't room to keep it)
+
+				key_event(row, col, is_pressed);
 			}
 		}
-		#undef row
-		#undef col
-		#undef layer
-		#undef is_pressed
-		#undef was_pressed
+		combo_update();
+		autoshift_update();
+		leader_update();
+		numpad_update();
 
 		// send the USB report (even if nothing's changed)
-		usb_keyboard_send();
-		usb_extra_consumer_send();
-		_delay_ms(MAKEFILE_DEBOUNCE_TIME);
+		// (while unicode characters are being typed, they have the keyboard
+		// report to themselves)
+		if (!unicode_update())
+			usb_keyboard_send();
+		usb_extra_send_changes();
+
+		bench_scan_end();
+
+		// sleep (instead of busy waiting) until it's time to scan again
+		timer_sleep_ms(MAKEFILE_DEBOUNCE_TIME);
 
 		// update LEDs
 		if (keyboard_leds & (1<<0)) { kb_led_num_on(); }
@@ -138,15 +178,6 @@ int main(void) {
 
 // ----------------------------------------------------------------------------
 
-// convenience macros (for the helper functions below)
-#define  layer        main_arg_layer
-#define  row          main_arg_row
-#define  col          main_arg_col
-#define  is_pressed   main_arg_is_pressed
-#define  was_pressed  main_arg_was_pressed
-
-// ----------------------------------------------------------------------------
-
 /* ----------------------------------------------------------------------------
  * Layer Functions
  * ----------------------------------------------------------------------------
@@ -171,23 +202,108 @@ struct layers layers[MAX_ACTIVE_LAYERS];
 uint8_t       layers_head = 0;
 uint8_t       layers_ids_in_use[MAX_ACTIVE_LAYERS] = {true};
 
+/*
+ * Key event
+ * - "Execute" a key press or release, keeping track of which layers keys were
+ *   on when they were pressed (so they can be released using the function
+ *   from that layer)
+ * - The release of a key that isn't pressed (because it was released early,
+ *   or never pressed here) is ignored
+ */
+void main_key_event(uint8_t row, uint8_t col, bool is_pressed) {
+	struct key_event event = {
+		.row        = row,
+		.col        = col,
+		.is_pressed = is_pressed,
+	};
+
+	if (is_pressed) {
+		event.layer = main_layers_peek(0);
+		main_layers_pressed_set(row, col, event.layer);
+		main_key_pressed_set(row, col, true);
+	} else {
+		if (!main_key_pressed_get(row, col))
+			return;
+		main_key_pressed_set(row, col, false);
+		event.layer = main_layers_pressed_get(row, col);
+		event.trans_key_pressed = main_kb_was_transparent_get(row, col);
+	}
+
+	main_exec_key(&event);
+	main_kb_was_transparent_set(row, col, event.trans_key_pressed);
+}
+
 /*
  * Exec key
  * - Execute the keypress or keyrelease function (if it exists) of the key at
  *   the current possition.
+ *
+ * Notes
+ * - Transparent keys are resolved here, in a loop (doing what
+ *   `kbfun_transparent()` would, for each one), so that only the first
+ *   non-transparent function is called: the stack doesn't grow with the
+ *   number of layers a key is transparent on
+ * - A key that's transparent all the way down the stack (including on layer
+ *   0) does nothing
+ * - With `MAKEFILE_DISPATCH`, keys are looked up as action numbers, and run
+ *   by the layout's generated dispatcher (see
+ *   "keyboard/ergodox/layout/default--matrix-control.h")
  */
-void main_exec_key(void) {
-	void (*key_function)(void) =
-		( (is_pressed)
-		  ? kb_layout_press_get(layer, row, col)
-		  : kb_layout_release_get(layer, row, col) );
+void main_exec_key(struct key_event * event) {
+#if MAKEFILE_DISPATCH
+	uint8_t action;
+
+	for (;;) {
+		action = ( (event->is_pressed)
+		           ? kb_dispatch_press_get( event->layer,
+		                                    event->row, event->col )
+		           : kb_dispatch_release_get( event->layer,
+		                                      event->row, event->col ) );
+
+		if (action != KB_DISPATCH_TRANSPARENT)
+			break;
+
+		// (already at the bottom of the stack)
+		if (event->layer_offset >= layers_head) {
+			action = KB_DISPATCH_NONE;
+			break;
+		}
+#else
+	kbfun_funptr_t key_function;
+
+	for (;;) {
+		key_function = ( (event->is_pressed)
+		                 ? kb_layout_press_get( event->layer,
+		                                        event->row, event->col )
+		                 : kb_layout_release_get( event->layer,
+		                                          event->row, event->col ) );
+
+		if (key_function != &kbfun_transparent)
+			break;
+
+		// (already at the bottom of the stack)
+		if (event->layer_offset >= layers_head) {
+			key_function = 0;
+			break;
+		}
+#endif
+
+		event->trans_key_pressed = true;
+		event->layer_offset++;
+		event->layer = main_layers_peek(event->layer_offset);
+		main_layers_pressed_set(event->row, event->col, event->layer);
+	}
 
+#if MAKEFILE_DISPATCH
+	kb_dispatch_exec(action, event);
+#else
 	if (key_function)
-		(*key_function)();
+		(*key_function)(event);
+#endif
 
 	// If the current layer is in the sticky once up state and a key defined
 	//  for this layer (a non-transparent key) was pressed, pop the layer
-	if (layers[layers_head].sticky == eStickyOnceUp && main_arg_any_non_trans_key_pressed)
+	if (layers[layers_head].sticky == eStickyOnceUp && main_any_non_trans_key_pressed)
 		main_layers_pop_id(layers_head);
 }
 
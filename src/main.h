@@ -27,23 +27,88 @@
 	extern bool (*main_kb_is_pressed)[KB_ROWS][KB_COLUMNS];
 	extern bool (*main_kb_was_pressed)[KB_ROWS][KB_COLUMNS];
 
-	extern uint8_t main_layers_pressed[KB_ROWS][KB_COLUMNS];
+	/*
+	 * A key event: what key functions are given (a pointer to), instead of
+	 * reading globals, when their key is pressed or released
+	 *
+	 * - `layer`: the layer the key's function is from
+	 * - `layer_offset`: how far down the layer stack `layer` was found
+	 *   (more than 0 if the key was transparent on the layers above)
+	 * - `row`, `col`: the key's position
+	 * - `is_pressed`: whether the key was pressed (or released)
+	 * - `trans_key_pressed`: whether the key was transparent on any of the
+	 *   layers above `layer`
+	 *
+	 * Key functions may change `layer` and `layer_offset`, and call
+	 * `main_exec_key()` with the same event again (as `kbfun_transparent()`
+	 * does).
+	 */
+	struct key_event {
+		uint8_t layer;
+		uint8_t layer_offset;
+		uint8_t row;
+		uint8_t col;
+		bool    is_pressed;
+		bool    trans_key_pressed;
+	};
 
-	extern uint8_t main_loop_row;
-	extern uint8_t main_loop_col;
+	typedef void (*kbfun_funptr_t)(struct key_event * event);
 
-	extern uint8_t main_arg_layer;
-	extern uint8_t main_arg_layer_offset;
-	extern uint8_t main_arg_row;
-	extern uint8_t main_arg_col;
-	extern bool    main_arg_is_pressed;
-	extern bool    main_arg_was_pressed;
-	extern bool    main_arg_any_non_trans_key_pressed;
-	extern bool    main_arg_trans_key_pressed;
+	// --------------------------------------------------------------------
+
+	/*
+	 * per key state
+	 *
+	 * For each key, one byte holding
+	 * - the layer it was pressed on (so it can be released with the
+	 *   function from that layer): the low 5 bits (layers go up to 31)
+	 * - whether it was resolved through a transparent key: the high bit
+	 * - whether it's pressed (as far as `main_key_event()` knows): the bit
+	 *   below that.  Releases of keys that aren't are ignored (e.g. keys
+	 *   released early, when the layout is switched).
+	 *
+	 * (instead of a byte matrix and two bool matrices: 84 bytes of SRAM
+	 * instead of 252).  It should only be accessed with the macros below,
+	 * which don't branch.
+	 */
+	extern uint8_t main_key_state[KB_ROWS][KB_COLUMNS];
+
+	#define  MAIN_KEY_STATE_LAYER        0x1F
+	#define  MAIN_KEY_STATE_PRESSED      0x40
+	#define  MAIN_KEY_STATE_TRANSPARENT  0x80
+
+	#define main_layers_pressed_get(row,col) \
+		( (uint8_t) \
+		  (main_key_state[row][col] & MAIN_KEY_STATE_LAYER) )
+	#define main_layers_pressed_set(row,col,layer) \
+		( main_key_state[row][col] = \
+			(main_key_state[row][col] & ~MAIN_KEY_STATE_LAYER) \
+			| ((layer) & MAIN_KEY_STATE_LAYER) )
+
+	#define main_kb_was_transparent_get(row,col) \
+		( (bool) \
+		  (main_key_state[row][col] & MAIN_KEY_STATE_TRANSPARENT) )
+	#define main_kb_was_transparent_set(row,col,value) \
+		( main_key_state[row][col] = \
+			(main_key_state[row][col] & ~MAIN_KEY_STATE_TRANSPARENT) \
+			| ((uint8_t)(bool)(value) << 7) )
+
+	#define main_key_pressed_get(row,col) \
+		( (bool) \
+		  (main_key_state[row][col] & MAIN_KEY_STATE_PRESSED) )
+	#define main_key_pressed_set(row,col,value) \
+		( main_key_state[row][col] = \
+			(main_key_state[row][col] & ~MAIN_KEY_STATE_PRESSED) \
+			| ((uint8_t)(bool)(value) << 6) )
+
+	// whether a non-transparent key has been pressed since a sticky layer
+	// was pushed (see `kbfun_layer_sticky_1()`)
+	extern bool main_any_non_trans_key_pressed;
 
 	// --------------------------------------------------------------------
 
-	void main_exec_key (void);
+	void main_key_event (uint8_t row, uint8_t col, bool is_pressed);
+	void main_exec_key  (struct key_event * event);
 
 	uint8_t main_layers_peek          (uint8_t offset);
 	uint8_t main_layers_peek_sticky   (uint8_t offset);
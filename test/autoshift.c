@@ -0,0 +1,328 @@
+/* ----------------------------------------------------------------------------
+ * host tests : auto-shift : rollover
+ *
+ * Runs "src/lib/key-functions/autoshift.c" one scan (1ms) at a time, the way
+ * "main.c" does, with random streams of overlapping keys (more than
+ * `AUTOSHIFT_PENDING` at once, auto-shift and not), and checks what the host
+ * sees against the rules in "autoshift.h", worked out here separately: every
+ * key typed exactly once, in the order pressed, shifted if (and only if) it
+ * should be.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../src/lib-other/pjrc/usb_keyboard/usb_keyboard.h"
+#include "../src/lib/usb/usage-page/keyboard.h"
+#include "../src/keyboard/matrix.h"
+#include "../src/lib/timer.h"
+#include "../src/lib/key-functions/private.h"
+#include "../src/lib/key-functions/autoshift.h"
+#include "./test.h"
+
+// ----------------------------------------------------------------------------
+
+#define  TRIALS    2000
+#define  KEYS_MAX    20  // per trial (each with its own keycode)
+
+// ----------------------------------------------------------------------------
+// stand-ins for the rest of the firmware
+// ----------------------------------------------------------------------------
+
+static uint16_t now;  // (ms)
+
+uint16_t timer_get_ms(void) { return now; }
+
+// the keys the firmware has pressed, to be sent with the next report
+static bool down[256];
+static bool shift;
+
+// (like "private.c": presses send pending keys first)
+void _kbfun_press_release(bool press, uint8_t keycode) {
+	if (press)
+		autoshift_flush();
+
+	if (keycode == KEY_LeftShift)
+		shift = press;
+	else
+		down[keycode] = press;
+}
+
+bool _kbfun_is_pressed(uint8_t keycode) {
+	return (keycode == KEY_LeftShift) ? shift : down[keycode];
+}
+
+// what the host has seen: each key, as it first appears in a report
+static struct {
+	bool    reported[256];
+	uint8_t typed[KEYS_MAX];
+	bool    shifted[KEYS_MAX];
+	uint8_t count;
+	uint8_t together;  // reports with more than one new key (order unknown)
+} host;
+
+int8_t usb_keyboard_send(void) {
+	uint8_t new = 0;
+
+	for (uint16_t keycode=0; keycode<256; keycode++) {
+		if (down[keycode] && !host.reported[keycode]) {
+			new++;
+			if (host.count < KEYS_MAX) {
+				host.typed[host.count]   = keycode;
+				host.shifted[host.count] = shift;
+			}
+			host.count++;
+		}
+		host.reported[keycode] = down[keycode];
+	}
+	if (new > 1)
+		host.together++;
+
+	return 0;
+}
+
+// ----------------------------------------------------------------------------
+// what should happen (following "autoshift.h")
+// ----------------------------------------------------------------------------
+
+static struct {
+	uint8_t  pending[KEYS_MAX];  // (oldest first)
+	uint8_t  pending_count;
+	uint16_t since[KEYS_MAX];
+	bool     held_shifted[KEYS_MAX];
+	uint8_t  shifted_count;
+	uint8_t  typed[KEYS_MAX];
+	bool     shifted[KEYS_MAX];
+	uint8_t  count;
+} model;
+
+static void model_send_oldest(bool shifted) {
+	uint8_t key = model.pending[0];
+
+	if (shifted) {
+		model.held_shifted[key] = true;
+		model.shifted_count++;
+	}
+	model.typed[model.count]   = key;
+	model.shifted[model.count] = shifted;
+	model.count++;
+
+	model.pending_count--;
+	for (uint8_t i=0; i<model.pending_count; i++)
+		model.pending[i] = model.pending[i+1];
+}
+
+static void model_event(uint8_t key, bool autoshift, bool press) {
+	uint8_t i;
+
+	if (!autoshift) {
+		if (!press)
+			return;
+		while (model.pending_count)
+			model_send_oldest(false);
+		// (shift held for an auto-shift key applies to other keys)
+		model.typed[model.count]   = key;
+		model.shifted[model.count] = model.shifted_count;
+		model.count++;
+		return;
+	}
+
+	if (press) {
+		if (model.pending_count == AUTOSHIFT_PENDING)
+			model_send_oldest(false);
+		model.pending[model.pending_count] = key;
+		model.since[key] = now;
+		model.pending_count++;
+		return;
+	}
+
+	for (i=0; i<model.pending_count; i++)
+		if (model.pending[i] == key)
+			break;
+	if (i < model.pending_count) {
+		for (; i; i--)
+			model_send_oldest(false);
+		model_send_oldest(false);
+	} else if (model.held_shifted[key]) {
+		model.held_shifted[key] = false;
+		model.shifted_count--;
+	}
+}
+
+static void model_update(void) {
+	while ( model.pending_count
+	        && (uint16_t)(now - model.since[model.pending[0]])
+	           >= AUTOSHIFT_TIME )
+		model_send_oldest(true);
+}
+
+// ----------------------------------------------------------------------------
+
+// a small, fixed, random number generator (so failures can be reproduced)
+static uint32_t random_state = 1;
+
+static uint32_t random_below(uint32_t n) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state % n;
+}
+
+struct event {
+	uint16_t time;  // (ms after the start of the trial)
+	uint8_t  key;
+	bool     press;
+};
+
+static int compare_events(const void * a, const void * b) {
+	const struct event * ea = a;
+	const struct event * eb = b;
+	return (int)ea->time - (int)eb->time;
+}
+
+static uint8_t row(uint8_t key)     { return key % KB_ROWS; }
+static uint8_t col(uint8_t key)     { return key / KB_ROWS; }
+static uint8_t keycode(uint8_t key) { return KEY_a_A + key; }
+
+/*
+ * One random stream of keys, scan by scan, with the clock starting at
+ * `start`; returns whether everything checked out
+ */
+static bool trial(uint16_t trial, uint16_t start) {
+	uint8_t keys = 1 + random_below(KEYS_MAX);
+	bool autoshift[KEYS_MAX];
+	struct event events[2*KEYS_MAX];
+	uint8_t count = 0;
+
+	// keys pressed close together (so they overlap), some tapped and some
+	// held, around `AUTOSHIFT_TIME`
+	uint16_t time = 0;
+	for (uint8_t key=0; key<keys; key++) {
+		autoshift[key] = random_below(5);  // (most of them)
+		time += random_below(60);
+		uint16_t hold = random_below(4)
+		                ? 1 + random_below(AUTOSHIFT_TIME)
+		                : AUTOSHIFT_TIME + random_below(AUTOSHIFT_TIME);
+		events[count++] = (struct event){ time,        key, true  };
+		events[count++] = (struct event){ time + hold, key, false };
+	}
+	qsort(events, count, sizeof(events[0]), compare_events);
+
+	// auto-shift keys may change in the same scan, but other keys get one of
+	// their own: they're sent with the report at the end of the scan, so a
+	// key resolved in the same scan would be in the same report
+	bool alone = !autoshift[events[0].key];
+	for (uint8_t i=1; i<count; i++) {
+		bool this_alone = !autoshift[events[i].key];
+		if (events[i].time <= events[i-1].time)
+			events[i].time = events[i-1].time + (alone || this_alone);
+		else if (random_below(4) == 0 && !alone && !this_alone)
+			events[i].time = events[i-1].time;  // (more in the same scan)
+		alone = this_alone;
+	}
+
+	// run it
+	host  = (typeof(host)){ 0 };
+	model = (typeof(model)){ 0 };
+	uint8_t next = 0;
+	uint16_t end = events[count-1].time + AUTOSHIFT_TIME + 10;
+	for (uint16_t ms=0; ms<=end; ms++) {
+		now = start + ms;
+		for (; next < count && events[next].time == ms; next++) {
+			struct event e = events[next];
+			if (autoshift[e.key])
+				autoshift_press_release( e.press, row(e.key),
+				                         col(e.key), keycode(e.key) );
+			else
+				_kbfun_press_release(e.press, keycode(e.key));
+			model_event(e.key, autoshift[e.key], e.press);
+		}
+		autoshift_update();
+		model_update();
+		usb_keyboard_send();
+	}
+
+	// check it
+	bool same = host.count == model.count;
+	uint8_t i;
+	for (i=0; same && i<model.count; i++)
+		same = host.typed[i] == keycode(model.typed[i])
+		       && host.shifted[i] == model.shifted[i];
+	test_check( same,
+	            "trial %u: %u keys typed, expected %u; first difference "
+	            "at %u", trial, host.count, model.count, i-1 );
+	test_check( host.count == keys,
+	            "trial %u: %u keys typed, %u pressed",
+	            trial, host.count, keys );
+	test_check( !host.together,
+	            "trial %u: %u reports with more than one new key",
+	            trial, host.together );
+
+	bool still_down = shift;
+	for (uint16_t keycode=0; keycode<256; keycode++)
+		still_down = still_down || down[keycode];
+	test_check( !still_down, "trial %u: keys still pressed at the end",
+	            trial );
+
+	return same && host.count == keys && !host.together && !still_down;
+}
+
+// ----------------------------------------------------------------------------
+
+static void test_examples(void) {
+	host  = (typeof(host)){ 0 };
+	now = 0;
+
+	// "a" held, "b" tapped (pressed after "a", released before it times
+	// out): "a" is sent first, so "b" is too, unshifted
+	autoshift_press_release(true, 0, 0, KEY_a_A);
+	now += 20;
+	autoshift_press_release(true, 0, 1, KEY_b_B);
+	now += 20;
+	autoshift_press_release(false, 0, 1, KEY_b_B);
+	for (uint16_t ms=0; ms<AUTOSHIFT_TIME; ms++, now++)
+		autoshift_update();
+	autoshift_press_release(false, 0, 0, KEY_a_A);
+	usb_keyboard_send();
+	test_check( host.count == 2 && host.typed[0] == KEY_a_A
+	            && host.typed[1] == KEY_b_B
+	            && !host.shifted[0] && !host.shifted[1],
+	            "tapped within a hold: %u keys", host.count );
+
+	// one more than fits: the first is sent (unshifted) to make room
+	host  = (typeof(host)){ 0 };
+	for (uint8_t key=0; key<=AUTOSHIFT_PENDING; key++)
+		autoshift_press_release(true, 1, key, KEY_c_C + key);
+	test_check( host.count == 1 && host.typed[0] == KEY_c_C
+	            && !host.shifted[0],
+	            "evicted: %u keys", host.count );
+	now += AUTOSHIFT_TIME;
+	autoshift_update();
+	test_check( host.count == AUTOSHIFT_PENDING + 1
+	            && host.shifted[1] && host.shifted[AUTOSHIFT_PENDING],
+	            "held: %u keys", host.count );
+	for (uint8_t key=0; key<=AUTOSHIFT_PENDING; key++)
+		autoshift_press_release(false, 1, key, KEY_c_C + key);
+	test_check( !shift, "shift still pressed" );
+}
+
+static void test_rollover(void) {
+	for (uint16_t i=0; i<TRIALS; i++)
+		// (starting where the clock will roll over, sometimes)
+		if (!trial(i, UINT16_MAX - random_below(3000)))
+			break;
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+	test_examples();
+	test_rollover();
+	return test_done();
+}
+
@@ -0,0 +1,115 @@
+#! /usr/bin/env python3
+# -----------------------------------------------------------------------------
+# Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (MIT) (see "license.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+"""
+Generate random leader key sequences, for "leader.c"
+
+Output
+- a "--leader.txt" file (for "build-scripts/gen-leader.py" to make into a
+  trie, as it would for a layout)
+- a C header with the same sequences as a plain list (for the test's own,
+  much simpler, matcher), and the functions they name
+
+The keys are from a small alphabet, so sequences share prefixes, and some are
+prefixes of others.  Some sequences share a function.
+"""
+
+# -----------------------------------------------------------------------------
+
+import argparse
+import random
+import sys
+
+# -----------------------------------------------------------------------------
+
+KEYS = ['_A', '_B', '_C', '_D', '_E']
+
+SEQUENCES = 30
+LENGTH_MAX = 4
+ACTIONS = 24  # (fewer than the sequences)
+
+# -----------------------------------------------------------------------------
+
+def generate(seed):
+	"""
+	Returns a list of (keys, action number) tuples, all different
+	"""
+	rng = random.Random(seed)
+	sequences = {}
+	while len(sequences) < SEQUENCES:
+		length = rng.randint(1, LENGTH_MAX)
+		keys = tuple(rng.choice(KEYS) for _ in range(length))
+		sequences.setdefault(keys, rng.randint(1, ACTIONS))
+	return list(sequences.items())
+
+# -----------------------------------------------------------------------------
+
+def main():
+	arg_parser = argparse.ArgumentParser(
+			description = 'Generate random leader key sequences' )
+
+	arg_parser.add_argument(
+			'--seed',
+			type = int,
+			default = 1 )
+	arg_parser.add_argument(
+			'--leader-txt',
+			required = True )
+	arg_parser.add_argument(
+			'--header',
+			required = True )
+
+	args = arg_parser.parse_args(sys.argv[1:])
+
+	sequences = generate(args.seed)
+	actions = sorted(set(action for keys, action in sequences))
+
+	out = []
+	out.append('# generated by "test/gen-leader-test.py" (seed '
+	           + str(args.seed) + '); do not edit')
+	for keys, action in sequences:
+		out.append(' '.join(keys) + ' : leader_test_' + str(action))
+	out.append('')
+	open(args.leader_txt, 'w').write('\n'.join(out))
+
+	out = []
+	out.append('// generated by "test/gen-leader-test.py" (seed '
+	           + str(args.seed) + '); do not edit')
+	out.append('')
+	out.append('#include "../../src/lib/usb/usage-page/keyboard--short-names.h"')
+	out.append('')
+	out.append('#define  SEQUENCES  ' + str(len(sequences)))
+	out.append('#define  LENGTH_MAX  ' + str(LENGTH_MAX))
+	out.append('')
+	out.append('// the keys (ending with 0, if shorter than `LENGTH_MAX`), and')
+	out.append('// the number of the function called')
+	out.append('static const struct {')
+	out.append('\tuint8_t keys[LENGTH_MAX];')
+	out.append('\tuint8_t action;')
+	out.append('} sequences[SEQUENCES] = {')
+	for keys, action in sequences:
+		out.append('\t{ { ' + ', '.join(keys) + ' }, '
+		           + str(action) + ' },')
+	out.append('};')
+	out.append('')
+	out.append('// the keys used (any others end a sequence)')
+	out.append('static const uint8_t sequence_keys[] = { '
+	           + ', '.join(KEYS) + ' };')
+	out.append('')
+	out.append('// (`called()` is defined by the test)')
+	out.append('static void called(uint8_t action);')
+	for action in actions:
+		out.append('void leader_test_' + str(action) + '(void) { called('
+		           + str(action) + '); }')
+	out.append('')
+	open(args.header, 'w').write('\n'.join(out))
+
+# -----------------------------------------------------------------------------
+
+if __name__ == '__main__':
+	main()
+
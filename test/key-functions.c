@@ -0,0 +1,236 @@
+/* ----------------------------------------------------------------------------
+ * host tests : key functions : layers
+ *
+ * Runs "src/main.c" (renamed, so its `main()` isn't ours), with the key
+ * functions, on a small layout defined here, feeding it key events the way its
+ * scan loop does, and checks the layer stack, and what the host sees.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#define main firmware_main
+#include "../src/main.c"
+#undef main
+
+#include "../src/lib/usb/usage-page/keyboard.h"
+#include "../src/lib/key-functions/private.h"
+#include "./test.h"
+
+// ----------------------------------------------------------------------------
+// the layout
+// ----------------------------------------------------------------------------
+
+// keys (row, column)
+#define  STICKY     0, 0  // layer 1 (sticky), transparent on it
+#define  AUTOSHIFT  0, 1  // "b" on layer 0, auto-shift "a" on layer 1
+#define  TRANS      0, 2  // "c" on layer 0, transparent on layer 1
+#define  NUMPAD     0, 3  // numpad (layer 2) on, on layer 0; off, on layer 2
+#define  LAYOUT     0, 4  // next layout, on layer 0, transparent on layer 2
+
+// (a table entry, for a key given as "row, col")
+#define  _ENTRY(layer, row, col, value)  [layer][row][col] = value
+#define  ENTRY(layer, key, value)        _ENTRY(layer, key, value)
+
+const uint8_t PROGMEM _kb_layout[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
+	ENTRY(0, STICKY,    1),
+	ENTRY(0, AUTOSHIFT, KEY_b_B),
+	ENTRY(1, AUTOSHIFT, KEY_a_A),
+	ENTRY(0, TRANS,     KEY_c_C),
+	ENTRY(0, NUMPAD,    2),
+};
+
+const kbfun_funptr_t PROGMEM
+_kb_layout_press[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
+	ENTRY(0, STICKY,    &kbfun_layer_sticky_1),
+	ENTRY(1, STICKY,    &kbfun_transparent),
+	ENTRY(0, AUTOSHIFT, &kbfun_press_release),
+	ENTRY(1, AUTOSHIFT, &kbfun_autoshift_press_release),
+	ENTRY(0, TRANS,     &kbfun_press_release),
+	ENTRY(1, TRANS,     &kbfun_transparent),
+	ENTRY(0, NUMPAD,    &kbfun_layer_push_numpad),
+	ENTRY(2, NUMPAD,    &kbfun_layer_pop_numpad),
+	ENTRY(0, LAYOUT,    &kbfun_layout_next),
+	ENTRY(2, LAYOUT,    &kbfun_transparent),
+};
+
+const kbfun_funptr_t PROGMEM
+_kb_layout_release[KB_LAYERS][KB_ROWS][KB_COLUMNS] = {
+	ENTRY(0, STICKY,    &kbfun_layer_sticky_1),
+	ENTRY(1, STICKY,    &kbfun_transparent),
+	ENTRY(0, AUTOSHIFT, &kbfun_press_release),
+	ENTRY(1, AUTOSHIFT, &kbfun_autoshift_press_release),
+	ENTRY(0, TRANS,     &kbfun_press_release),
+	ENTRY(1, TRANS,     &kbfun_transparent),
+	// (numpad and layout keys do nothing on release)
+};
+
+// (built with `MAKEFILE_LAYOUTS=2`: both layouts are this one)
+struct kb_layouts_tables kb_layouts_current = {
+	_kb_layout, _kb_layout_press, _kb_layout_release };
+
+// ----------------------------------------------------------------------------
+// stand-ins for the rest of the firmware
+// ----------------------------------------------------------------------------
+
+static uint8_t layout;
+
+void kb_layouts_init(void) {}
+uint8_t kb_layouts_get(void) { return layout; }
+void kb_layouts_set(uint8_t new) { layout = new; }
+
+volatile uint8_t DDRB, OCR1A, OCR1B, OCR1C;
+
+void test_delay_cycles(uint32_t cycles) {}
+
+static uint16_t now;  // (ms)
+
+uint16_t timer_get_ms(void) { return now; }
+void timer_sleep_ms(uint16_t ms) { now += ms; }
+
+uint8_t kb_init(void) { return 0; }
+uint8_t kb_update_matrix(bool matrix[KB_ROWS][KB_COLUMNS]) { return 0; }
+
+uint8_t keyboard_modifier_keys;
+uint8_t keyboard_keys[6];
+volatile uint8_t keyboard_leds;
+uint16_t consumer_keys[CONSUMER_KEYS];
+uint16_t system_key;
+
+void usb_init(void) {}
+uint8_t usb_configured(void) { return 1; }
+int8_t usb_extra_send_changes(void) { return 0; }
+
+// what the host has seen: each key, as it first appears in a report
+static struct {
+	uint8_t reported[6];
+	uint8_t typed[16];
+	uint8_t count;
+} host;
+
+int8_t usb_keyboard_send(void) {
+	for (uint8_t i=0; i<6; i++) {
+		uint8_t keycode = keyboard_keys[i];
+		bool new = keycode;
+		for (uint8_t j=0; j<6; j++)
+			if (host.reported[j] == keycode)
+				new = false;
+		if (new && host.count < 16)
+			host.typed[host.count++] = keycode;
+	}
+	for (uint8_t i=0; i<6; i++)
+		host.reported[i] = keyboard_keys[i];
+
+	return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * A key event, then the rest of a scan (as in `main()`)
+ */
+static void key(uint8_t row, uint8_t col, bool is_pressed) {
+	key_event(row, col, is_pressed);
+	combo_update();
+	autoshift_update();
+	leader_update();
+	numpad_update();
+	usb_keyboard_send();
+	now += MAKEFILE_DEBOUNCE_TIME;
+}
+
+static void tap(uint8_t row, uint8_t col) {
+	key(row, col, true);
+	key(row, col, false);
+}
+
+// ----------------------------------------------------------------------------
+
+static void test_sticky_autoshift(void) {
+	host = (typeof(host)){ 0 };
+
+	// a tap of the sticky key: layer 1, for one key
+	tap(STICKY);
+	test_check( main_layers_peek(0) == 1
+	            && main_layers_peek_sticky(0) == eStickyOnceUp,
+	            "after the sticky tap: layer %u (sticky %u)",
+	            main_layers_peek(0), main_layers_peek_sticky(0) );
+
+	// a transparent key doesn't use it up
+	tap(TRANS);
+	test_check( main_layers_peek(0) == 1,
+	            "after a transparent key: layer %u", main_layers_peek(0) );
+
+	// an auto-shift key on it does
+	key(AUTOSHIFT, true);
+	test_check( main_layers_peek(0) == 0,
+	            "after an auto-shift key: layer %u", main_layers_peek(0) );
+	key(AUTOSHIFT, false);
+
+	// so the next key is from layer 0
+	tap(AUTOSHIFT);
+	test_check( host.count == 3 && host.typed[0] == KEY_c_C
+	            && host.typed[1] == KEY_a_A && host.typed[2] == KEY_b_B,
+	            "typed %u keys (0x%02X 0x%02X 0x%02X)", host.count,
+	            host.typed[0], host.typed[1], host.typed[2] );
+}
+
+static void test_numpad(void) {
+	host = (typeof(host)){ 0 };
+
+	// numpad on: the layer right away, and numlock over the next scans (not
+	// sent from inside the key function)
+	key(NUMPAD, true);
+	test_check( main_layers_peek(0) == 2,
+	            "after numpad on: layer %u", main_layers_peek(0) );
+	key(NUMPAD, false);
+	test_check( host.count == 1 && host.typed[0] == KEY_LockingNumLock,
+	            "after numpad on: typed %u keys (0x%02X)",
+	            host.count, host.typed[0] );
+	test_check( !_kbfun_is_pressed(KEY_LockingNumLock),
+	            "numlock still pressed" );
+
+	// numpad off: numlock again
+	tap(NUMPAD);
+	test_check( main_layers_peek(0) == 0,
+	            "after numpad off: layer %u", main_layers_peek(0) );
+	test_check( host.count == 2 && host.typed[1] == KEY_LockingNumLock,
+	            "after numpad off: typed %u keys (0x%02X)",
+	            host.count, host.typed[1] );
+}
+
+static void test_numpad_layout(void) {
+	host = (typeof(host)){ 0 };
+
+	// numpad on, then the next layout: the numpad's layer is popped with the
+	// rest, and numlock toggled back
+	tap(NUMPAD);
+	tap(LAYOUT);
+	test_check( kb_layouts_get() == 1,
+	            "after next layout: layout %u", kb_layouts_get() );
+	test_check( main_layers_peek(0) == 0,
+	            "after next layout: layer %u", main_layers_peek(0) );
+	test_check( host.count == 2 && host.typed[0] == KEY_LockingNumLock
+	            && host.typed[1] == KEY_LockingNumLock,
+	            "after next layout: typed %u keys (0x%02X 0x%02X)",
+	            host.count, host.typed[0], host.typed[1] );
+
+	// so the numpad key turns it on again (instead of off)
+	tap(NUMPAD);
+	test_check( main_layers_peek(0) == 2,
+	            "after numpad on: layer %u", main_layers_peek(0) );
+	tap(NUMPAD);
+	tap(LAYOUT);
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+	test_sticky_autoshift();
+	test_numpad();
+	test_numpad_layout();
+	return test_done();
+}
+
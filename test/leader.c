@@ -0,0 +1,253 @@
+/* ----------------------------------------------------------------------------
+ * host tests : leader key : the trie
+ *
+ * Builds a trie with "build-scripts/gen-leader.py" from random sequences (made
+ * by "gen-leader-test.py"), runs "src/lib/key-functions/leader.c" on it with
+ * random streams of keys and pauses, and checks which functions are called
+ * (and which keys are passed on) against a plain search through the list of
+ * sequences, following the rules in "leader.h".
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../src/lib/timer.h"
+#include "../src/lib/key-functions/leader.h"
+#include "./test.h"
+#include "./build/leader--sequences.h"
+
+// ----------------------------------------------------------------------------
+
+#define  STREAMS  2000
+#define  OPS       60  // per stream
+
+// ----------------------------------------------------------------------------
+// stand-ins for the rest of the firmware
+// ----------------------------------------------------------------------------
+
+static uint16_t now;  // (ms)
+
+uint16_t timer_get_ms(void) { return now; }
+
+// the functions called by the sequences
+static struct {
+	uint16_t count;
+	uint8_t  last;
+} calls;
+
+static void called(uint8_t action) {
+	calls.count++;
+	calls.last = action;
+}
+
+// ----------------------------------------------------------------------------
+// what should happen (following "leader.h")
+// ----------------------------------------------------------------------------
+
+static struct {
+	bool     active;
+	uint8_t  typed[LENGTH_MAX];
+	uint8_t  length;
+	uint16_t last_press;
+	uint16_t calls;
+	uint8_t  last_call;
+} model;
+
+static uint8_t sequence_length(uint8_t s) {
+	uint8_t length = 0;
+	while (length < LENGTH_MAX && sequences[s].keys[length])
+		length++;
+	return length;
+}
+
+// whether sequence `s` starts with what's been typed
+static bool starts_with_typed(uint8_t s) {
+	if (sequence_length(s) < model.length)
+		return false;
+	for (uint8_t i=0; i<model.length; i++)
+		if (sequences[s].keys[i] != model.typed[i])
+			return false;
+	return true;
+}
+
+static void model_finish(bool matched) {
+	model.active = false;
+	if (!matched)
+		return;
+	for (uint8_t s=0; s<SEQUENCES; s++) {
+		if (starts_with_typed(s) && sequence_length(s) == model.length) {
+			model.calls++;
+			model.last_call = sequences[s].action;
+		}
+	}
+}
+
+static void model_start(void) {
+	model.active     = true;
+	model.length     = 0;
+	model.last_press = now;
+}
+
+static bool model_key(uint8_t keycode) {
+	if (!model.active)
+		return false;
+	if (keycode >= KEY_LeftControl && keycode <= KEY_RightGUI)
+		return false;
+
+	model.typed[model.length++] = keycode;
+
+	bool matched = false, longer = false, any = false;
+	for (uint8_t s=0; s<SEQUENCES; s++) {
+		if (!starts_with_typed(s))
+			continue;
+		any = true;
+		if (sequence_length(s) == model.length)
+			matched = true;
+		else
+			longer = true;
+	}
+
+	if (!any)
+		model_finish(false);  // (not the start of any sequence)
+	else if (matched && !longer)
+		model_finish(true);   // (nothing to wait for)
+	else
+		model.last_press = now;
+
+	return true;
+}
+
+static void model_update(void) {
+	if (model.active && (uint16_t)(now - model.last_press) >= LEADER_TIME)
+		model_finish(true);  // (if it's a whole sequence)
+}
+
+// ----------------------------------------------------------------------------
+
+// a small, fixed, random number generator (so failures can be reproduced)
+static uint32_t random_state = 1;
+
+static uint32_t random_below(uint32_t n) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state % n;
+}
+
+/*
+ * Let `ms` ms pass, one scan at a time
+ */
+static void wait(uint16_t ms) {
+	for (; ms; ms--) {
+		now++;
+		leader_update();
+		model_update();
+	}
+}
+
+/*
+ * One random stream of leader presses, keys, and pauses, with the clock
+ * starting at `start`; returns whether everything checked out
+ */
+static bool stream(uint16_t stream, uint16_t start) {
+	char failed[80] = "";
+
+	now = start;
+	leader_reset();
+	model = (typeof(model)){ 0 };
+	calls = (typeof(calls)){ 0 };
+
+	for (uint8_t op=0; !failed[0] && op<OPS; op++) {
+		uint8_t keycode;
+		bool passed_on;
+
+		switch (random_below(8)) {
+			case 0:
+				leader_start();
+				model_start();
+				break;
+			case 1:
+				// (any pause, then right around the timeout)
+				switch (random_below(3)) {
+					case 0: wait(random_below(LEADER_TIME/4)); break;
+					case 1: wait(LEADER_TIME - 2 + random_below(5)); break;
+					case 2: wait(LEADER_TIME * 2); break;
+				}
+				break;
+			default:
+				switch (random_below(10)) {
+					case 0:  keycode = _F;      break;  // (in no sequence)
+					case 1:  // (a modifier)
+						keycode = KEY_LeftControl + random_below(8);
+						break;
+					default:
+						keycode = sequence_keys[ random_below(
+						          sizeof(sequence_keys) ) ];
+						break;
+				}
+				passed_on = !leader_key(keycode);
+				if (passed_on != !model_key(keycode))
+					snprintf( failed, sizeof(failed),
+					          "op %u: key 0x%02X %s", op, keycode,
+					          passed_on ? "passed on" : "kept" );
+				break;
+		}
+
+		if ( !failed[0] && ( calls.count != model.calls
+		                     || calls.last != model.last_call ) )
+			snprintf( failed, sizeof(failed),
+			          "op %u: %u calls (last %u), expected %u (last %u)",
+			          op, calls.count, calls.last, model.calls,
+			          model.last_call );
+	}
+
+	// whatever was started ends
+	wait(LEADER_TIME);
+	if (!failed[0] && calls.count != model.calls)
+		snprintf( failed, sizeof(failed), "at the end: %u calls, expected %u",
+		          calls.count, model.calls );
+
+	test_check(!failed[0], "stream %u: %s", stream, failed);
+	return !failed[0];
+}
+
+// ----------------------------------------------------------------------------
+
+static void test_sequences(void) {
+	// every sequence, typed right away, calls its function (right away, or
+	// after the timeout, if a longer one starts with it)
+	for (uint8_t s=0; s<SEQUENCES; s++) {
+		calls = (typeof(calls)){ 0 };
+		leader_start();
+		for (uint8_t i=0; i<sequence_length(s); i++)
+			test_check( leader_key(sequences[s].keys[i]),
+			            "sequence %u: key %u passed on", s, i );
+		wait(LEADER_TIME);
+		test_check( calls.count == 1 && calls.last == sequences[s].action,
+		            "sequence %u: %u calls (last %u), expected %u",
+		            s, calls.count, calls.last, sequences[s].action );
+	}
+
+	// and nothing is kept once it's done
+	test_check( !leader_key(_A), "key kept after the sequence" );
+}
+
+static void test_streams(void) {
+	for (uint16_t i=0; i<STREAMS; i++)
+		// (starting where the clock will roll over, sometimes)
+		if (!stream(i, UINT16_MAX - random_below(20000)))
+			break;
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+	test_sequences();
+	test_streams();
+	return test_done();
+}
+
@@ -0,0 +1,241 @@
+/* ----------------------------------------------------------------------------
+ * host tests : mouse keys : the trajectory
+ *
+ * Runs "src/lib/mouse-keys/motion.c" one USB frame (1ms) at a time, with the
+ * host taking a report every frame, and checks where the pointer (and the
+ * wheel) ends up against the curve described in "public.h", worked out here
+ * in floating point.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../src/lib/mouse-keys/public.h"
+#include "./test.h"
+
+// ----------------------------------------------------------------------------
+
+// (from "motion.c"; called by the USB code)
+void    usb_mouse_frame  (void);
+uint8_t usb_mouse_report (uint8_t * report);
+
+// how far the fixed point curve may be from the real one: a fraction of the
+// distance, plus a few counts
+#define  TOLERANCE         0.02
+#define  TOLERANCE_COUNTS  2
+
+// ----------------------------------------------------------------------------
+
+// what the host has seen
+static struct {
+	long x, y, wheel, pan;
+	uint8_t buttons;
+	long reports;
+	bool over;  // a report had a value out of range
+} host;
+
+/*
+ * Run `frames` frames, with the host taking a report after every `poll` of
+ * them
+ */
+static void run(long frames, long poll) {
+	uint8_t report[5];
+
+	for (long frame=1; frame<=frames; frame++) {
+		usb_mouse_frame();
+		if (frame % poll)
+			continue;
+		if (!usb_mouse_report(report))
+			continue;
+		host.reports++;
+		host.buttons = report[0];
+		host.x     += (int8_t)report[1];
+		host.y     += (int8_t)report[2];
+		host.wheel += (int8_t)report[3];
+		host.pan   += (int8_t)report[4];
+		for (uint8_t i=1; i<5; i++)
+			if ((int8_t)report[i] == -128)
+				host.over = true;
+	}
+}
+
+/*
+ * Release everything, let it settle, and forget what the host saw
+ */
+static void reset(void) {
+	mousekeys_move(0xFF, false);
+	mousekeys_button(0xFF, false);
+	run(10, 1);
+	host = (typeof(host)){ 0 };
+}
+
+/*
+ * Where a direction held for `frames` frames should be (in counts, or
+ * detents), following the curve in "public.h"
+ */
+static double expected( long frames, double min, double max,
+                        double accel_time ) {
+	double position = 1;  // (the first count, right away)
+
+	for (long frame=MOUSE_DELAY+1; frame<=frames; frame++) {
+		double t = (frame - MOUSE_DELAY) / accel_time;
+		if (t > 1) t = 1;
+		position += (min + (max - min) * t * t) / 1000;
+	}
+
+	return position;
+}
+
+static bool close_to(double actual, double expected) {
+	return fabs(actual - expected)
+	       <= expected * TOLERANCE + TOLERANCE_COUNTS;
+}
+
+// ----------------------------------------------------------------------------
+
+static void test_taps(void) {
+	// a tap (shorter than `MOUSE_DELAY`) moves exactly one count
+	for (long frames=0; frames<=MOUSE_DELAY; frames+=10) {
+		reset();
+		mousekeys_move(MOUSE_RIGHT, true);
+		run(frames, 1);
+		mousekeys_move(MOUSE_RIGHT, false);
+		run(50, 1);
+		test_check( host.x == 1 && host.y == 0,
+		            "tap of %ld frames: moved %ld, %ld",
+		            frames, host.x, host.y );
+	}
+
+	// and so does each of several, including after a long hold
+	reset();
+	mousekeys_move(MOUSE_UP, true);
+	run(700, 1);
+	mousekeys_move(MOUSE_UP, false);
+	run(10, 1);
+	long after_hold = host.y;
+	for (uint8_t i=0; i<5; i++) {
+		mousekeys_move(MOUSE_UP, true);
+		run(40, 1);
+		mousekeys_move(MOUSE_UP, false);
+		run(40, 1);
+	}
+	test_check( host.y == after_hold - 5 && host.x == 0,
+	            "5 taps after a hold: moved %ld", host.y - after_hold );
+
+	// the wheel too
+	reset();
+	mousekeys_move(MOUSE_WHEEL_DOWN, true);
+	run(MOUSE_DELAY - 1, 1);
+	mousekeys_move(MOUSE_WHEEL_DOWN, false);
+	run(10, 1);
+	test_check( host.wheel == -1 && host.pan == 0,
+	            "wheel tap: moved %ld", host.wheel );
+}
+
+static void test_trajectory(void) {
+	static const long checkpoints[] = { 100, 200, 400, 800, 1200, 1650,
+	                                    2500, 4000 };
+	long done = 0;
+
+	// pointer
+	reset();
+	mousekeys_move(MOUSE_RIGHT, true);
+	for (uint8_t i=0; i<sizeof(checkpoints)/sizeof(checkpoints[0]); i++) {
+		run(checkpoints[i] - done, 1);
+		done = checkpoints[i];
+		double e = expected( done, MOUSE_SPEED_MIN, MOUSE_SPEED_MAX,
+		                     MOUSE_ACCEL_TIME );
+		test_check( close_to(host.x, e),
+		            "pointer after %ldms: at %ld, expected %.1f",
+		            done, host.x, e );
+	}
+	test_check( host.y == 0, "pointer: y moved %ld", host.y );
+
+	// at full speed
+	long x = host.x;
+	run(1000, 1);
+	test_check( close_to(host.x - x, MOUSE_SPEED_MAX),
+	            "pointer at full speed: %ld per second", host.x - x );
+
+	// and nothing more, once released
+	mousekeys_move(MOUSE_RIGHT, false);
+	run(1, 1);
+	x = host.x;
+	run(100, 1);
+	test_check( host.x == x, "pointer moved %ld after release", host.x - x );
+
+	// wheel
+	reset();
+	mousekeys_move(MOUSE_WHEEL_UP, true);
+	run(3000, 1);
+	double e = expected( 3000, MOUSE_WHEEL_SPEED_MIN, MOUSE_WHEEL_SPEED_MAX,
+	                     MOUSE_WHEEL_ACCEL_TIME );
+	test_check( close_to(host.wheel, e),
+	            "wheel after 3000ms: at %ld, expected %.1f", host.wheel, e );
+}
+
+static void test_directions(void) {
+	// straight, for comparison
+	reset();
+	mousekeys_move(MOUSE_LEFT, true);
+	run(1500, 1);
+	long straight = -host.x;
+
+	// diagonal: the same speed overall
+	reset();
+	mousekeys_move(MOUSE_LEFT|MOUSE_DOWN, true);
+	run(1500, 1);
+	double diagonal = sqrt( (double)host.x * host.x
+	                        + (double)host.y * host.y );
+	test_check( -host.x == host.y, "diagonal: %ld, %ld", host.x, host.y );
+	test_check( close_to(diagonal, straight),
+	            "diagonal: %.1f, straight: %ld", diagonal, straight );
+
+	// opposite directions cancel
+	reset();
+	mousekeys_move(MOUSE_LEFT|MOUSE_RIGHT, true);
+	run(1500, 1);
+	test_check( host.x == 0 && host.y == 0,
+	            "opposite: moved %ld, %ld", host.x, host.y );
+}
+
+static void test_reports(void) {
+	// a host that's slow to ask still gets valid reports, and nothing piles
+	// up beyond what one report can hold
+	reset();
+	mousekeys_move(MOUSE_DOWN, true);
+	run(2000, 1);
+	long y = host.y;
+	run(5000, 250);
+	test_check( !host.over, "report out of range" );
+	test_check( host.y - y <= 20 * 127,
+	            "moved %ld in 20 reports", host.y - y );
+
+	// buttons are reported when they change, even without movement
+	reset();
+	mousekeys_button(MOUSE_BUTTON_LEFT, true);
+	run(5, 1);
+	test_check( host.buttons == MOUSE_BUTTON_LEFT && host.reports == 1,
+	            "buttons 0x%02X in %ld reports", host.buttons, host.reports );
+	mousekeys_button(MOUSE_BUTTON_LEFT, false);
+	run(5, 1);
+	test_check( host.buttons == 0 && host.reports == 2,
+	            "buttons 0x%02X in %ld reports", host.buttons, host.reports );
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+	test_taps();
+	test_trajectory();
+	test_directions();
+	test_reports();
+	return test_done();
+}
+
@@ -0,0 +1,56 @@
+/* ----------------------------------------------------------------------------
+ * host tests : stand-in for <avr/io.h>
+ *
+ * Only the registers used by the code under test, as plain variables (defined
+ * by the test that needs them).  Port D is the I2C bus: tests that simulate it
+ * compile with `TEST_SIM_I2C`, and provide `sim_ddrd()` and `sim_pind()` (see
+ * "../../twi.c").
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TEST__STUB__AVR__IO_h
+	#define TEST__STUB__AVR__IO_h
+
+	#include <stdint.h>
+
+	// --------------------------------------------------------------------
+
+	// LEDs
+	extern volatile uint8_t DDRB;
+	extern volatile uint8_t OCR1A;
+	extern volatile uint8_t OCR1B;
+	extern volatile uint8_t OCR1C;
+
+	// I2C
+	extern volatile uint8_t PORTD;
+	extern volatile uint8_t TWCR;
+	extern volatile uint8_t TWSR;
+	extern volatile uint8_t TWBR;
+	extern volatile uint8_t TWDR;
+
+	#if TEST_SIM_I2C
+		volatile uint8_t * sim_ddrd (void);
+		uint8_t            sim_pind (void);
+
+		#define  DDRD  (*sim_ddrd())
+		#define  PIND  (sim_pind())
+	#else
+		extern volatile uint8_t DDRD;
+		extern volatile uint8_t PIND;
+	#endif
+
+	#define  TWINT  7
+	#define  TWEA   6
+	#define  TWSTA  5
+	#define  TWSTO  4
+	#define  TWEN   2
+
+	// (for the cycle delay builtin; see there)
+	#include <util/delay.h>
+
+#endif
+
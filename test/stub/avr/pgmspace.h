@@ -0,0 +1,31 @@
+/* ----------------------------------------------------------------------------
+ * host tests : stand-in for <avr/pgmspace.h>
+ *
+ * On the host, "flash" is just memory.  Words are read as whatever type they
+ * are, so that tables of pointers to functions (which are bigger on the host)
+ * still work.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TEST__STUB__AVR__PGMSPACE_h
+	#define TEST__STUB__AVR__PGMSPACE_h
+
+	#include <stdint.h>
+	#include <string.h>
+
+	// --------------------------------------------------------------------
+
+	#define  PROGMEM
+	#define  PSTR(s)  (s)
+
+	#define  pgm_read_byte(address)  (*(const uint8_t *)(address))
+	#define  pgm_read_word(address)  (*(address))
+	#define  pgm_read_dword(address)  (*(const uint32_t *)(address))
+	#define  memcpy_P  memcpy
+
+#endif
+
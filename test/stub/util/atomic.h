@@ -0,0 +1,22 @@
+/* ----------------------------------------------------------------------------
+ * host tests : stand-in for <util/atomic.h>
+ *
+ * The tests don't have interrupts, so a block runs once, as is.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TEST__STUB__UTIL__ATOMIC_h
+	#define TEST__STUB__UTIL__ATOMIC_h
+
+	#define  ATOMIC_BLOCK(type)  \
+		for (int _atomic_once = 1; _atomic_once; _atomic_once = 0)
+
+	#define  ATOMIC_RESTORESTATE
+	#define  ATOMIC_FORCEON
+
+#endif
+
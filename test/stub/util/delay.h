@@ -0,0 +1,33 @@
+/* ----------------------------------------------------------------------------
+ * host tests : stand-in for <util/delay.h>
+ *
+ * Delays don't wait: they're handed to `test_delay_cycles()` (defined by each
+ * test that needs it), so a simulation can keep track of time.  The cycle
+ * delay builtin is replaced the same way (and this is included by the
+ * stand-in <avr/io.h>, so that's everywhere).
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TEST__STUB__UTIL__DELAY_h
+	#define TEST__STUB__UTIL__DELAY_h
+
+	#include <stdint.h>
+
+	// --------------------------------------------------------------------
+
+	void test_delay_cycles (uint32_t cycles);
+
+	#define  __builtin_avr_delay_cycles(cycles)  \
+		test_delay_cycles(cycles)
+
+	#define  _delay_us(us)  \
+		test_delay_cycles( (uint32_t)((us) * (F_CPU / 1000000)) )
+	#define  _delay_ms(ms)  \
+		test_delay_cycles( (uint32_t)((ms) * (F_CPU / 1000)) )
+
+#endif
+
@@ -0,0 +1,36 @@
+/* ----------------------------------------------------------------------------
+ * host tests : stand-in for <util/twi.h>
+ *
+ * The status codes, with the same values as avr-libc's.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TEST__STUB__UTIL__TWI_h
+	#define TEST__STUB__UTIL__TWI_h
+
+	#include <avr/io.h>
+
+	// --------------------------------------------------------------------
+
+	#define  TW_STATUS        (TWSR & 0xF8)
+
+	#define  TW_START         0x08
+	#define  TW_REP_START     0x10
+	#define  TW_MT_SLA_ACK    0x18
+	#define  TW_MT_SLA_NACK   0x20
+	#define  TW_MT_DATA_ACK   0x28
+	#define  TW_MT_DATA_NACK  0x30
+	#define  TW_MR_SLA_ACK    0x40
+	#define  TW_MR_SLA_NACK   0x48
+	#define  TW_MR_DATA_ACK   0x50
+	#define  TW_MR_DATA_NACK  0x58
+
+	#define  TW_READ          1
+	#define  TW_WRITE         0
+
+#endif
+
@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------------------
+ * host tests : helpers
+ *
+ * Each test is its own program: it checks things with `test_check()`, and
+ * returns `test_done()` from `main()` (non-zero if anything failed).
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#ifndef TEST__TEST_h
+	#define TEST__TEST_h
+
+	#include <stdio.h>
+
+	// --------------------------------------------------------------------
+
+	static unsigned test_checks;
+	static unsigned test_failures;
+
+	/*
+	 * Check that `condition` is true; if it isn't, print where, and the
+	 * message (a `printf()` format, and its arguments)
+	 */
+	#define  test_check(condition, ...)  do {				\
+			test_checks++;						\
+			if (!(condition)) {					\
+				test_failures++;				\
+				printf( "%s:%d: failed: %s: ",			\
+				        __FILE__, __LINE__, #condition );	\
+				printf(__VA_ARGS__);				\
+				printf("\n");					\
+			}							\
+		} while(0)
+
+	/*
+	 * Print a summary, and return what `main()` should
+	 */
+	#define  test_done()  (							\
+			printf( "%s: %u checks, %u failed\n",			\
+			        __FILE__, test_checks, test_failures ),	\
+			test_failures ? 1 : 0 )
+
+#endif
+
@@ -0,0 +1,534 @@
+/* ----------------------------------------------------------------------------
+ * host tests : the software (bit-banged) I2C master, on a simulated bus
+ *
+ * Runs "src/lib/twi/teensy-2-0--software.c" (with bus recovery, from
+ * "teensy-2-0--errors.c") and the MCP23018 code that uses it, against a
+ * logic level simulation of the bus, and of an MCP23018 with keys wired to
+ * it the way the left hand is.
+ *
+ * - The lines are open drain: each is high unless the master (port D's
+ *   direction register) or the device pulls it low.  Every access the master
+ *   makes to port D is a point in time: the change it made since the last one
+ *   (one line at a time) is an edge, and the device reacts to it.
+ * - Time is counted in cycles, from the master's delays, each with
+ *   `OVERHEAD_CYCLES` (as in the master's code) added for the instructions
+ *   around it.  The Fast-mode Plus minimums (from the I2C specification, NXP
+ *   UM10204, table 10) are checked on every edge.
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2012 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (MIT) (see "license.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <util/twi.h>
+#include "../src/lib/twi.h"
+#include "../src/keyboard/matrix.h"
+#include "../src/keyboard/ergodox/options.h"
+#include "../src/keyboard/ergodox/controller/mcp23018--functions.h"
+#include "./test.h"
+
+// ----------------------------------------------------------------------------
+
+#if TWI_FREQ != 1000000 || F_CPU != 16000000
+	#error "the timing checks are for Fast-mode Plus (1MHz), at 16MHz"
+#endif
+
+#define  OVERHEAD_CYCLES  6  // (as in "teensy-2-0--software.c")
+
+// minimum times (in cycles, rounded up)
+#define  T_LOW     8  // SCL low (0.5μs)
+#define  T_HIGH    5  // SCL high (0.26μs)
+#define  T_SU_DAT  1  // SDA stable before SCL rises (50ns)
+#define  T_HD_STA  5  // after a start, before SCL falls (0.26μs)
+#define  T_SU_STA  5  // SCL high, before a (repeated) start (0.26μs)
+#define  T_SU_STO  5  // SCL high, before a stop (0.26μs)
+
+// MCP23018 registers (with IOCON.BANK = 0; see "mcp23018.md")
+#define  IODIRA     0x00
+#define  GPIOA      0x12
+#define  OLATA      0x14
+#define  REGISTERS  0x16
+
+// ----------------------------------------------------------------------------
+
+volatile uint8_t PORTD, TWCR, TWSR, TWBR, TWDR;
+
+static volatile uint8_t ddrd;
+
+static struct {
+	uint32_t now;  // in cycles
+
+	// lines (true if high)
+	bool scl;
+	bool sda;
+
+	// when things last happened
+	uint32_t scl_rose;
+	uint32_t scl_fell;
+	uint32_t sda_changed;
+	uint32_t started;
+
+	// what was seen
+	uint16_t starts;
+	uint16_t stops;
+	uint16_t violations;  // a start or stop partway through a byte
+	uint16_t timing;      // minimum times not met
+} bus;
+
+static struct {
+	bool present;
+	bool sda_shorted;  // (to ground: nothing will free the bus)
+	uint16_t stretch;  // how many reads of SCL to hold it low after each
+	                   // falling edge
+
+	enum { IDLE, RECEIVE, ACK, SEND, ACK_IN } state;
+	bool     sda_low;
+	uint16_t scl_held;
+	uint8_t  byte;
+	uint8_t  bits;
+	bool     addressed;
+	bool     reading;
+	bool     first;    // (the first byte written sets the register pointer)
+	bool     acked;    // (by the master, when reading)
+	uint8_t  pointer;
+	uint8_t  reg[REGISTERS];
+} device;
+
+// the keys on the left hand (columns 0 to 6)
+static bool keys[KB_ROWS][7];
+
+// ----------------------------------------------------------------------------
+// the device
+
+/*
+ * Pin levels on port A (`port` 0) or B (1): outputs as latched, inputs
+ * pulled up (by the chip, or the keys' pull-ups), except where a pressed key
+ * connects them to an output that's low (column `c` is pin A`c`, and row `r`
+ * pin B`5-r`)
+ */
+static uint8_t pins(uint8_t port) {
+	uint8_t low_a = ~device.reg[IODIRA]   & ~device.reg[OLATA];
+	uint8_t low_b = ~device.reg[IODIRA+1] & ~device.reg[OLATA+1];
+	uint8_t a = ~low_a, b = ~low_b;
+
+	for (uint8_t row=0; row<KB_ROWS; row++) {
+		for (uint8_t col=0; col<7; col++) {
+			if (!keys[row][col])
+				continue;
+			if (low_a & (1<<col))   b &= ~(1<<(5-row));
+			if (low_b & (1<<(5-row))) a &= ~(1<<col);
+		}
+	}
+
+	return port ? b : a;
+}
+
+static uint8_t reg_read(uint8_t address) {
+	if (address == GPIOA || address == GPIOA+1)
+		return pins(address - GPIOA);
+	return device.reg[address];
+}
+
+static void reg_write(uint8_t address, uint8_t data) {
+	if (address == GPIOA || address == GPIOA+1)
+		address += OLATA - GPIOA;  // (writing GPIO writes the latch)
+	device.reg[address] = data;
+}
+
+// (registers are read and written sequentially, wrapping around)
+static uint8_t next_pointer(void) {
+	uint8_t p = device.pointer;
+	device.pointer = (p + 1) % REGISTERS;
+	return p;
+}
+
+static void send_bit(void) {
+	device.sda_low = !( device.byte & (0x80 >> device.bits) );
+}
+
+static void start_condition(void) {
+	bus.starts++;
+	if (device.state == RECEIVE && device.bits >= 2)
+		bus.violations++;
+	if (bus.now - bus.scl_rose < T_SU_STA)
+		bus.timing++;
+	bus.started = bus.now;
+
+	if (!device.present)
+		return;
+	device.state     = RECEIVE;
+	device.sda_low   = false;
+	device.byte      = 0;
+	device.bits      = 0;
+	device.addressed = false;
+}
+
+static void stop_condition(void) {
+	bus.stops++;
+	if (device.state == RECEIVE && device.bits >= 2)
+		bus.violations++;
+	if (bus.now - bus.scl_rose < T_SU_STO)
+		bus.timing++;
+
+	device.state   = IDLE;
+	device.sda_low = false;
+}
+
+static void scl_rise(void) {
+	if (bus.now - bus.scl_fell < T_LOW || bus.now - bus.sda_changed < T_SU_DAT)
+		bus.timing++;
+	bus.scl_rose = bus.now;
+
+	if (device.state == RECEIVE) {
+		device.byte = (device.byte << 1) | bus.sda;
+		device.bits++;
+	} else if (device.state == ACK_IN) {
+		device.acked = !bus.sda;
+	}
+}
+
+static void scl_fall(void) {
+	if (bus.now - bus.scl_rose < T_HIGH || bus.now - bus.started < T_HD_STA)
+		bus.timing++;
+	bus.scl_fell = bus.now;
+
+	if (device.state != IDLE)
+		device.scl_held = device.stretch;
+
+	switch (device.state) {
+		case IDLE:
+			break;
+
+		case RECEIVE:
+			if (device.bits < 8)
+				break;
+			if (!device.addressed) {
+				if ((device.byte >> 1) != MCP23018_TWI_ADDRESS) {
+					device.state = IDLE;  // (not for us)
+					break;
+				}
+				device.addressed = true;
+				device.reading   = device.byte & TW_READ;
+				device.first     = true;
+			} else if (device.first) {
+				device.pointer = device.byte % REGISTERS;
+				device.first   = false;
+			} else {
+				reg_write(next_pointer(), device.byte);
+			}
+			device.sda_low = true;
+			device.state   = ACK;
+			break;
+
+		case ACK:
+			device.bits = 0;
+			if (device.reading) {
+				device.byte  = reg_read(next_pointer());
+				device.state = SEND;
+				send_bit();
+			} else {
+				device.byte    = 0;
+				device.sda_low = false;
+				device.state   = RECEIVE;
+			}
+			break;
+
+		case SEND:
+			if (++device.bits < 8) {
+				send_bit();
+			} else {
+				device.sda_low = false;
+				device.state   = ACK_IN;
+			}
+			break;
+
+		case ACK_IN:
+			if (device.acked) {
+				device.byte  = reg_read(next_pointer());
+				device.bits  = 0;
+				device.state = SEND;
+				send_bit();
+			} else {
+				device.state = IDLE;
+			}
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// the bus
+
+/*
+ * Bring the lines up to date with what the master and the device are doing,
+ * one line at a time (if both changed, in the order that isn't a start or
+ * stop: SCL first if it fell, SDA first if it rose)
+ */
+static void update(void) {
+	bool scl = !(ddrd & (1<<0)) && !device.scl_held;
+	bool sda_master = !(ddrd & (1<<1)) && !device.sda_shorted;
+
+	for (uint8_t pass=0; pass<2; pass++) {
+		if ((pass == 0) == (bus.scl && !scl)) {
+			if (scl != bus.scl) {
+				bus.scl = scl;
+				if (scl) scl_rise();
+				else     scl_fall();
+			}
+		} else {
+			bool sda = sda_master && !device.sda_low;
+			if (sda != bus.sda) {
+				bus.sda = sda;
+				bus.sda_changed = bus.now;
+				if (bus.scl) {
+					if (sda) stop_condition();
+					else     start_condition();
+				}
+			}
+		}
+	}
+
+	// (the device may have changed SDA, on a falling edge)
+	bus.sda = sda_master && !device.sda_low;
+}
+
+volatile uint8_t * sim_ddrd(void) {
+	update();
+	return &ddrd;
+}
+
+uint8_t sim_pind(void) {
+	update();
+	if (device.scl_held) {
+		device.scl_held--;
+		update();
+	}
+	return (bus.scl << 0) | (bus.sda << 1);
+}
+
+void test_delay_cycles(uint32_t cycles) {
+	update();
+	bus.now += cycles + OVERHEAD_CYCLES;
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Start over with a free bus, and no errors counted (but leave the device's
+ * registers, and the keys, as they are)
+ */
+static void reset_bus(void) {
+	memset(&bus, 0, sizeof(bus));
+	bus.scl = bus.sda = true;
+	device.state       = IDLE;
+	device.sda_low     = false;
+	device.scl_held    = 0;
+	device.stretch     = 0;
+	device.present     = true;
+	device.sda_shorted = false;
+	ddrd = 0;
+	twi_errors_clear();
+	twi_init();
+}
+
+/*
+ * Start over, with the device as at power on
+ */
+static void reset(void) {
+	memset(keys, 0, sizeof(keys));
+	for (uint8_t i=0; i<REGISTERS; i++)
+		device.reg[i] = (i <= IODIRA+1) ? 0xFF : 0;
+	reset_bus();
+}
+
+static bool matrix_is(bool matrix[KB_ROWS][KB_COLUMNS]) {
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		for (uint8_t col=0; col<7; col++)
+			if (matrix[row][col] != keys[row][col])
+				return false;
+	return true;
+}
+
+static bool matrix_is_clear(bool matrix[KB_ROWS][KB_COLUMNS]) {
+	for (uint8_t row=0; row<KB_ROWS; row++)
+		for (uint8_t col=0; col<7; col++)
+			if (matrix[row][col])
+				return false;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+static void test_transactions(void) {
+	uint8_t data = 0;
+
+	reset();
+
+	// write two registers, and read one back (with a repeated start)
+	test_check( !twi_start(), "start" );
+	test_check( !twi_send((MCP23018_TWI_ADDRESS<<1) | TW_WRITE), "address" );
+	test_check( !twi_send(0x0C), "register" );
+	test_check( !twi_send(0xA5), "data" );
+	test_check( !twi_send(0x3C), "data" );
+	twi_stop();
+	test_check( device.reg[0x0C] == 0xA5 && device.reg[0x0D] == 0x3C,
+	            "written 0x%02X 0x%02X",
+	            device.reg[0x0C], device.reg[0x0D] );
+
+	// (the master acknowledges every byte it reads, as the TWI hardware
+	// version does, so the device goes on to send the next register; the
+	// stop only works if that one starts with a 1, as the ones after the
+	// registers the MCP23018 code reads do)
+	device.reg[0x0E] = 0x80;
+
+	test_check( !twi_start(), "start" );
+	twi_send((MCP23018_TWI_ADDRESS<<1) | TW_WRITE);
+	twi_send(0x0D);
+	test_check( !twi_start(), "repeated start" );
+	test_check( !twi_send((MCP23018_TWI_ADDRESS<<1) | TW_READ), "address" );
+	test_check( !twi_read(&data), "read" );
+	twi_stop();
+	test_check( data == 0x3C, "read 0x%02X", data );
+
+	test_check( bus.starts == 3 && bus.stops == 2,
+	            "%u starts, %u stops", bus.starts, bus.stops );
+	test_check( !bus.violations, "%u violations", bus.violations );
+	test_check( !bus.timing, "%u timing errors", bus.timing );
+	test_check( bus.scl && bus.sda, "bus left free" );
+
+	// nobody at this address
+	test_check( !twi_start(), "start" );
+	test_check( twi_send(0x42 | TW_WRITE) == TW_MT_SLA_NACK, "address nack" );
+	twi_stop();
+	test_check( !twi_start(), "start" );
+	test_check( twi_send(0x42 | TW_READ) == TW_MR_SLA_NACK, "address nack" );
+	twi_stop();
+	test_check( twi_errors[TWI_ERROR_NACK] == 2,
+	            "%u nacks counted", twi_errors[TWI_ERROR_NACK] );
+}
+
+static void test_clock_stretching(void) {
+	uint8_t data = 0;
+
+	// a short stretch is waited for
+	reset();
+	device.reg[0x05] = 0x5A;
+	device.stretch = 20;
+	twi_start();
+	twi_send((MCP23018_TWI_ADDRESS<<1) | TW_WRITE);
+	twi_send(0x05);
+	twi_start();
+	twi_send((MCP23018_TWI_ADDRESS<<1) | TW_READ);
+	test_check( !twi_read(&data) && data == 0x5A, "read 0x%02X", data );
+	twi_stop();
+	test_check( !twi_errors[TWI_ERROR_TIMEOUT], "no timeouts" );
+	test_check( !bus.timing, "%u timing errors", bus.timing );
+
+	// a long one times out, and everything fails until the next start
+	reset();
+	device.stretch = 60000;
+	twi_start();
+	test_check( twi_send((MCP23018_TWI_ADDRESS<<1) | TW_WRITE)
+	            == TWI_STATUS_TIMEOUT, "timed out" );
+	test_check( twi_send(0) == TWI_STATUS_TIMEOUT, "still failing" );
+	twi_stop();
+	test_check( twi_errors[TWI_ERROR_TIMEOUT] == 1,
+	            "%u timeouts counted", twi_errors[TWI_ERROR_TIMEOUT] );
+}
+
+static void test_matrix(void) {
+	bool matrix[KB_ROWS][KB_COLUMNS];
+
+	reset();
+	test_check( !mcp23018_init(), "init" );
+	test_check( device.reg[IODIRA] == 0x80 && device.reg[IODIRA+1] == 0xFF,
+	            "directions 0x%02X 0x%02X",
+	            device.reg[IODIRA], device.reg[IODIRA+1] );
+
+	// nothing pressed, then a few keys (including two in a column, and two
+	// in a row), then nothing again
+	for (uint8_t scan=0; scan<6; scan++) {
+		memset(keys, 0, sizeof(keys));
+		if (scan >= 2 && scan < 5) {
+			keys[0][0] = keys[3][0] = true;
+			keys[3][6] = keys[5][2] = true;
+		}
+		memset(matrix, 0xFF, sizeof(matrix));
+		test_check( !mcp23018_update_matrix(matrix), "scan %u", scan );
+		test_check( matrix_is(matrix), "scan %u: matrix", scan );
+	}
+
+	test_check( !bus.violations, "%u violations", bus.violations );
+	test_check( !bus.timing, "%u timing errors", bus.timing );
+}
+
+/*
+ * (the MCP23018 code keeps some state between scans, so this follows on from
+ * `test_matrix()`: the left hand is idle, with its columns driven low)
+ */
+static void test_faults(void) {
+	bool matrix[KB_ROWS][KB_COLUMNS];
+
+	// unplugged: every scan fails, with no keys
+	reset_bus();
+	device.present = false;
+	memset(matrix, 0xFF, sizeof(matrix));
+	test_check( mcp23018_update_matrix(matrix) == TW_MT_SLA_NACK, "nack" );
+	test_check( matrix_is(matrix), "matrix cleared" );
+
+	// plugged back in
+	device.present = true;
+	test_check( !mcp23018_update_matrix(matrix), "plugged back in" );
+
+	// the device holding SDA low, partway through sending a zero (e.g. after
+	// the master was reset during a read): the bus is recovered, and the
+	// left hand left out for `MCP23018__RETRY_SCANS` scans
+	reset_bus();
+	device.state   = SEND;
+	device.byte    = 0x00;
+	device.bits    = 3;
+	device.sda_low = true;
+	bus.sda        = false;  // (for a while now: not a start)
+	keys[1][1]     = true;
+	test_check( mcp23018_update_matrix(matrix) == TWI_STATUS_TIMEOUT,
+	            "timed out" );
+	test_check( bus.scl && bus.sda && device.state == IDLE, "recovered" );
+	test_check( twi_errors[TWI_ERROR_TIMEOUT] == 1
+	            && !twi_errors[TWI_ERROR_STUCK], "counted %u, %u",
+	            twi_errors[TWI_ERROR_TIMEOUT], twi_errors[TWI_ERROR_STUCK] );
+
+	for (uint8_t scan=0; scan<MCP23018__RETRY_SCANS; scan++) {
+		uint16_t starts = bus.starts;
+		memset(matrix, 0xFF, sizeof(matrix));
+		test_check( mcp23018_update_matrix(matrix) == TWI_STATUS_TIMEOUT,
+		            "scan %u skipped", scan );
+		test_check( bus.starts == starts && matrix_is_clear(matrix),
+		            "scan %u: left alone", scan );
+	}
+	test_check( !mcp23018_update_matrix(matrix) && matrix_is(matrix),
+	            "back" );
+	test_check( !bus.violations, "%u violations", bus.violations );
+
+	// SDA shorted: recovery fails, and that's counted too
+	reset_bus();
+	device.sda_shorted = true;
+	test_check( mcp23018_update_matrix(matrix) == TWI_STATUS_TIMEOUT,
+	            "timed out" );
+	test_check( twi_errors[TWI_ERROR_STUCK] == 1,
+	            "%u stuck counted", twi_errors[TWI_ERROR_STUCK] );
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+	test_transactions();
+	test_clock_stretching();
+	test_matrix();
+	test_faults();
+	return test_done();
+}
+